@@ -0,0 +1,144 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleAffectors.h"
+#include"ParticleCore/ParticleRandom.h"
+#include<algorithm>
+#include<cstring>
+#include<memory>
+#include<vector>
+
+namespace
+{
+	//naive baseline: every affector behind a virtual call per batch, nothing inlines across affectors
+	class VirtualAffector
+	{
+	public:
+		virtual ~VirtualAffector() {}
+		virtual void Apply(ParticleLanes& lanes, SimdFloat dt) const = 0;
+		virtual void Constrain(ParticleLanes& lanes, SimdFloat dt) const = 0;
+	};
+
+	template<typename Affector>
+	class VirtualAdapter : public VirtualAffector
+	{
+	public:
+		VirtualAdapter(const Affector& affector) : affector(affector) {}
+		void Apply(ParticleLanes& lanes, SimdFloat dt) const override { affector.Apply(lanes, dt); }
+		void Constrain(ParticleLanes& lanes, SimdFloat dt) const override { affector.Constrain(lanes, dt); }
+
+	private:
+		Affector affector;
+	};
+
+	void RunVirtual(const std::vector<std::unique_ptr<VirtualAffector>>& affectors, ParticleData& particles, int count, float dt)
+	{
+		const SimdFloat vDt = SimdSet1(dt);
+		for (int i = 0; i < count; i += PARTICLE_SIMD_WIDTH)
+		{
+			ParticleLanes lanes;
+			lanes.positionX = SimdLoad(particles.PositionX + i);
+			lanes.positionY = SimdLoad(particles.PositionY + i);
+			lanes.positionZ = SimdLoad(particles.PositionZ + i);
+			lanes.velocityX = SimdLoad(particles.VelocityX + i);
+			lanes.velocityY = SimdLoad(particles.VelocityY + i);
+			lanes.velocityZ = SimdLoad(particles.VelocityZ + i);
+			lanes.age = SimdLoad(particles.Age + i);
+
+			for (const auto& affector : affectors)
+			{
+				affector->Apply(lanes, vDt);
+			}
+
+			lanes.positionX = SimdMulAdd(lanes.velocityX, vDt, lanes.positionX);
+			lanes.positionY = SimdMulAdd(lanes.velocityY, vDt, lanes.positionY);
+			lanes.positionZ = SimdMulAdd(lanes.velocityZ, vDt, lanes.positionZ);
+
+			for (const auto& affector : affectors)
+			{
+				affector->Constrain(lanes, vDt);
+			}
+
+			SimdStore(particles.PositionX + i, lanes.positionX);
+			SimdStore(particles.PositionY + i, lanes.positionY);
+			SimdStore(particles.PositionZ + i, lanes.positionZ);
+			SimdStore(particles.VelocityX + i, lanes.velocityX);
+			SimdStore(particles.VelocityY + i, lanes.velocityY);
+			SimdStore(particles.VelocityZ + i, lanes.velocityZ);
+		}
+	}
+
+	void FillParticles(ParticleData& particles, int count)
+	{
+		ParticleRandom random(5);
+		random.InSphere(particles.PositionX, particles.PositionY, particles.PositionZ, count, 2.0f);
+		random.InSphere(particles.VelocityX, particles.VelocityY, particles.VelocityZ, count, 1.0f);
+		random.Uniform(particles.Age, count, 0.0f, 5.0f);
+	}
+
+	bool StreamsMatch(const ParticleData& a, const ParticleData& b, int count)
+	{
+		const float* streams[2][6] =
+		{
+			{ a.PositionX, a.PositionY, a.PositionZ, a.VelocityX, a.VelocityY, a.VelocityZ },
+			{ b.PositionX, b.PositionY, b.PositionZ, b.VelocityX, b.VelocityY, b.VelocityZ }
+		};
+		for (int s = 0; s < 6; s++)
+		{
+			if (memcmp(streams[0][s], streams[1][s], count * sizeof(float)) != 0)
+				return false;
+		}
+		return true;
+	}
+}
+
+void RunAffectorSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	GravityAffector gravity(Float3{ 0.0f, -9.8f, 0.0f });
+	LinearDragAffector drag(0.4f);
+	WindAffector wind(Float3{ 0.5f, 0.0f, 0.2f }, 0.3f);
+	BuoyancyAffector buoyancy(12.0f, 4.0f);
+	VortexAffector vortex(Float3{ 0.0f, 0.0f, 0.0f }, Float3{ 0.0f, 1.0f, 0.0f }, 2.0f);
+	PointAttractorAffector attractor(Float3{ 0.0f, 1.0f, 0.0f }, 0.5f, 0.1f);
+	GroundBounceAffector bounce(-1.0f, 0.5f, 0.2f);
+
+	ParticleAffectorPipeline<GravityAffector, LinearDragAffector, WindAffector, BuoyancyAffector, VortexAffector,
+		PointAttractorAffector, GroundBounceAffector> fused(gravity, drag, wind, buoyancy, vortex, attractor, bounce);
+
+	std::vector<std::unique_ptr<VirtualAffector>> virtualAffectors;
+	virtualAffectors.push_back(std::make_unique<VirtualAdapter<GravityAffector>>(gravity));
+	virtualAffectors.push_back(std::make_unique<VirtualAdapter<LinearDragAffector>>(drag));
+	virtualAffectors.push_back(std::make_unique<VirtualAdapter<WindAffector>>(wind));
+	virtualAffectors.push_back(std::make_unique<VirtualAdapter<BuoyancyAffector>>(buoyancy));
+	virtualAffectors.push_back(std::make_unique<VirtualAdapter<VortexAffector>>(vortex));
+	virtualAffectors.push_back(std::make_unique<VirtualAdapter<PointAttractorAffector>>(attractor));
+	virtualAffectors.push_back(std::make_unique<VirtualAdapter<GroundBounceAffector>>(bounce));
+
+	for (int count = 10000; count <= options.maxCount; count *= 10)
+	{
+		ParticleData fusedParticles(count);
+		ParticleData virtualParticles(count);
+		FillParticles(fusedParticles, count);
+		FillParticles(virtualParticles, count);
+
+		BenchmarkTimer fusedTimer;
+		for (int f = 0; f < options.frames; f++)
+		{
+			fused.Run(fusedParticles, 0, count, options.dt);
+		}
+		double fusedSeconds = fusedTimer.ElapsedSeconds() / options.frames;
+
+		BenchmarkTimer virtualTimer;
+		for (int f = 0; f < options.frames; f++)
+		{
+			RunVirtual(virtualAffectors, virtualParticles, count, options.dt);
+		}
+		double virtualSeconds = virtualTimer.ElapsedSeconds() / options.frames;
+
+		BenchmarkResult result = { "affectors", "7_affectors/" + std::to_string(count) };
+		result.Set("particles", count);
+		result.Set("fused_ns_per_particle", fusedSeconds * 1.0e9 / count);
+		result.Set("virtual_ns_per_particle", virtualSeconds * 1.0e9 / count);
+		result.Set("speedup", virtualSeconds / fusedSeconds);
+		result.Set("bitwise_match", StreamsMatch(fusedParticles, virtualParticles, count) ? 1.0 : 0.0);
+		report.Add(result);
+	}
+}
@@ -0,0 +1,114 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleSimulation.h"
+#include<algorithm>
+#include<cstring>
+#include<memory>
+#include<vector>
+
+namespace
+{
+	const float lifetime = 0.25f;
+
+	std::vector<ParticleVertex> DrawnVertices(const ParticleSimulation& simulation)
+	{
+		std::vector<ParticleVertex> vertices;
+		ParticleSpan spans[2];
+		int spanCount = simulation.GetDrawSpans(spans);
+		for (int s = 0; s < spanCount; s++)
+		{
+			const ParticleVertex* first = simulation.GetVertices() + 4 * spans[s].first;
+			vertices.insert(vertices.end(), first, first + 4 * spans[s].count);
+		}
+		return vertices;
+	}
+}
+
+void RunAnalyticSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	const Float3 cameraRight = { 1.0f, 0.0f, 0.0f };
+	const Float3 cameraUp = { 0.0f, 1.0f, 0.0f };
+	const int warmupFrames = (int)(lifetime / options.dt) + 2;
+
+	struct Config
+	{
+		const char* name;
+		ParticleStorage storage;
+		int threads;
+	};
+	const Config configs[4] = { { "compact", ParticleStorage::Compact, 1 }, { "ring", ParticleStorage::Ring, 1 },
+		{ "analytic", ParticleStorage::Analytic, 1 }, { "analytic", ParticleStorage::Analytic, 4 } };
+
+	for (int count : { 100000, 1000000 })
+	{
+		if (count > options.maxCount)
+			continue;
+
+		int compactAlive = 0;
+		std::vector<ParticleVertex> reference;
+		for (const Config& config : configs)
+		{
+			//the storage suite's force free emitter, steady state at count live particles
+			auto simulation = std::make_unique<ParticleSimulation>(Float3{ 1.2f, 1.1f, 1.9f }, Float3{ 0.02f, 0.2f, 0.1f },
+				count, lifetime, lifetime / count, 0.05f, 1.0f, Float4{ 0.0f, 0.0f, 0.0f, 1.0f }, Float4{ 1.0f, 1.0f, 1.0f, 0.0f });
+			simulation->SetStorage(config.storage);
+			if (config.threads > 1)
+				simulation->SetJobSystem(std::make_shared<JobSystem>(config.threads - 1));
+
+			for (int f = 0; f < warmupFrames; f++)
+			{
+				simulation->Simulate(options.dt);
+			}
+
+			double simulateSeconds = 0.0;
+			double buildSeconds = 0.0;
+			for (int f = 0; f < options.frames; f++)
+			{
+				BenchmarkTimer simulateTimer;
+				simulation->Simulate(options.dt);
+				simulateSeconds += simulateTimer.ElapsedSeconds();
+
+				BenchmarkTimer buildTimer;
+				simulation->BuildVertices(cameraRight, cameraUp);
+				buildSeconds += buildTimer.ElapsedSeconds();
+			}
+			simulateSeconds /= options.frames;
+			buildSeconds /= options.frames;
+			//state bytes before a sort brings in the evaluation scratch
+			size_t memoryBytes = simulation->GetParticleMemoryBytes();
+
+			//a sorted frame evaluates every particle into the scratch streams before sorting
+			simulation->Simulate(options.dt);
+			BenchmarkTimer sortTimer;
+			simulation->SortBackToFront(Float3{ 0.0f, 1.0f, -10.0f }, Float3{ 0.0f, 0.0f, 1.0f });
+			simulation->BuildVertices(cameraRight, cameraUp);
+			double sortedSeconds = sortTimer.ElapsedSeconds();
+
+			int alive = simulation->GetParticleCount();
+			if (config.storage == ParticleStorage::Compact)
+				compactAlive = alive;
+
+			//evaluation over any thread count must draw the same bits
+			std::vector<ParticleVertex> vertices = DrawnVertices(*simulation);
+			bool matches = true;
+			if (config.storage == ParticleStorage::Analytic)
+			{
+				if (config.threads == 1)
+					reference = vertices;
+				matches = reference.size() == vertices.size() &&
+					std::memcmp(reference.data(), vertices.data(), vertices.size() * sizeof(ParticleVertex)) == 0;
+			}
+
+			BenchmarkResult result = { "analytic", std::string(config.name) + "/" + std::to_string(count) + "/" + std::to_string(config.threads) + "_threads" };
+			result.Set("particles", alive);
+			result.Set("threads", config.threads);
+			result.Set("state_bytes_per_particle", (double)memoryBytes / count);
+			result.Set("simulate_ms", simulateSeconds * 1.0e3);
+			result.Set("build_ms", buildSeconds * 1.0e3);
+			result.Set("ns_per_particle", (simulateSeconds + buildSeconds) * 1.0e9 / std::max(alive, 1));
+			result.Set("sorted_frame_ms", sortedSeconds * 1.0e3);
+			result.Set("alive_match", alive == compactAlive ? 1 : 0);
+			result.Set("bitwise_match", matches ? 1 : 0);
+			report.Add(result);
+		}
+	}
+}
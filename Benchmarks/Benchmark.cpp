@@ -0,0 +1,60 @@
+#include "Benchmark.h"
+#include <cstdio>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+void BenchmarkReport::Add(const BenchmarkResult& result)
+{
+	printf("%-12s %-28s", result.suite.c_str(), result.name.c_str());
+	for (auto& v : result.values)
+	{
+		printf(" %s=%.4g", v.first.c_str(), v.second);
+	}
+	printf("\n");
+	fflush(stdout);
+
+	results.push_back(result);
+}
+
+bool BenchmarkReport::WriteJson(const std::string& path, const BenchmarkOptions& options) const
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\n  \"frames\": %d,\n  \"dt\": %.9g,\n  \"kernels\": \"%s\",\n  \"results\": [", options.frames, options.dt,
+		options.kernels.c_str());
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& r = results[i];
+		fprintf(file, "%s\n    {\"suite\": \"%s\", \"name\": \"%s\"", i == 0 ? "" : ",", r.suite.c_str(), r.name.c_str());
+		for (auto& v : r.values)
+		{
+			fprintf(file, ", \"%s\": %.9g", v.first.c_str(), v.second);
+		}
+		fprintf(file, "}");
+	}
+	fprintf(file, "\n  ]\n}\n");
+	fclose(file);
+	return true;
+}
+
+double GetPeakResidentBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters = {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return (double)counters.PeakWorkingSetSize;
+#else
+	rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+	//kilobytes on Linux
+	return (double)usage.ru_maxrss * 1024.0;
+#endif
+}
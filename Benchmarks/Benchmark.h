@@ -0,0 +1,62 @@
+#pragma once
+
+#include<chrono>
+#include<string>
+#include<utility>
+#include<vector>
+
+//Shared plumbing for the headless benchmark suites: timing, memory and JSON reporting
+
+//options parsed from the command line, shared by every suite
+struct BenchmarkOptions
+{
+	//largest particle count a suite may run
+	int maxCount = 10000000;
+	//timed frames per configuration
+	int frames = 10;
+	//fixed simulation step
+	float dt = 1.0f / 60.0f;
+	//only run suites whose name contains this, empty runs all
+	std::string filter;
+	//write results here as JSON when not empty
+	std::string jsonPath;
+	//name of the kernel variant that ran, written to the JSON file
+	std::string kernels;
+};
+
+//one measured configuration, printed as a row and written as a JSON object
+struct BenchmarkResult
+{
+	std::string suite;
+	std::string name;
+	std::vector<std::pair<std::string, double>> values;
+
+	void Set(const char* key, double value) { values.push_back({ key, value }); }
+};
+
+class BenchmarkReport
+{
+public:
+	//print the result and keep it for the JSON file
+	void Add(const BenchmarkResult& result);
+	bool WriteJson(const std::string& path, const BenchmarkOptions& options) const;
+
+private:
+	std::vector<BenchmarkResult> results;
+};
+
+class BenchmarkTimer
+{
+public:
+	BenchmarkTimer() : start(std::chrono::steady_clock::now()) {}
+	double ElapsedSeconds() const
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+private:
+	std::chrono::steady_clock::time_point start;
+};
+
+//peak resident set size of the whole process so far
+double GetPeakResidentBytes();
@@ -0,0 +1,59 @@
+#pragma once
+
+#include"Benchmark.h"
+
+//every suite runs its configurations up to options.maxCount and adds one result per configuration
+
+//ParticleSimulation::Simulate + BuildVertices at steady state, 1k to 10M particles
+void RunThroughputSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//1M particle emitter split over 1 to 16+ threads, checks the output matches the single threaded run
+void RunThreadingSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//quad vertex build vs instance packing, upload size per particle and corner agreement with the instanced vertex shader math
+void RunBillboardSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//ParticleRandom throughput per distribution, and one frame spawning a 100k burst
+void RunRandomSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//ParticleEmissionShape batch sampling per shape, mesh surfaces from 128 to 512k triangles, and a scheduler hitch frame
+void RunEmissionSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//all 7 affectors as one fused ParticleAffectorPipeline against a virtual call per affector per batch
+void RunAffectorSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//size and color over life table lookups with 2, 8 and 64 key curves, cost per frame should be flat
+void RunCurveSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//curl noise TurbulenceAffector per volume quality: sampling cost, footprint, generate vs cached load, SIMD vs scalar agreement
+void RunTurbulenceSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//ParticleFluidSolver ms per step on 32^3 to 128^3 grids over 1 and all threads, and a step held to a ms budget
+void RunFluidSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//ParticleDensityVolume splatting over 1 and 4 threads, memory per brick count against a dense grid, and sampling cost
+void RunDensitySuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//ParticleBvh build over 1k to 1M triangles, particle sized and long segment queries in rays/sec over 1 and 4 threads
+void RunCollisionSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//ParticleDistanceField bake over 1 and 4 threads, cache load against bake, and the collision affector against the bvh one
+void RunDistanceFieldSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//ParticleDepthSorter full radix sorts at 100k and 1M over 1 and 4 threads against std::sort, and frame to frame repairs
+void RunSortSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//compact against ring ParticleStorage at 100k and 1M live particles: simulate and build ms, ring output over 1 and 4 threads
+void RunStorageSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//every kernel variant built in (baseline, SSE4.1, AVX2, AVX-512) this cpu runs: update, vertex build and sort key ns per
+//particle on the same frames, which one startup picked, and that all of them write the same bits
+void RunKernelDispatchSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//analytic storage (spawn time and seed only) against compact and ring storage: state bytes per particle, simulate and
+//build ms, a sorted frame, and that threaded evaluation writes the same bits
+void RunAnalyticSuite(const BenchmarkOptions& options, BenchmarkReport& report);
+
+//Prewarm of a force driven and an analytic emitter over 1, 10 and 1000 lifetimes: cost, against stepping frame by frame
+//over the first lifetime, with the difference in live particles and in the smoke's centroid
+void RunPrewarmSuite(const BenchmarkOptions& options, BenchmarkReport& report);
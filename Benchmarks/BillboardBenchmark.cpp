@@ -0,0 +1,81 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleKernels.h"
+#include"ParticleCore/ParticleSimulation.h"
+#include<algorithm>
+#include<cmath>
+#include<memory>
+
+namespace
+{
+	const float lifetime = 0.25f;
+
+	std::unique_ptr<ParticleSimulation> CreateSimulation(int count)
+	{
+		return std::make_unique<ParticleSimulation>(Float3{ 1.2f, 1.1f, 1.9f }, Float3{ 0.02f, 0.2f, 0.1f },
+			count, lifetime, lifetime / count, 0.05f, 1.0f, Float4{ 0.0f, 0.0f, 0.0f, 1.0f }, Float4{ 1.0f, 1.0f, 1.0f, 0.0f });
+	}
+
+	//largest distance between the CPU quad corners and the instance expansion the vertex shader mirrors
+	double MaxCornerError(const ParticleSimulation& simulation, Float3 cameraRight, Float3 cameraUp)
+	{
+		double maxError = 0.0;
+		const ParticleVertex* vertices = simulation.GetVertices();
+		const ParticleInstance* instances = simulation.GetInstances();
+		for (int i = 0; i < simulation.GetParticleCount(); i++)
+		{
+			for (int corner = 0; corner < 4; corner++)
+			{
+				Float3 expanded = ExpandParticleInstance(instances[i], cameraRight, cameraUp, corner);
+				const Float3& built = vertices[i * 4 + corner].Position;
+				double dx = expanded.x - built.x;
+				double dy = expanded.y - built.y;
+				double dz = expanded.z - built.z;
+				maxError = std::max(maxError, std::sqrt(dx * dx + dy * dy + dz * dz));
+			}
+		}
+		return maxError;
+	}
+}
+
+void RunBillboardSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	//tilted camera so both axes have 3 non zero components
+	const Float3 cameraRight = { 0.8f, 0.0f, -0.6f };
+	const Float3 cameraUp = { 0.36f, 0.8f, 0.48f };
+	const int warmupFrames = (int)(lifetime / options.dt) + 2;
+
+	for (int count = 1000; count <= options.maxCount; count *= 10)
+	{
+		auto simulation = CreateSimulation(count);
+		for (int f = 0; f < warmupFrames; f++)
+		{
+			simulation->Simulate(options.dt);
+		}
+
+		//time only the build stage, the simulation state is the same for both paths
+		BenchmarkTimer quadTimer;
+		for (int f = 0; f < options.frames; f++)
+		{
+			simulation->BuildVertices(cameraRight, cameraUp);
+		}
+		double quadSeconds = quadTimer.ElapsedSeconds() / options.frames;
+
+		BenchmarkTimer instanceTimer;
+		for (int f = 0; f < options.frames; f++)
+		{
+			simulation->BuildInstances();
+		}
+		double instanceSeconds = instanceTimer.ElapsedSeconds() / options.frames;
+
+		int alive = simulation->GetParticleCount();
+		BenchmarkResult result = { "billboard", std::to_string(count) };
+		result.Set("particles", alive);
+		result.Set("quad_ms", quadSeconds * 1.0e3);
+		result.Set("instance_ms", instanceSeconds * 1.0e3);
+		result.Set("quad_bytes_per_particle", 4 * sizeof(ParticleVertex));
+		result.Set("instance_bytes_per_particle", sizeof(ParticleInstance));
+		result.Set("upload_bytes_saved", (double)alive * (4 * sizeof(ParticleVertex) - sizeof(ParticleInstance)));
+		result.Set("max_corner_error", MaxCornerError(*simulation, cameraRight, cameraUp));
+		report.Add(result);
+	}
+}
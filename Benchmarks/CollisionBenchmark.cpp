@@ -0,0 +1,199 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleSceneCollisionAffector.h"
+#include"ParticleCore/ParticleBvh.h"
+#include"ParticleCore/JobSystem.h"
+#include"ParticleCore/ParticleRandom.h"
+#include<algorithm>
+#include<cmath>
+#include<memory>
+#include<vector>
+
+namespace
+{
+	const int segmentCount = 1 << 18;
+	const int queryChunkSize = 4096;
+
+	//a wavy roof like sheet over [-5, 5]^2 with side x side quads
+	void MakeSheet(int side, std::vector<Float3>& positions, std::vector<unsigned int>& indices)
+	{
+		for (int z = 0; z <= side; z++)
+		{
+			for (int x = 0; x <= side; x++)
+			{
+				float px = -5.0f + 10.0f * x / side;
+				float pz = -5.0f + 10.0f * z / side;
+				positions.push_back({ px, 1.5f + 0.5f * std::sin(px * 1.3f) * std::cos(pz * 0.7f), pz });
+			}
+		}
+		for (int z = 0; z < side; z++)
+		{
+			for (int x = 0; x < side; x++)
+			{
+				unsigned int i = z * (side + 1) + x;
+				unsigned int quad[6] = { i, i + side + 1, i + 1, i + 1, i + side + 1, i + side + 2 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	//closest hit by testing every triangle, to check the tree against
+	bool BruteForce(const std::vector<Float3>& positions, const std::vector<unsigned int>& indices, Float3 start, Float3 end, float& tBest)
+	{
+		Float3 d = { end.x - start.x, end.y - start.y, end.z - start.z };
+		tBest = 1.0f;
+		bool hit = false;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			Float3 a = positions[indices[i]], b = positions[indices[i + 1]], c = positions[indices[i + 2]];
+			Float3 e1 = { b.x - a.x, b.y - a.y, b.z - a.z };
+			Float3 e2 = { c.x - a.x, c.y - a.y, c.z - a.z };
+			Float3 p = { d.y * e2.z - d.z * e2.y, d.z * e2.x - d.x * e2.z, d.x * e2.y - d.y * e2.x };
+			float det = e1.x * p.x + e1.y * p.y + e1.z * p.z;
+			if (std::fabs(det) < 1.0e-12f)
+				continue;
+			float inv = 1.0f / det;
+			Float3 s = { start.x - a.x, start.y - a.y, start.z - a.z };
+			float u = (s.x * p.x + s.y * p.y + s.z * p.z) * inv;
+			if (u < 0.0f || u > 1.0f)
+				continue;
+			Float3 q = { s.y * e1.z - s.z * e1.y, s.z * e1.x - s.x * e1.z, s.x * e1.y - s.y * e1.x };
+			float v = (d.x * q.x + d.y * q.y + d.z * q.z) * inv;
+			if (v < 0.0f || u + v > 1.0f)
+				continue;
+			float t = (e2.x * q.x + e2.y * q.y + e2.z * q.z) * inv;
+			if (t >= 0.0f && t < tBest)
+			{
+				tBest = t;
+				hit = true;
+			}
+		}
+		return hit;
+	}
+}
+
+void RunCollisionSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	const int sides[4] = { 22, 71, 224, 708 };
+
+	std::vector<float> startX(segmentCount), startY(segmentCount), startZ(segmentCount);
+	std::vector<float> directionX(segmentCount), directionY(segmentCount), directionZ(segmentCount);
+	std::vector<float> endX(segmentCount), endY(segmentCount), endZ(segmentCount);
+	std::vector<ParticleBvhHit> hits(segmentCount);
+	ParticleRandom random(18);
+	random.Uniform(startX.data(), segmentCount, -5.0f, 5.0f);
+	random.Uniform(startY.data(), segmentCount, 0.0f, 3.0f);
+	random.Uniform(startZ.data(), segmentCount, -5.0f, 5.0f);
+	random.InSphere(directionX.data(), directionY.data(), directionZ.data(), segmentCount, 1.0f);
+
+	for (int side : sides)
+	{
+		std::vector<Float3> positions;
+		std::vector<unsigned int> indices;
+		MakeSheet(side, positions, indices);
+
+		ParticleBvh bvh;
+		BenchmarkTimer buildTimer;
+		bvh.AddMesh(positions.data(), (int)positions.size(), indices.data(), (int)indices.size());
+		bvh.Build();
+		double buildSeconds = buildTimer.ElapsedSeconds();
+
+		//a particle step (a few cm) and a long ray across the scene
+		const float lengths[2] = { 0.02f, 5.0f };
+		const char* lengthNames[2] = { "step", "long" };
+		for (int l = 0; l < 2; l++)
+		{
+			for (int i = 0; i < segmentCount; i++)
+			{
+				endX[i] = startX[i] + directionX[i] * lengths[l];
+				endY[i] = startY[i] + directionY[i] * lengths[l];
+				endZ[i] = startZ[i] + directionZ[i] * lengths[l];
+			}
+
+			for (int threads : { 1, 4 })
+			{
+				JobSystem jobs(threads - 1);
+				BenchmarkTimer timer;
+				for (int f = 0; f < options.frames; f++)
+				{
+					jobs.ParallelFor(segmentCount, queryChunkSize, [&](int begin, int end) {
+						bvh.IntersectSegments(startX.data() + begin, startY.data() + begin, startZ.data() + begin,
+							endX.data() + begin, endY.data() + begin, endZ.data() + begin, end - begin, hits.data() + begin);
+					});
+				}
+				double seconds = timer.ElapsedSeconds() / options.frames;
+				int hitCount = (int)std::count_if(hits.begin(), hits.end(), [](const ParticleBvhHit& h) { return h.hit; });
+
+				BenchmarkResult result = { "collision", std::to_string(bvh.GetTriangleCount()) + "_tris/" + lengthNames[l] + "/" + std::to_string(threads) + "_threads" };
+				result.Set("triangles", bvh.GetTriangleCount());
+				result.Set("nodes", bvh.GetNodeCount());
+				result.Set("memory_bytes", (double)bvh.GetMemoryBytes());
+				result.Set("build_ms", buildSeconds * 1.0e3);
+				result.Set("threads", threads);
+				result.Set("rays_per_second", segmentCount / seconds);
+				result.Set("hit_fraction", (double)hitCount / segmentCount);
+
+				//the tree must find the same closest hit as testing every triangle, checked on the small scenes only
+				if (threads == 1 && side <= 71)
+				{
+					int mismatches = 0;
+					for (int i = 0; i < segmentCount; i += 64)
+					{
+						float t;
+						bool hit = BruteForce(positions, indices, { startX[i], startY[i], startZ[i] }, { endX[i], endY[i], endZ[i] }, t);
+						if (hit != hits[i].hit || (hit && std::fabs(t - hits[i].t) > 1.0e-5f))
+							mismatches++;
+					}
+					result.Set("brute_force_mismatches", mismatches);
+				}
+				report.Add(result);
+			}
+		}
+	}
+
+	//the whole SceneCollisionAffector path, particles drifting upwards under the mid size sheet
+	{
+		std::vector<Float3> positions;
+		std::vector<unsigned int> indices;
+		MakeSheet(224, positions, indices);
+		auto bvh = std::make_shared<ParticleBvh>();
+		bvh->AddMesh(positions.data(), (int)positions.size(), indices.data(), (int)indices.size());
+		bvh->Build();
+
+		const int count = std::min(1000000, options.maxCount);
+		ParticleData particles(count);
+		ParticleRandom particleRandom(19);
+		particleRandom.Uniform(particles.PositionX, count, -5.0f, 5.0f);
+		particleRandom.Uniform(particles.PositionY, count, 0.01f, 0.1f);
+		particleRandom.Uniform(particles.VelocityY, count, 0.5f, 1.5f);
+		//start every particle 1 to 10 cm under the sheet (well past its chord error), rising into it within the timed frames
+		auto sheetHeight = [](float x, float z) { return 1.5f + 0.5f * std::sin(x * 1.3f) * std::cos(z * 0.7f); };
+		for (int i = 0; i < count; i++)
+		{
+			particles.PositionY[i] = sheetHeight(particles.PositionX[i], particles.PositionZ[i]) - particles.PositionY[i];
+		}
+
+		ParticleAffectorPipeline<SceneCollisionAffector> collision(SceneCollisionAffector(bvh, 0.1f, 0.3f));
+		BenchmarkTimer timer;
+		for (int f = 0; f < options.frames; f++)
+		{
+			collision.Run(particles, 0, count, options.dt);
+		}
+		double seconds = timer.ElapsedSeconds() / options.frames;
+
+		//nothing may tunnel through the sheet
+		int tunneled = 0;
+		for (int i = 0; i < count; i++)
+		{
+			if (particles.PositionY[i] > sheetHeight(particles.PositionX[i], particles.PositionZ[i]) + 1.0e-3f)
+				tunneled++;
+		}
+
+		BenchmarkResult result = { "collision", "affector/" + std::to_string(count) };
+		result.Set("particles", count);
+		result.Set("triangles", bvh->GetTriangleCount());
+		result.Set("ms_per_frame", seconds * 1.0e3);
+		result.Set("ns_per_particle", seconds * 1.0e9 / count);
+		result.Set("tunneled", tunneled);
+		report.Add(result);
+	}
+}
@@ -0,0 +1,69 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleKernels.h"
+#include"ParticleCore/ParticleRandom.h"
+#include<memory>
+
+namespace
+{
+	//keys spread over life with a zig zag, smooth so baking does the most work
+	ParticleCurve CreateCurve(int keyCount)
+	{
+		if (keyCount <= 2)
+			return ParticleCurve::Linear(0.05f, 1.0f);
+
+		ParticleCurve curve;
+		for (int k = 0; k < keyCount; k++)
+		{
+			curve.AddKey((float)k / (keyCount - 1), (k % 2) ? 1.0f : 0.25f);
+		}
+		return curve;
+	}
+
+	ParticleGradient CreateGradient(int keyCount)
+	{
+		ParticleGradient gradient(CurveInterpolation::Smooth);
+		gradient.red = CreateCurve(keyCount);
+		gradient.green = CreateCurve(keyCount);
+		gradient.blue = CreateCurve(keyCount);
+		gradient.alpha = CreateCurve(keyCount);
+		return gradient;
+	}
+}
+
+void RunCurveSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	const float lifetime = 10.0f;
+	const int keyCounts[3] = { 2, 8, 64 };
+
+	for (int count = 10000; count <= options.maxCount; count *= 10)
+	{
+		for (int keyCount : keyCounts)
+		{
+			ParticleData particles(count);
+			ParticleRandom random(9);
+			random.Uniform(particles.Age, count, 0.0f, lifetime);
+
+			BenchmarkTimer bakeTimer;
+			auto tables = std::make_unique<ParticleLifeTables>();
+			tables->Bake(CreateCurve(keyCount), CreateGradient(keyCount));
+			double bakeSeconds = bakeTimer.ElapsedSeconds();
+
+			ParticleUpdateParams params = { lifetime, tables.get() };
+			BenchmarkTimer timer;
+			for (int f = 0; f < options.frames; f++)
+			{
+				UpdateParticleData(particles, 0, count, options.dt, params);
+			}
+			double seconds = timer.ElapsedSeconds() / options.frames;
+
+			//per frame cost should not move with the key count, only the one time bake does
+			BenchmarkResult result = { "curves", std::to_string(keyCount) + "_keys/" + std::to_string(count) };
+			result.Set("particles", count);
+			result.Set("keys", keyCount);
+			result.Set("bake_us", bakeSeconds * 1.0e6);
+			result.Set("ms_per_frame", seconds * 1.0e3);
+			result.Set("ns_per_particle", seconds * 1.0e9 / count);
+			report.Add(result);
+		}
+	}
+}
@@ -0,0 +1,99 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleDensityVolume.h"
+#include"ParticleCore/ParticleRandom.h"
+#include<algorithm>
+#include<cstring>
+#include<memory>
+#include<vector>
+
+namespace
+{
+	const float voxelSize = 0.05f;
+
+	//a 6 unit smoke column widening with height, somewhere inside a large scene
+	void FillPlume(ParticleData& particles, int count)
+	{
+		ParticleRandom random(17);
+		random.Uniform(particles.PositionY, count, 0.0f, 6.0f);
+		random.Normal(particles.PositionX, count, 0.0f, 1.0f);
+		random.Normal(particles.PositionZ, count, 0.0f, 1.0f);
+		random.Uniform(particles.ColorA, count, 0.2f, 1.0f);
+		for (int i = 0; i < count; i++)
+		{
+			float spread = 0.1f + 0.1f * particles.PositionY[i];
+			particles.PositionX[i] = 12.0f + particles.PositionX[i] * spread;
+			particles.PositionZ[i] = -7.0f + particles.PositionZ[i] * spread;
+		}
+	}
+}
+
+void RunDensitySuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	const int threadCounts[2] = { 1, 4 };
+
+	for (int count = 10000; count <= std::min(options.maxCount, 1000000); count *= 10)
+	{
+		ParticleData particles(count);
+		FillPlume(particles, count);
+
+		std::vector<float> reference(count);
+		std::vector<float> sampled(count);
+		double singleThreadSeconds = 0.0;
+
+		for (int threads : threadCounts)
+		{
+			ParticleDensityVolume volume(voxelSize);
+			if (threads > 1)
+				volume.SetJobSystem(std::make_shared<JobSystem>(threads - 1));
+
+			//first splat allocates the bricks, the timed ones reuse them like a running emitter does
+			volume.Splat(particles, count);
+			BenchmarkTimer timer;
+			for (int f = 0; f < options.frames; f++)
+			{
+				volume.Splat(particles, count);
+			}
+			double seconds = timer.ElapsedSeconds() / options.frames;
+
+			BenchmarkTimer sampleTimer;
+			volume.Sample(particles.PositionX, particles.PositionY, particles.PositionZ, sampled.data(), count);
+			double sampleSeconds = sampleTimer.ElapsedSeconds();
+
+			//chunks merge in a fixed order, so the density must not change with the thread count
+			bool match = true;
+			if (threads == 1)
+			{
+				reference = sampled;
+				singleThreadSeconds = seconds;
+			}
+			else
+			{
+				match = std::memcmp(reference.data(), sampled.data(), sizeof(float) * count) == 0;
+			}
+
+			//a dense grid over the particles' bounds, at the same voxel size
+			float minX = *std::min_element(particles.PositionX, particles.PositionX + count);
+			float maxX = *std::max_element(particles.PositionX, particles.PositionX + count);
+			float minY = *std::min_element(particles.PositionY, particles.PositionY + count);
+			float maxY = *std::max_element(particles.PositionY, particles.PositionY + count);
+			float minZ = *std::min_element(particles.PositionZ, particles.PositionZ + count);
+			float maxZ = *std::max_element(particles.PositionZ, particles.PositionZ + count);
+			double denseVoxels = (double)((maxX - minX) / voxelSize + 2.0f) * ((maxY - minY) / voxelSize + 2.0f) * ((maxZ - minZ) / voxelSize + 2.0f);
+
+			BenchmarkResult result = { "density", std::to_string(threads) + "_threads/" + std::to_string(count) };
+			result.Set("particles", count);
+			result.Set("threads", threads);
+			result.Set("bricks", volume.GetBrickCount());
+			result.Set("memory_bytes", (double)volume.GetMemoryBytes());
+			result.Set("bytes_per_brick", (double)volume.GetMemoryBytes() / std::max(1, volume.GetBrickCount()));
+			result.Set("scratch_bytes", (double)volume.GetScratchBytes());
+			result.Set("dense_bytes", denseVoxels * sizeof(float));
+			result.Set("splat_ms", seconds * 1.0e3);
+			result.Set("splat_ns_per_particle", seconds * 1.0e9 / count);
+			result.Set("speedup", singleThreadSeconds / seconds);
+			result.Set("sample_ns", sampleSeconds * 1.0e9 / count);
+			result.Set("bitwise_match", match ? 1.0 : 0.0);
+			report.Add(result);
+		}
+	}
+}
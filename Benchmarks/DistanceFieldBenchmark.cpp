@@ -0,0 +1,213 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleDistanceFieldAffector.h"
+#include"ParticleCore/ParticleSceneCollisionAffector.h"
+#include"ParticleCore/ParticleBvh.h"
+#include"ParticleCore/ParticleDistanceField.h"
+#include"ParticleCore/JobSystem.h"
+#include"ParticleCore/ParticleRandom.h"
+#include<algorithm>
+#include<cmath>
+#include<cstdio>
+#include<cstring>
+#include<memory>
+#include<vector>
+
+namespace
+{
+	const char* cachePath = "benchmark_sdf.bin";
+
+	//the wavy sheet of the collision suite, facing up
+	void MakeSheet(int side, std::vector<Float3>& positions, std::vector<unsigned int>& indices)
+	{
+		for (int z = 0; z <= side; z++)
+		{
+			for (int x = 0; x <= side; x++)
+			{
+				float px = -5.0f + 10.0f * x / side;
+				float pz = -5.0f + 10.0f * z / side;
+				positions.push_back({ px, 1.5f + 0.5f * std::sin(px * 1.3f) * std::cos(pz * 0.7f), pz });
+			}
+		}
+		for (int z = 0; z < side; z++)
+		{
+			for (int x = 0; x < side; x++)
+			{
+				unsigned int i = z * (side + 1) + x;
+				unsigned int quad[6] = { i, i + side + 1, i + 1, i + 1, i + side + 1, i + side + 2 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	float SheetHeight(float x, float z)
+	{
+		return 1.5f + 0.5f * std::sin(x * 1.3f) * std::cos(z * 0.7f);
+	}
+
+	//particles 1 to 10 cm over the sheet, falling into it
+	void MakeFallingParticles(ParticleData& particles, int count)
+	{
+		ParticleRandom random(20);
+		random.Uniform(particles.PositionX, count, -5.0f, 5.0f);
+		random.Uniform(particles.PositionY, count, 0.01f, 0.1f);
+		random.Uniform(particles.PositionZ, count, -5.0f, 5.0f);
+		random.Uniform(particles.VelocityY, count, -1.5f, -0.5f);
+		std::fill(particles.VelocityX, particles.VelocityX + count, 0.0f);
+		std::fill(particles.VelocityZ, particles.VelocityZ + count, 0.0f);
+		for (int i = 0; i < count; i++)
+		{
+			particles.PositionY[i] += SheetHeight(particles.PositionX[i], particles.PositionZ[i]);
+		}
+	}
+
+	int CountTunneled(const ParticleData& particles, int count)
+	{
+		int tunneled = 0;
+		for (int i = 0; i < count; i++)
+		{
+			if (particles.PositionY[i] < SheetHeight(particles.PositionX[i], particles.PositionZ[i]) - 1.0e-3f)
+				tunneled++;
+		}
+		return tunneled;
+	}
+}
+
+void RunDistanceFieldSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	std::vector<Float3> positions;
+	std::vector<unsigned int> indices;
+	MakeSheet(224, positions, indices);
+	auto bvh = std::make_shared<ParticleBvh>();
+	bvh->AddMesh(positions.data(), (int)positions.size(), indices.data(), (int)indices.size());
+	bvh->Build();
+
+	const int bandCells = 4;
+	for (int resolution : { 64, 128, 256 })
+	{
+		std::vector<float> reference;
+		for (int threads : { 1, 4 })
+		{
+			ParticleDistanceField field;
+			if (threads > 1)
+				field.SetJobSystem(std::make_shared<JobSystem>(threads - 1));
+			BenchmarkTimer timer;
+			field.Bake(*bvh, resolution, bandCells);
+			double bakeSeconds = timer.ElapsedSeconds();
+
+			//the bake is compared through sampled values on a fixed set of points
+			std::vector<float> values;
+			ParticleRandom random(21);
+			const int probeCount = 1 << 14;
+			std::vector<float> px(probeCount), py(probeCount), pz(probeCount);
+			random.Uniform(px.data(), probeCount, -5.5f, 5.5f);
+			random.Uniform(py.data(), probeCount, 0.5f, 2.5f);
+			random.Uniform(pz.data(), probeCount, -5.5f, 5.5f);
+			float simdMaxError = 0.0f;
+			for (int i = 0; i + PARTICLE_SIMD_WIDTH <= probeCount; i += PARTICLE_SIMD_WIDTH)
+			{
+				SimdFloat gx, gy, gz;
+				alignas(64) float lane[4][PARTICLE_SIMD_WIDTH];
+				SimdStore(lane[0], field.Sample(SimdLoadUnaligned(&px[i]), SimdLoadUnaligned(&py[i]), SimdLoadUnaligned(&pz[i]), gx, gy, gz));
+				SimdStore(lane[1], gx);
+				SimdStore(lane[2], gy);
+				SimdStore(lane[3], gz);
+				for (int l = 0; l < PARTICLE_SIMD_WIDTH; l++)
+				{
+					Float3 gradient;
+					float d = field.Sample(Float3{ px[i + l], py[i + l], pz[i + l] }, gradient);
+					values.push_back(d);
+					simdMaxError = std::max(simdMaxError, std::fabs(d - lane[0][l]));
+					simdMaxError = std::max(simdMaxError, std::fabs(gradient.x - lane[1][l]));
+					simdMaxError = std::max(simdMaxError, std::fabs(gradient.y - lane[2][l]));
+					simdMaxError = std::max(simdMaxError, std::fabs(gradient.z - lane[3][l]));
+				}
+			}
+			if (threads == 1)
+				reference = values;
+
+			BenchmarkResult result = { "sdf", "bake/" + std::to_string(resolution) + "/" + std::to_string(threads) + "_threads" };
+			result.Set("triangles", bvh->GetTriangleCount());
+			result.Set("samples", (double)field.GetSizeX() * field.GetSizeY() * field.GetSizeZ());
+			result.Set("memory_bytes", (double)field.GetMemoryBytes());
+			result.Set("voxel_size", field.GetVoxelSize());
+			result.Set("threads", threads);
+			result.Set("bake_ms", bakeSeconds * 1.0e3);
+			result.Set("simd_max_error", simdMaxError);
+			result.Set("bitwise_match", values.size() == reference.size() &&
+				std::memcmp(values.data(), reference.data(), values.size() * sizeof(float)) == 0 ? 1 : 0);
+			report.Add(result);
+		}
+	}
+
+	//cold bake and write against loading the cache, and a changed mesh must miss the cache
+	{
+		std::remove(cachePath);
+		ParticleDistanceField baked;
+		BenchmarkTimer bakeTimer;
+		bool bakedLoaded = baked.LoadOrBake(cachePath, *bvh, 128, bandCells);
+		double bakeSeconds = bakeTimer.ElapsedSeconds();
+
+		ParticleDistanceField loaded;
+		BenchmarkTimer loadTimer;
+		bool loadedLoaded = loaded.LoadOrBake(cachePath, *bvh, 128, bandCells);
+		double loadSeconds = loadTimer.ElapsedSeconds();
+
+		ParticleBvh moved;
+		std::vector<Float3> shifted = positions;
+		shifted[0].y += 0.01f;
+		moved.AddMesh(shifted.data(), (int)shifted.size(), indices.data(), (int)indices.size());
+		moved.Build();
+		ParticleDistanceField stale;
+		bool staleLoaded = stale.Load(cachePath, moved, 128, bandCells);
+		std::remove(cachePath);
+
+		BenchmarkResult result = { "sdf", "cache/128" };
+		result.Set("bake_and_save_ms", bakeSeconds * 1.0e3);
+		result.Set("load_ms", loadSeconds * 1.0e3);
+		result.Set("first_run_loaded", bakedLoaded ? 1 : 0);
+		result.Set("second_run_loaded", loadedLoaded ? 1 : 0);
+		result.Set("changed_mesh_loaded", staleLoaded ? 1 : 0);
+		report.Add(result);
+	}
+
+	//DistanceFieldCollisionAffector against SceneCollisionAffector on the same particles falling onto the sheet
+	{
+		auto field = std::make_shared<ParticleDistanceField>();
+		field->Bake(*bvh, 128, bandCells);
+
+		const int count = std::min(1000000, options.maxCount);
+		ParticleData particles(count);
+		for (int collider = 0; collider < 2; collider++)
+		{
+			MakeFallingParticles(particles, count);
+			double seconds;
+			if (collider == 0)
+			{
+				ParticleAffectorPipeline<DistanceFieldCollisionAffector> collision(DistanceFieldCollisionAffector(field, 0.01f, 0.1f, 0.3f));
+				BenchmarkTimer timer;
+				for (int f = 0; f < options.frames; f++)
+				{
+					collision.Run(particles, 0, count, options.dt);
+				}
+				seconds = timer.ElapsedSeconds() / options.frames;
+			}
+			else
+			{
+				ParticleAffectorPipeline<SceneCollisionAffector> collision(SceneCollisionAffector(bvh, 0.1f, 0.3f));
+				BenchmarkTimer timer;
+				for (int f = 0; f < options.frames; f++)
+				{
+					collision.Run(particles, 0, count, options.dt);
+				}
+				seconds = timer.ElapsedSeconds() / options.frames;
+			}
+
+			BenchmarkResult result = { "sdf", std::string(collider == 0 ? "affector_sdf/" : "affector_bvh/") + std::to_string(count) };
+			result.Set("particles", count);
+			result.Set("ms_per_frame", seconds * 1.0e3);
+			result.Set("ns_per_particle", seconds * 1.0e9 / count);
+			result.Set("tunneled", CountTunneled(particles, count));
+			report.Add(result);
+		}
+	}
+}
@@ -0,0 +1,98 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleEmissionShape.h"
+#include"ParticleCore/ParticleSimulation.h"
+#include<algorithm>
+#include<vector>
+
+namespace
+{
+	//flat grid of cells * cells quads (2 triangles each) in the xz plane, cell sizes vary so the areas differ
+	ParticleEmissionShape CreateGridShape(int cells)
+	{
+		std::vector<Float3> positions;
+		std::vector<float> coordinates(cells + 1);
+		float c = 0.0f;
+		for (int i = 0; i <= cells; i++)
+		{
+			coordinates[i] = c;
+			c += 1.0f + (i % 7) * 0.25f;
+		}
+		for (int z = 0; z <= cells; z++)
+		{
+			for (int x = 0; x <= cells; x++)
+			{
+				positions.push_back(Float3{ coordinates[x], 0.0f, coordinates[z] });
+			}
+		}
+
+		std::vector<unsigned int> indices;
+		for (int z = 0; z < cells; z++)
+		{
+			for (int x = 0; x < cells; x++)
+			{
+				unsigned int i = z * (cells + 1) + x;
+				indices.insert(indices.end(), { i, i + (unsigned int)cells + 1, i + 1, i + 1, i + (unsigned int)cells + 1, i + (unsigned int)cells + 2 });
+			}
+		}
+		return ParticleEmissionShape::MeshSurface(positions.data(), indices.data(), (int)indices.size());
+	}
+
+	void RunShape(const char* name, const ParticleEmissionShape& shape, int count, const BenchmarkOptions& options, BenchmarkReport& report)
+	{
+		std::vector<float> x(count), y(count), z(count);
+		ParticleRandom random(1);
+
+		BenchmarkTimer timer;
+		for (int f = 0; f < options.frames; f++)
+		{
+			shape.Sample(random, x.data(), y.data(), z.data(), count);
+		}
+		double seconds = timer.ElapsedSeconds() / options.frames;
+
+		BenchmarkResult result = { "emission", std::string(name) + "/" + std::to_string(count) };
+		result.Set("samples", count);
+		result.Set("triangles", shape.GetTriangleCount());
+		result.Set("ns_per_sample", seconds * 1.0e9 / count);
+		result.Set("samples_per_sec", count / seconds);
+		report.Add(result);
+	}
+}
+
+void RunEmissionSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	//one burst of this size per shape
+	const int count = std::min(100000, options.maxCount);
+
+	RunShape("point", ParticleEmissionShape::Point(), count, options, report);
+	RunShape("sphere", ParticleEmissionShape::Sphere(1.0f), count, options, report);
+	RunShape("cone", ParticleEmissionShape::Cone(Float3{ 0.0f, 1.0f, 0.0f }, 0.5f, 1.0f), count, options, report);
+	RunShape("box", ParticleEmissionShape::Box(Float3{ 1.0f, 1.0f, 1.0f }), count, options, report);
+	RunShape("disc", ParticleEmissionShape::Disc(Float3{ 0.0f, 1.0f, 0.0f }, 1.0f), count, options, report);
+
+	//alias table sampling, ns_per_sample should stay flat as the triangle count grows
+	for (int cells = 8; cells <= 1024; cells *= 4)
+	{
+		std::string name = "mesh_" + std::to_string(2 * cells * cells) + "tris";
+		RunShape(name.c_str(), CreateGridShape(cells), count, options, report);
+	}
+
+	//scheduler: a steady frame, then a hitch 10 lifetimes long that must only spawn the last lifetime's worth
+	const float lifetime = 0.25f;
+	const float hitch = 10.0f * lifetime;
+	ParticleSimulation simulation(Float3{ 0.0f, 0.0f, 0.0f }, Float3{ 0.02f, 0.2f, 0.1f }, count, lifetime, lifetime / count,
+		0.05f, 1.0f, Float4{ 0.0f, 0.0f, 0.0f, 1.0f }, Float4{ 1.0f, 1.0f, 1.0f, 0.0f });
+	const float frameTimes[2] = { options.dt, hitch };
+	const char* frameNames[2] = { "steady", "hitch" };
+	for (int f = 0; f < 2; f++)
+	{
+		BenchmarkTimer timer;
+		simulation.Simulate(frameTimes[f]);
+		double seconds = timer.ElapsedSeconds();
+
+		BenchmarkResult result = { "emission", std::string("schedule_") + frameNames[f] + "/" + std::to_string(count) };
+		result.Set("frame_seconds", frameTimes[f]);
+		result.Set("alive", simulation.GetParticleCount());
+		result.Set("ms_per_frame", seconds * 1.0e3);
+		report.Add(result);
+	}
+}
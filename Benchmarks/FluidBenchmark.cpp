@@ -0,0 +1,151 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleFluidAdvectionAffector.h"
+#include"ParticleCore/ParticleRandom.h"
+#include<algorithm>
+#include<cmath>
+#include<cstring>
+#include<memory>
+#include<thread>
+
+namespace
+{
+	//a chimney plume: hot smoky source low in a 4 unit box
+	std::shared_ptr<ParticleFluidSolver> CreateSolver(int resolution, int threads)
+	{
+		auto solver = std::make_shared<ParticleFluidSolver>(Float3{ 0.0f, 2.0f, 0.0f }, 4.0f, resolution);
+		solver->SetSource(Float3{ 0.0f, 0.4f, 0.0f }, 0.3f, 2.0f, 4.0f, Float3{ 0.0f, 0.5f, 0.0f });
+		if (threads > 1)
+			solver->SetJobSystem(std::make_shared<JobSystem>(threads - 1));
+		return solver;
+	}
+}
+
+void RunFluidSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	const int resolutions[4] = { 32, 64, 96, 128 };
+	const int warmupSteps = 3;
+	int hardwareThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	//always split at least 4 ways so the slab split is checked on small machines too
+	const int threadCounts[2] = { 1, std::max(4, hardwareThreads) };
+
+	for (int resolution : resolutions)
+	{
+		size_t cells = (size_t)resolution * resolution * resolution;
+		std::vector<float> reference;
+		double singleThreadSeconds = 0.0;
+
+		for (int t = 0; t < 2; t++)
+		{
+			int threads = threadCounts[t];
+			auto solver = CreateSolver(resolution, threads);
+			for (int s = 0; s < warmupSteps; s++)
+			{
+				solver->Step(options.dt);
+			}
+
+			BenchmarkTimer timer;
+			for (int f = 0; f < options.frames; f++)
+			{
+				solver->Step(options.dt);
+			}
+			double seconds = timer.ElapsedSeconds() / options.frames;
+
+			//slabs only write their own cells, so the split must not change a bit
+			bool match = true;
+			if (threads == 1)
+			{
+				reference.assign(solver->GetDensity(), solver->GetDensity() + cells);
+				singleThreadSeconds = seconds;
+			}
+			else
+			{
+				match = std::memcmp(reference.data(), solver->GetDensity(), cells * sizeof(float)) == 0;
+			}
+
+			BenchmarkResult result = { "fluid", std::to_string(resolution) + "^3/" + std::to_string(threads) + "_threads" };
+			result.Set("resolution", resolution);
+			result.Set("threads", threads);
+			result.Set("pressure_iterations", solver->GetPressureIterations());
+			result.Set("ms_per_step", seconds * 1.0e3);
+			result.Set("ns_per_cell", seconds * 1.0e9 / cells);
+			result.Set("speedup", singleThreadSeconds / seconds);
+			result.Set("bitwise_match", match ? 1.0 : 0.0);
+			report.Add(result);
+		}
+	}
+
+	//the budget retunes the pressure solve until a step costs about the target
+	for (int resolution : { 32, 64 })
+	{
+		const float budget = 8.0f;
+		auto solver = CreateSolver(resolution, hardwareThreads);
+		solver->SetStepBudget(budget);
+		for (int s = 0; s < warmupSteps + options.frames; s++)
+		{
+			solver->Step(options.dt);
+		}
+
+		BenchmarkResult result = { "fluid", "budget/" + std::to_string(resolution) + "^3" };
+		result.Set("resolution", resolution);
+		result.Set("budget_ms", budget);
+		result.Set("pressure_iterations", solver->GetPressureIterations());
+		result.Set("last_step_ms", solver->GetLastStepMilliseconds());
+		report.Add(result);
+	}
+
+	//cost of carrying particles by the grid's velocity
+	{
+		auto solver = CreateSolver(64, 1);
+		for (int s = 0; s < warmupSteps; s++)
+		{
+			solver->Step(options.dt);
+		}
+
+		const int count = std::min(1000000, options.maxCount);
+		ParticleData particles(count);
+		ParticleRandom random(16);
+		random.Uniform(particles.PositionX, count, -2.5f, 2.5f);
+		random.Uniform(particles.PositionY, count, -0.5f, 4.5f);
+		random.Uniform(particles.PositionZ, count, -2.5f, 2.5f);
+
+		//SIMD lookups must agree with the scalar ones bit for bit, including which particles are outside
+		float maxError = 0.0f;
+		for (int i = 0; i + PARTICLE_SIMD_WIDTH <= count; i += PARTICLE_SIMD_WIDTH)
+		{
+			alignas(64) float out[4][PARTICLE_SIMD_WIDTH];
+			SimdFloat vx, vy, vz;
+			SimdFloat inside = solver->Sample(SimdLoad(particles.PositionX + i), SimdLoad(particles.PositionY + i), SimdLoad(particles.PositionZ + i), vx, vy, vz);
+			SimdStore(out[0], vx);
+			SimdStore(out[1], vy);
+			SimdStore(out[2], vz);
+			SimdStore(out[3], inside);
+			for (int l = 0; l < PARTICLE_SIMD_WIDTH; l++)
+			{
+				Float3 v;
+				bool scalarInside = solver->Sample(Float3{ particles.PositionX[i + l], particles.PositionY[i + l], particles.PositionZ[i + l] }, v);
+				bool simdInside = out[3][l] != 0.0f || std::signbit(out[3][l]);
+				if (scalarInside != simdInside)
+					maxError = std::max(maxError, 1.0f);
+				maxError = std::max(maxError, std::fabs(v.x - out[0][l]));
+				maxError = std::max(maxError, std::fabs(v.y - out[1][l]));
+				maxError = std::max(maxError, std::fabs(v.z - out[2][l]));
+			}
+		}
+
+		ParticleAffectorPipeline<FluidAdvectionAffector> advection(FluidAdvectionAffector(solver, 10.0f));
+		BenchmarkTimer timer;
+		for (int f = 0; f < options.frames; f++)
+		{
+			advection.Run(particles, 0, count, options.dt);
+		}
+		double seconds = timer.ElapsedSeconds() / options.frames;
+
+		BenchmarkResult result = { "fluid", "advect/" + std::to_string(count) };
+		result.Set("particles", count);
+		result.Set("resolution", 64);
+		result.Set("ms_per_frame", seconds * 1.0e3);
+		result.Set("ns_per_particle", seconds * 1.0e9 / count);
+		result.Set("simd_max_error", maxError);
+		report.Add(result);
+	}
+}
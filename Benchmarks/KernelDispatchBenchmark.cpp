@@ -0,0 +1,124 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleKernels.h"
+#include"ParticleCore/ParticleRandom.h"
+#include<cstring>
+#include<memory>
+#include<vector>
+
+namespace
+{
+	const float lifetime = 2.0f;
+
+	//streams the kernels write, compared between variants
+	struct KernelOutput
+	{
+		std::vector<float> streams;
+		std::vector<ParticleVertex> vertices;
+		std::vector<uint64_t> keys;
+
+		bool operator==(const KernelOutput& other) const
+		{
+			return streams.size() == other.streams.size() && vertices.size() == other.vertices.size() && keys.size() == other.keys.size() &&
+				std::memcmp(streams.data(), other.streams.data(), streams.size() * sizeof(float)) == 0 &&
+				std::memcmp(vertices.data(), other.vertices.data(), vertices.size() * sizeof(ParticleVertex)) == 0 &&
+				std::memcmp(keys.data(), other.keys.data(), keys.size() * sizeof(uint64_t)) == 0;
+		}
+	};
+
+	void FillParticles(ParticleData& particles, int count)
+	{
+		ParticleRandom random(22);
+		random.Uniform(particles.PositionX, count, -10.0f, 10.0f);
+		random.Uniform(particles.PositionY, count, 0.0f, 10.0f);
+		random.Uniform(particles.PositionZ, count, -10.0f, 10.0f);
+		random.Uniform(particles.VelocityX, count, -1.0f, 1.0f);
+		random.Uniform(particles.VelocityY, count, 0.0f, 2.0f);
+		random.Uniform(particles.VelocityZ, count, -1.0f, 1.0f);
+		random.Uniform(particles.Age, count, 0.0f, lifetime);
+		random.Uniform(particles.Rotation, count, 0.0f, 6.28318530718f);
+	}
+}
+
+void RunKernelDispatchSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	const int count = std::min(1000000, options.maxCount);
+	const Float3 cameraPosition = { 0.0f, 5.0f, -20.0f };
+	const Float3 cameraForward = { 0.0f, 0.0f, 1.0f };
+	const Float3 cameraRight = { 1.0f, 0.0f, 0.0f };
+	const Float3 cameraUp = { 0.0f, 1.0f, 0.0f };
+
+	auto tables = std::make_unique<ParticleLifeTables>();
+	tables->Bake(ParticleCurve::Linear(0.05f, 1.0f), ParticleGradient::Linear(Float4{ 0.0f, 0.0f, 0.0f, 1.0f }, Float4{ 1.0f, 1.0f, 1.0f, 0.0f }));
+	ParticleUpdateParams params = { lifetime, tables.get() };
+
+	const ParticleKernelTable& startup = GetParticleKernels();
+	ParticleData particles(count);
+	std::vector<ParticleVertex> vertices((size_t)count * 4);
+	std::vector<uint64_t> keys(count);
+	//spawn catch up ages, over [1, count) so the runs start and end off the SIMD alignment like real spawn runs
+	std::vector<float> spawnAges(count);
+	ParticleRandom(23).Uniform(spawnAges.data(), count, 0.0f, options.dt);
+
+	KernelOutput reference;
+	double baselineSeconds = 0.0;
+	for (const ParticleKernelTable* kernels : GetParticleKernelVariants())
+	{
+		BenchmarkResult result = { "kernels", std::string(GetParticleIsaName(kernels->isa)) + "/" + std::to_string(count) };
+		result.Set("active_at_startup", kernels == &startup ? 1 : 0);
+		result.Set("supported", IsParticleIsaSupported(kernels->isa) ? 1 : 0);
+		if (!IsParticleIsaSupported(kernels->isa))
+		{
+			report.Add(result);
+			continue;
+		}
+
+		//the same frames through every variant, through the free functions like the simulation calls them
+		SetParticleKernels(*kernels);
+		FillParticles(particles, count);
+		double updateSeconds = 0.0, advanceSeconds = 0.0, buildSeconds = 0.0, keySeconds = 0.0;
+		for (int f = 0; f < options.frames; f++)
+		{
+			BenchmarkTimer updateTimer;
+			UpdateParticleData(particles, 0, count, options.dt, params);
+			updateSeconds += updateTimer.ElapsedSeconds();
+
+			BenchmarkTimer advanceTimer;
+			AdvanceSpawnedParticles(particles, 1, count, spawnAges.data(), params);
+			advanceSeconds += advanceTimer.ElapsedSeconds();
+
+			BenchmarkTimer buildTimer;
+			BuildParticleVertices(particles, 0, count, cameraRight, cameraUp, nullptr, vertices.data());
+			buildSeconds += buildTimer.ElapsedSeconds();
+
+			BenchmarkTimer keyTimer;
+			BuildDepthKeys(particles, nullptr, 0, count, cameraPosition, cameraForward, keys.data());
+			keySeconds += keyTimer.ElapsedSeconds();
+		}
+		updateSeconds /= options.frames;
+		advanceSeconds /= options.frames;
+		buildSeconds /= options.frames;
+		keySeconds /= options.frames;
+
+		KernelOutput output;
+		for (const float* stream : { particles.PositionX, particles.PositionY, particles.PositionZ, particles.Age, particles.Size, particles.ColorR, particles.ColorG, particles.ColorB, particles.ColorA })
+		{
+			output.streams.insert(output.streams.end(), stream, stream + count);
+		}
+		output.vertices = vertices;
+		output.keys = keys;
+		if (kernels == GetParticleKernelVariants()[0])
+		{
+			reference = output;
+			baselineSeconds = updateSeconds + advanceSeconds + buildSeconds + keySeconds;
+		}
+
+		result.Set("update_ns_per_particle", updateSeconds * 1.0e9 / count);
+		result.Set("advance_ns_per_particle", advanceSeconds * 1.0e9 / count);
+		result.Set("build_ns_per_particle", buildSeconds * 1.0e9 / count);
+		result.Set("keys_ns_per_particle", keySeconds * 1.0e9 / count);
+		result.Set("speedup", baselineSeconds / (updateSeconds + advanceSeconds + buildSeconds + keySeconds));
+		result.Set("bitwise_match", output == reference ? 1 : 0);
+		report.Add(result);
+	}
+	SetParticleKernels(startup);
+}
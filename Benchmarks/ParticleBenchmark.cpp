@@ -0,0 +1,86 @@
+// Headless particle benchmark suite, built by the ParticleBenchmark target in CMakeLists.txt.
+//
+// ParticleBenchmark [--filter name] [--max-count n] [--frames n] [--json file]
+
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleKernels.h"
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+
+namespace
+{
+	struct Suite
+	{
+		const char* name;
+		void (*run)(const BenchmarkOptions&, BenchmarkReport&);
+	};
+
+	const Suite suites[] =
+	{
+		{ "throughput", RunThroughputSuite },
+		{ "threads", RunThreadingSuite },
+		{ "billboard", RunBillboardSuite },
+		{ "random", RunRandomSuite },
+		{ "emission", RunEmissionSuite },
+		{ "affectors", RunAffectorSuite },
+		{ "curves", RunCurveSuite },
+		{ "turbulence", RunTurbulenceSuite },
+		{ "fluid", RunFluidSuite },
+		{ "density", RunDensitySuite },
+		{ "collision", RunCollisionSuite },
+		{ "sdf", RunDistanceFieldSuite },
+		{ "sort", RunSortSuite },
+		{ "storage", RunStorageSuite },
+		{ "kernels", RunKernelDispatchSuite },
+		{ "analytic", RunAnalyticSuite },
+		{ "prewarm", RunPrewarmSuite },
+	};
+
+	bool ParseOptions(int argc, char** argv, BenchmarkOptions& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			bool hasValue = i + 1 < argc;
+			if (!strcmp(argv[i], "--filter") && hasValue)
+				options.filter = argv[++i];
+			else if (!strcmp(argv[i], "--max-count") && hasValue)
+				options.maxCount = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--frames") && hasValue)
+				options.frames = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--json") && hasValue)
+				options.jsonPath = argv[++i];
+			else
+				return false;
+		}
+		return options.maxCount > 0 && options.frames > 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		printf("usage: ParticleBenchmark [--filter name] [--max-count n] [--frames n] [--json file]\n");
+		return 1;
+	}
+
+	//kernel variant the simulation suites run with, PARTICLE_KERNELS overrides it
+	options.kernels = GetParticleIsaName(GetParticleKernels().isa);
+	printf("particle kernels: %s\n", options.kernels.c_str());
+
+	BenchmarkReport report;
+	for (const Suite& suite : suites)
+	{
+		if (options.filter.empty() || strstr(suite.name, options.filter.c_str()))
+			suite.run(options, report);
+	}
+
+	if (!options.jsonPath.empty() && !report.WriteJson(options.jsonPath, options))
+	{
+		printf("could not write %s\n", options.jsonPath.c_str());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,98 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleSimulation.h"
+#include<algorithm>
+#include<cmath>
+#include<cstdlib>
+#include<memory>
+
+namespace
+{
+	//the chimney's smoke, fills in over 10 s from a cold start
+	const float lifetime = 10.0f;
+
+	std::unique_ptr<ParticleSimulation> MakeSimulation(int count, ParticleStorage storage)
+	{
+		auto simulation = std::make_unique<ParticleSimulation>(Float3{ 1.2f, 1.1f, 1.9f }, Float3{ 0.02f, 0.2f, 0.1f },
+			count, lifetime, lifetime / count, 0.05f, 1.0f, Float4{ 0.0f, 0.0f, 0.0f, 1.0f }, Float4{ 1.0f, 1.0f, 1.0f, 0.0f });
+		simulation->SetStorage(storage);
+		//analytic storage ignores forces, the others rise against drag and drift with a breeze
+		if (storage != ParticleStorage::Analytic)
+			simulation->SetAffectors(BuoyancyAffector(0.8f, 2.0f), LinearDragAffector(1.5f), WindAffector(Float3{ 0.5f, 0.0f, 0.2f }, 0.5f));
+		return simulation;
+	}
+
+	//mean of the drawn quad corners, the smoke's center of mass
+	Float3 Centroid(ParticleSimulation& simulation)
+	{
+		simulation.BuildVertices(Float3{ 1.0f, 0.0f, 0.0f }, Float3{ 0.0f, 1.0f, 0.0f });
+		double sum[3] = {};
+		int vertices = 0;
+		ParticleSpan spans[2];
+		int spanCount = simulation.GetDrawSpans(spans);
+		for (int s = 0; s < spanCount; s++)
+		{
+			for (int v = 4 * spans[s].first; v < 4 * (spans[s].first + spans[s].count); v++)
+			{
+				const Float3& p = simulation.GetVertices()[v].Position;
+				sum[0] += p.x;
+				sum[1] += p.y;
+				sum[2] += p.z;
+				vertices++;
+			}
+		}
+		vertices = std::max(vertices, 1);
+		return Float3{ (float)(sum[0] / vertices), (float)(sum[1] / vertices), (float)(sum[2] / vertices) };
+	}
+}
+
+void RunPrewarmSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	const int count = std::min(20000, options.maxCount);
+	struct Config
+	{
+		const char* name;
+		ParticleStorage storage;
+	};
+	const Config configs[2] = { { "forces", ParticleStorage::Ring }, { "analytic", ParticleStorage::Analytic } };
+
+	for (const Config& config : configs)
+	{
+		//the cost must not grow with the time jumped over, frame by frame is only run over the first lifetime
+		for (float lifetimes : { 1.0f, 10.0f, 1000.0f })
+		{
+			float time = lifetimes * lifetime;
+			auto simulation = MakeSimulation(count, config.storage);
+			BenchmarkTimer timer;
+			simulation->Prewarm(time);
+			double prewarmSeconds = timer.ElapsedSeconds();
+			int alive = simulation->GetParticleCount();
+			Float3 centroid = Centroid(*simulation);
+
+			BenchmarkResult result = { "prewarm", std::string(config.name) + "/" + std::to_string((int)lifetimes) + "_lifetimes" };
+			result.Set("particles", alive);
+			result.Set("prewarm_ms", prewarmSeconds * 1.0e3);
+			if (lifetimes == 1.0f)
+			{
+				auto stepped = MakeSimulation(count, config.storage);
+				int frames = (int)std::lround(time / options.dt);
+				BenchmarkTimer steppedTimer;
+				for (int f = 0; f < frames; f++)
+				{
+					stepped->Simulate(time / frames);
+				}
+				double steppedSeconds = steppedTimer.ElapsedSeconds();
+				Float3 steppedCentroid = Centroid(*stepped);
+				float dx = centroid.x - steppedCentroid.x;
+				float dy = centroid.y - steppedCentroid.y;
+				float dz = centroid.z - steppedCentroid.z;
+
+				result.Set("frame_by_frame_ms", steppedSeconds * 1.0e3);
+				result.Set("speedup", steppedSeconds / prewarmSeconds);
+				//births can differ by the rounding of the fractional particle carried between frames
+				result.Set("alive_difference", std::abs(alive - stepped->GetParticleCount()));
+				result.Set("centroid_error", std::sqrt(dx * dx + dy * dy + dz * dz));
+			}
+			report.Add(result);
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleRandom.h"
+#include"ParticleCore/ParticleSimulation.h"
+#include<algorithm>
+#include<memory>
+#include<vector>
+
+namespace
+{
+	//time count values of one distribution, averaged over the frames
+	template<typename Fill>
+	void RunDistribution(const char* name, int count, const BenchmarkOptions& options, BenchmarkReport& report, Fill fill)
+	{
+		BenchmarkTimer timer;
+		for (int f = 0; f < options.frames; f++)
+		{
+			fill();
+		}
+		double seconds = timer.ElapsedSeconds() / options.frames;
+
+		BenchmarkResult result = { "random", std::string(name) + "/" + std::to_string(count) };
+		result.Set("values", count);
+		result.Set("ns_per_value", seconds * 1.0e9 / count);
+		result.Set("values_per_sec", count / seconds);
+		report.Add(result);
+	}
+}
+
+void RunRandomSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	const int count = std::min(1000000, options.maxCount);
+	std::vector<float> x(count), y(count), z(count);
+	ParticleRandom random(1);
+
+	RunDistribution("uniform", count, options, report, [&]() { random.Uniform(x.data(), count); });
+	RunDistribution("normal", count, options, report, [&]() { random.Normal(x.data(), count, 0.0f, 1.0f); });
+	RunDistribution("sphere", count, options, report, [&]() { random.InSphere(x.data(), y.data(), z.data(), count, 1.0f); });
+	RunDistribution("cone", count, options, report, [&]() { random.InCone(x.data(), y.data(), z.data(), count, Float3{ 0.0f, 1.0f, 0.0f }, 0.5f); });
+
+	//a single frame emitting a whole burst, the case the batched spawn is for
+	const int burst = std::min(100000, options.maxCount);
+	BenchmarkTimer timer;
+	for (int f = 0; f < options.frames; f++)
+	{
+		//emissionTime chosen so one frame emits exactly the burst
+		ParticleSimulation simulation(Float3{ 0.0f, 0.0f, 0.0f }, Float3{ 0.02f, 0.2f, 0.1f }, burst, 10.0f, options.dt / (burst + 0.5f),
+			0.05f, 1.0f, Float4{ 0.0f, 0.0f, 0.0f, 1.0f }, Float4{ 1.0f, 1.0f, 1.0f, 0.0f });
+		simulation.Simulate(options.dt);
+	}
+	double seconds = timer.ElapsedSeconds() / options.frames;
+
+	BenchmarkResult result = { "random", "burst/" + std::to_string(burst) };
+	result.Set("particles", burst);
+	result.Set("ms_per_burst", seconds * 1.0e3);
+	result.Set("ns_per_particle", seconds * 1.0e9 / burst);
+	report.Add(result);
+}
@@ -0,0 +1,197 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleDepthSorter.h"
+#include"ParticleCore/JobSystem.h"
+#include"ParticleCore/ParticleRandom.h"
+#include<algorithm>
+#include<cmath>
+#include<cstring>
+#include<memory>
+#include<vector>
+
+namespace
+{
+	float Depth(const ParticleData& particles, unsigned int slot, Float3 position, Float3 forward)
+	{
+		return (particles.PositionX[slot] - position.x) * forward.x + (particles.PositionY[slot] - position.y) * forward.y +
+			(particles.PositionZ[slot] - position.z) * forward.z;
+	}
+
+	//slots missing from the order or in it twice
+	int CountInvalid(const ParticleDepthSorter& sorter, int count)
+	{
+		int invalid = 0;
+		std::vector<unsigned char> seen(count, 0);
+		const unsigned int* order = sorter.GetOrder();
+		for (int i = 0; i < count; i++)
+		{
+			if (order[i] >= (unsigned int)count || seen[order[i]])
+				invalid++;
+			else
+				seen[order[i]] = 1;
+		}
+		return invalid;
+	}
+
+	//largest depth by which a particle is drawn after a nearer one, 0 for an exact back to front order
+	float MaxInversion(const ParticleDepthSorter& sorter, const ParticleData& particles, int count, Float3 position, Float3 forward)
+	{
+		const unsigned int* order = sorter.GetOrder();
+		float nearest = 1.0e30f;
+		float inversion = 0.0f;
+		for (int i = 0; i < count; i++)
+		{
+			float depth = Depth(particles, order[i], position, forward);
+			inversion = std::max(inversion, depth - nearest);
+			nearest = std::min(nearest, depth);
+		}
+		return inversion;
+	}
+}
+
+void RunSortSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	for (int count : { 100000, 1000000 })
+	{
+		if (count > options.maxCount)
+			continue;
+
+		ParticleData particles(count);
+		ParticleRandom random(20);
+		random.Uniform(particles.PositionX, count, -10.0f, 10.0f);
+		random.Uniform(particles.PositionY, count, 0.0f, 10.0f);
+		random.Uniform(particles.PositionZ, count, -10.0f, 10.0f);
+		//smoke speeds, a few mm per frame
+		random.Uniform(particles.VelocityX, count, -0.1f, 0.1f);
+		random.Uniform(particles.VelocityY, count, 0.0f, 0.2f);
+		random.Uniform(particles.VelocityZ, count, -0.1f, 0.1f);
+
+		Float3 cameraPosition = { 0.0f, 5.0f, -20.0f };
+		Float3 cameraForward = { 0.0f, 0.0f, 1.0f };
+
+		//full radix sorts, against std::sort on the same keys as a baseline
+		std::vector<unsigned int> reference;
+		for (int threads : { 1, 4 })
+		{
+			ParticleDepthSorter sorter;
+			if (threads > 1)
+				sorter.SetJobSystem(std::make_shared<JobSystem>(threads - 1));
+			BenchmarkTimer timer;
+			for (int f = 0; f < options.frames; f++)
+			{
+				sorter.Reset();
+				sorter.Sort(particles, count, cameraPosition, cameraForward);
+			}
+			double seconds = timer.ElapsedSeconds() / options.frames;
+
+			std::vector<unsigned int> order(sorter.GetOrder(), sorter.GetOrder() + count);
+			if (threads == 1)
+				reference = order;
+
+			BenchmarkResult result = { "sort", "radix/" + std::to_string(count) + "/" + std::to_string(threads) + "_threads" };
+			result.Set("particles", count);
+			result.Set("threads", threads);
+			result.Set("ms_per_sort", seconds * 1.0e3);
+			result.Set("ns_per_particle", seconds * 1.0e9 / count);
+			result.Set("invalid", CountInvalid(sorter, count));
+			result.Set("max_inversion", MaxInversion(sorter, particles, count, cameraPosition, cameraForward));
+			result.Set("bitwise_match", std::memcmp(order.data(), reference.data(), count * sizeof(unsigned int)) == 0 ? 1 : 0);
+			report.Add(result);
+		}
+		{
+			std::vector<unsigned int> order(count);
+			BenchmarkTimer timer;
+			for (int f = 0; f < options.frames; f++)
+			{
+				for (int i = 0; i < count; i++)
+				{
+					order[i] = (unsigned int)i;
+				}
+				std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+					return Depth(particles, a, cameraPosition, cameraForward) > Depth(particles, b, cameraPosition, cameraForward);
+				});
+			}
+			double seconds = timer.ElapsedSeconds() / options.frames;
+
+			BenchmarkResult result = { "sort", "std_sort/" + std::to_string(count) };
+			result.Set("particles", count);
+			result.Set("ms_per_sort", seconds * 1.0e3);
+			result.Set("ns_per_particle", seconds * 1.0e9 / count);
+			report.Add(result);
+		}
+
+		//frame to frame with 0.2% of the particles dying and respawning through swap removal (a 10 s life at 60 fps):
+		//particles at rest under a strafing camera, drifting like smoke under it, and at rest under an orbiting camera
+		struct Scenario
+		{
+			const char* name;
+			float speedScale;
+			float turnPerFrame;
+		};
+		const Scenario scenarios[3] = { { "static", 0.0f, 0.0f }, { "drifting", 1.0f, 0.0f }, { "orbiting", 0.0f, 0.2f } };
+		for (const Scenario& scenario : scenarios)
+		{
+			ParticleDepthSorter sorter;
+			sorter.SetJobSystem(std::make_shared<JobSystem>(3));
+			ParticleData moving(count);
+			std::memcpy(moving.PositionX, particles.PositionX, count * sizeof(float));
+			std::memcpy(moving.PositionY, particles.PositionY, count * sizeof(float));
+			std::memcpy(moving.PositionZ, particles.PositionZ, count * sizeof(float));
+			ParticleRandom churn(21);
+			const int deaths = count / 500;
+			std::vector<float> respawn(3 * deaths);
+
+			double seconds = 0.0;
+			int incrementalFrames = 0;
+			int invalid = 0;
+			float maxInversion = 0.0f;
+			float angle = 0.0f;
+			for (int f = 0; f < options.frames; f++)
+			{
+				for (int i = 0; i < count; i++)
+				{
+					moving.PositionX[i] += particles.VelocityX[i] * scenario.speedScale * options.dt;
+					moving.PositionY[i] += particles.VelocityY[i] * scenario.speedScale * options.dt;
+					moving.PositionZ[i] += particles.VelocityZ[i] * scenario.speedScale * options.dt;
+				}
+				churn.Uniform(respawn.data(), (int)respawn.size(), -1.0f, 1.0f);
+				for (int d = 0; d < deaths; d++)
+				{
+					int slot = (int)((respawn[d] * 0.5f + 0.5f) * (count - d - 1));
+					moving.PositionX[slot] = moving.PositionX[count - d - 1];
+					moving.PositionY[slot] = moving.PositionY[count - d - 1];
+					moving.PositionZ[slot] = moving.PositionZ[count - d - 1];
+				}
+				for (int d = 0; d < deaths; d++)
+				{
+					moving.PositionX[count - deaths + d] = respawn[deaths + d] * 0.2f;
+					moving.PositionY[count - deaths + d] = 0.0f;
+					moving.PositionZ[count - deaths + d] = respawn[2 * deaths + d] * 0.2f;
+				}
+
+				//1 cm sideways per frame, or around the scene
+				angle += scenario.turnPerFrame;
+				float strafe = 0.01f * f;
+				cameraForward = { -std::sin(angle), 0.0f, std::cos(angle) };
+				cameraPosition = { 20.0f * std::sin(angle) + strafe * cameraForward.z, 5.0f, -20.0f * std::cos(angle) - strafe * cameraForward.x };
+
+				BenchmarkTimer timer;
+				sorter.Sort(moving, count, cameraPosition, cameraForward);
+				seconds += timer.ElapsedSeconds();
+				incrementalFrames += sorter.WasIncremental() ? 1 : 0;
+				invalid += CountInvalid(sorter, count);
+				maxInversion = std::max(maxInversion, MaxInversion(sorter, moving, count, cameraPosition, cameraForward));
+			}
+			seconds /= options.frames;
+
+			BenchmarkResult result = { "sort", std::string(scenario.name) + "/" + std::to_string(count) };
+			result.Set("particles", count);
+			result.Set("threads", 4);
+			result.Set("ms_per_sort", seconds * 1.0e3);
+			result.Set("ns_per_particle", seconds * 1.0e9 / count);
+			result.Set("incremental_fraction", (double)incrementalFrames / options.frames);
+			result.Set("invalid", invalid);
+			result.Set("max_inversion", maxInversion);
+			report.Add(result);
+		}
+	}
+}
@@ -0,0 +1,75 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleSimulation.h"
+#include<algorithm>
+#include<cstring>
+#include<memory>
+#include<thread>
+#include<vector>
+
+namespace
+{
+	const float lifetime = 0.25f;
+
+	std::unique_ptr<ParticleSimulation> CreateSimulation(int count)
+	{
+		return std::make_unique<ParticleSimulation>(Float3{ 1.2f, 1.1f, 1.9f }, Float3{ 0.02f, 0.2f, 0.1f },
+			count, lifetime, lifetime / count, 0.05f, 1.0f, Float4{ 0.0f, 0.0f, 0.0f, 1.0f }, Float4{ 1.0f, 1.0f, 1.0f, 0.0f });
+	}
+}
+
+void RunThreadingSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	const Float3 cameraRight = { 1.0f, 0.0f, 0.0f };
+	const Float3 cameraUp = { 0.0f, 1.0f, 0.0f };
+	const int count = std::min(1000000, options.maxCount);
+	const int warmupFrames = (int)(lifetime / options.dt) + 2;
+
+	//1, 2, 4, ... threads up to at least 16 or the hardware thread count
+	int hardwareThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	std::vector<int> threadCounts;
+	for (int t = 1; t <= std::max(16, hardwareThreads); t *= 2)
+	{
+		threadCounts.push_back(t);
+	}
+
+	std::vector<ParticleVertex> reference;
+	double singleThreadSeconds = 0.0;
+
+	for (int threads : threadCounts)
+	{
+		auto simulation = CreateSimulation(count);
+		simulation->SetJobSystem(std::make_shared<JobSystem>(threads - 1));
+
+		for (int f = 0; f < warmupFrames; f++)
+		{
+			simulation->Simulate(options.dt);
+		}
+
+		BenchmarkTimer timer;
+		for (int f = 0; f < options.frames; f++)
+		{
+			simulation->Simulate(options.dt);
+			simulation->BuildVertices(cameraRight, cameraUp);
+		}
+		double seconds = timer.ElapsedSeconds() / options.frames;
+
+		//same frames on every thread count, so the vertex output must be identical
+		size_t vertexCount = (size_t)simulation->GetParticleCount() * 4;
+		const ParticleVertex* vertices = simulation->GetVertices();
+		if (threads == 1)
+		{
+			reference.assign(vertices, vertices + vertexCount);
+			singleThreadSeconds = seconds;
+		}
+		bool matches = reference.size() == vertexCount &&
+			memcmp(reference.data(), vertices, vertexCount * sizeof(ParticleVertex)) == 0;
+
+		BenchmarkResult result = { "threads", std::to_string(count) + "/threads=" + std::to_string(threads) };
+		result.Set("threads", threads);
+		result.Set("ms_per_frame", seconds * 1.0e3);
+		result.Set("ns_per_particle", seconds * 1.0e9 / count);
+		result.Set("speedup", singleThreadSeconds / seconds);
+		result.Set("bitwise_match", matches ? 1.0 : 0.0);
+		report.Add(result);
+	}
+}
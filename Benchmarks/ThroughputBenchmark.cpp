@@ -0,0 +1,63 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleSimulation.h"
+#include<memory>
+
+namespace
+{
+	//short lifetime so every configuration reaches steady state after a few frames
+	const float lifetime = 0.25f;
+
+	//memory traffic of one live particle per frame, from the streams each stage of Simulate and BuildVertices reads
+	//and writes, in float streams. spawnedFraction is the share of the live particles replaced each frame
+	double BytesTouchedPerParticle(double spawnedFraction)
+	{
+		const double f = sizeof(float);
+		double update = (1 + 1 + 1 + 4) * f;                     //UpdateParticleData: age rw, size w, color w
+		double affectors = (3 + 3 + 1 + 3 + 3) * f;              //affector pipeline: position, velocity, age r, position, velocity w
+		double expiry = 1 * f;                                   //KillExpired: age r
+		double build = (3 + 1 + 4 + 1) * f + 4 * sizeof(ParticleVertex); //position, size, color, rotation r, 4 vertices w
+		//per spawned particle: SpawnParticles writes position, velocity and rotation and reads position and velocity back,
+		//AdvanceSpawnedParticles writes age, position, size and color reading position and velocity.
+		//Per dead particle the compact pool moves its last live particle in, every stream read and written
+		double spawn = (3 + 3 + 1) * f + (3 + 3) * f + (1 + 3 + 1 + 4) * f + (3 + 3) * f;
+		double compaction = 2 * ParticleData::StreamCount * f;
+		return update + affectors + expiry + build + spawnedFraction * (spawn + compaction);
+	}
+}
+
+void RunThroughputSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	const Float3 cameraRight = { 1.0f, 0.0f, 0.0f };
+	const Float3 cameraUp = { 0.0f, 1.0f, 0.0f };
+
+	for (int count = 1000; count <= options.maxCount; count *= 10)
+	{
+		//emission rate chosen so count particles are alive at steady state
+		auto simulation = std::make_unique<ParticleSimulation>(Float3{ 1.2f, 1.1f, 1.9f }, Float3{ 0.02f, 0.2f, 0.1f },
+			count, lifetime, lifetime / count, 0.05f, 1.0f, Float4{ 0.0f, 0.0f, 0.0f, 1.0f }, Float4{ 1.0f, 1.0f, 1.0f, 0.0f });
+
+		int warmupFrames = (int)(lifetime / options.dt) + 2;
+		for (int f = 0; f < warmupFrames; f++)
+		{
+			simulation->Simulate(options.dt);
+		}
+
+		BenchmarkTimer timer;
+		for (int f = 0; f < options.frames; f++)
+		{
+			simulation->Simulate(options.dt);
+			simulation->BuildVertices(cameraRight, cameraUp);
+		}
+		double seconds = timer.ElapsedSeconds() / options.frames;
+
+		int alive = simulation->GetParticleCount();
+		BenchmarkResult result = { "throughput", "simulate+build/" + std::to_string(count) };
+		result.Set("particles", alive);
+		result.Set("ms_per_frame", seconds * 1.0e3);
+		result.Set("ns_per_particle", seconds * 1.0e9 / alive);
+		result.Set("particles_per_sec", alive / seconds);
+		result.Set("bytes_touched", BytesTouchedPerParticle(options.dt / lifetime) * alive);
+		result.Set("peak_rss_bytes", GetPeakResidentBytes());
+		report.Add(result);
+	}
+}
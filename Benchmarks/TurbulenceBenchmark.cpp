@@ -0,0 +1,95 @@
+#include"BenchmarkSuites.h"
+#include"ParticleCore/ParticleTurbulenceAffector.h"
+#include"ParticleCore/ParticleRandom.h"
+#include<algorithm>
+#include<cmath>
+#include<cstdio>
+#include<memory>
+
+namespace
+{
+	//particles spread over a few tiles so the samples miss the cache the way a tall plume would
+	void FillParticles(ParticleData& particles, int count)
+	{
+		ParticleRandom random(15);
+		random.Uniform(particles.PositionX, count, -4.0f, 4.0f);
+		random.Uniform(particles.PositionY, count, 0.0f, 12.0f);
+		random.Uniform(particles.PositionZ, count, -4.0f, 4.0f);
+		random.Uniform(particles.VelocityX, count, -0.1f, 0.1f);
+		random.Uniform(particles.VelocityY, count, 0.2f, 0.6f);
+		random.Uniform(particles.VelocityZ, count, -0.1f, 0.1f);
+		random.Uniform(particles.Age, count, 0.0f, 10.0f);
+	}
+
+	//largest difference between the SIMD and the scalar sample over the particles, should be 0
+	float CompareSampling(const ParticleNoiseVolume& volume, const ParticleData& particles, int count)
+	{
+		float maxError = 0.0f;
+		for (int i = 0; i + PARTICLE_SIMD_WIDTH <= count; i += PARTICLE_SIMD_WIDTH)
+		{
+			alignas(64) float out[3][PARTICLE_SIMD_WIDTH];
+			SimdFloat vx, vy, vz;
+			volume.Sample(SimdLoad(particles.PositionX + i), SimdLoad(particles.PositionY + i), SimdLoad(particles.PositionZ + i), vx, vy, vz);
+			SimdStore(out[0], vx);
+			SimdStore(out[1], vy);
+			SimdStore(out[2], vz);
+			for (int l = 0; l < PARTICLE_SIMD_WIDTH; l++)
+			{
+				Float3 v = volume.Sample(Float3{ particles.PositionX[i + l], particles.PositionY[i + l], particles.PositionZ[i + l] });
+				maxError = std::max(maxError, std::fabs(v.x - out[0][l]));
+				maxError = std::max(maxError, std::fabs(v.y - out[1][l]));
+				maxError = std::max(maxError, std::fabs(v.z - out[2][l]));
+			}
+		}
+		return maxError;
+	}
+}
+
+void RunTurbulenceSuite(const BenchmarkOptions& options, BenchmarkReport& report)
+{
+	const NoiseQuality qualities[3] = { NoiseQuality::Low, NoiseQuality::Medium, NoiseQuality::High };
+	const char* qualityNames[3] = { "low", "medium", "high" };
+	const char* cachePath = "turbulence_benchmark.bin";
+
+	for (int q = 0; q < 3; q++)
+	{
+		auto volume = std::make_shared<ParticleNoiseVolume>();
+		BenchmarkTimer generateTimer;
+		volume->Generate(qualities[q], 7);
+		double generateSeconds = generateTimer.ElapsedSeconds();
+
+		//startup cost with a warm cache file
+		volume->Save(cachePath);
+		ParticleNoiseVolume loaded;
+		BenchmarkTimer loadTimer;
+		bool loadedOk = loaded.Load(cachePath, qualities[q], 7);
+		double loadSeconds = loadTimer.ElapsedSeconds();
+		std::remove(cachePath);
+
+		for (int count = 10000; count <= options.maxCount; count *= 10)
+		{
+			ParticleData particles(count);
+			FillParticles(particles, count);
+
+			ParticleAffectorPipeline<TurbulenceAffector> turbulence(TurbulenceAffector(volume, 0.5f, 4.0f, Float3{ 0.0f, 0.3f, 0.0f }));
+			BenchmarkTimer timer;
+			for (int f = 0; f < options.frames; f++)
+			{
+				turbulence.Advance(options.dt);
+				turbulence.Run(particles, 0, count, options.dt);
+			}
+			double seconds = timer.ElapsedSeconds() / options.frames;
+
+			BenchmarkResult result = { "turbulence", std::string(qualityNames[q]) + "/" + std::to_string(count) };
+			result.Set("particles", count);
+			result.Set("resolution", volume->GetResolution());
+			result.Set("volume_bytes", (double)volume->GetMemoryBytes());
+			result.Set("generate_ms", generateSeconds * 1.0e3);
+			result.Set("load_ms", loadedOk ? loadSeconds * 1.0e3 : -1.0);
+			result.Set("ms_per_frame", seconds * 1.0e3);
+			result.Set("ns_per_particle", seconds * 1.0e9 / count);
+			result.Set("simd_max_error", CompareSampling(*volume, particles, count));
+			report.Add(result);
+		}
+	}
+}
@@ -102,3 +102,37 @@ DirectX::XMFLOAT4X4 Camera::GetProjectionMatrix()
 {
     return projectionMatrix;
 }
+
+CameraFrame Camera::BuildFrame()
+{
+    CameraFrame frame;
+    frame.view = viewMatrix;
+    frame.projection = projectionMatrix;
+
+    DirectX::XMMATRIX viewProjection = DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&viewMatrix), DirectX::XMLoadFloat4x4(&projectionMatrix));
+    DirectX::XMStoreFloat4x4(&frame.viewProjection, viewProjection);
+
+    //view matrix columns are the camera axes in world space
+    frame.right = DirectX::XMFLOAT3(viewMatrix._11, viewMatrix._21, viewMatrix._31);
+    frame.up = DirectX::XMFLOAT3(viewMatrix._12, viewMatrix._22, viewMatrix._32);
+    frame.forward = DirectX::XMFLOAT3(viewMatrix._13, viewMatrix._23, viewMatrix._33);
+    frame.position = transform.GetPosition();
+
+    //planes from the view projection columns (row vectors, D3D clip z in [0, w])
+    const DirectX::XMFLOAT4X4& m = frame.viewProjection;
+    DirectX::XMFLOAT4 planes[6] =
+    {
+        DirectX::XMFLOAT4(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41),
+        DirectX::XMFLOAT4(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41),
+        DirectX::XMFLOAT4(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42),
+        DirectX::XMFLOAT4(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42),
+        DirectX::XMFLOAT4(m._13, m._23, m._33, m._43),
+        DirectX::XMFLOAT4(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43)
+    };
+    for (int i = 0; i < 6; i++)
+    {
+        DirectX::XMStoreFloat4(&frame.frustumPlanes[i], DirectX::XMPlaneNormalize(DirectX::XMLoadFloat4(&planes[i])));
+    }
+
+    return frame;
+}
@@ -3,6 +3,24 @@
 #include"Transformation.h"
 #include<DirectXMath.h>
 
+//immutable per frame copy of everything renderers and emitters need from the camera
+//built once in Game::Update and passed by const reference, so hot paths never touch the camera itself
+struct CameraFrame
+{
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+	DirectX::XMFLOAT4X4 viewProjection;
+
+	//world space axes, right / up are the billboard axes
+	DirectX::XMFLOAT3 right;
+	DirectX::XMFLOAT3 up;
+	DirectX::XMFLOAT3 forward;
+	DirectX::XMFLOAT3 position;
+
+	//left, right, bottom, top, near, far - normalized, a point is inside when dot(plane.xyz, p) + plane.w >= 0
+	DirectX::XMFLOAT4 frustumPlanes[6];
+};
+
 class Camera
 {
 private:
@@ -29,4 +47,7 @@ public:
 	void UpdateProjectionMatrix(float aspectRatio);
 	void UpdateViewMatrix();
 	void Update(float dt);
+
+	//snapshot of the current view / projection state
+	CameraFrame BuildFrame();
 };
@@ -2,6 +2,9 @@
 #include "Vertex.h"
 #include "Input.h"
 #include "Helpers.h"
+#include "ParticleCore/ParticleDistanceFieldAffector.h"
+#include "ParticleCore/ParticleFluidAdvectionAffector.h"
+#include "ParticleCore/ParticleTurbulenceAffector.h"
 
 #include"ImGui/imgui.h"
 #include"ImGui/imgui_impl_dx11.h"
@@ -93,6 +96,7 @@ void Game::Init()
 
 	//camera creation
 	camera = std::make_shared<Camera>((float)this->windowWidth / this->windowHeight, DirectX::XMFLOAT3(0.0f, 1.0f, -2.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XM_PI / 3, 0.01f, 100.0f, 1.0f, 1.0f, true);
+	cameraFrame = camera->BuildFrame();
 
 	//imgui stuff
 	IMGUI_CHECKVERSION();
@@ -187,6 +191,9 @@ void Game::LoadShaders()
 	pixelShader_Particles = std::make_shared<SimplePixelShader>(device, context,
 		FixPath(L"PixelShader_Particles.cso").c_str());
 
+	vertexShader_ParticlesInstanced = std::make_shared<SimpleVertexShader>(device, context,
+		FixPath(L"VertexShader_ParticlesInstanced.cso").c_str());
+
 	/*pixelShaderCustom = std::make_shared<SimplePixelShader>(device, context,
 		FixPath(L"CustomPixelShader.cso").c_str());*/
 		
@@ -280,6 +287,8 @@ void Game::CreateMaterials()
 	
 	//particle material
 	materials.push_back(std::make_shared<Material>(DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader_Particles, pixelShader_Particles));
+	//instanced particle material
+	materials.push_back(std::make_shared<Material>(DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader_ParticlesInstanced, pixelShader_Particles));
 
 	//Add texture SRV and sampler state to the material
 
@@ -327,6 +336,9 @@ void Game::CreateMaterials()
 
 	materials[7]->AddShaderView("ParticleMap", shaderViewParticle);
 	materials[7]->AddSamplerState("BasicSampler", samplerState);
+
+	materials[8]->AddShaderView("ParticleMap", shaderViewParticle);
+	materials[8]->AddSamplerState("BasicSampler", samplerState);
 }
 
 void Game::CreateSkyBox()
@@ -381,16 +393,16 @@ void Game::CreateEntities()
 
 void Game::CreateParticleStatesAndEmitters()
 {
-	//blend state
+	//alpha blend state, the emitters sort their particles back to front for it
 	D3D11_BLEND_DESC blendDesc = {};
 	blendDesc.AlphaToCoverageEnable = false;
 	blendDesc.IndependentBlendEnable = false;
 	blendDesc.RenderTarget[0].BlendEnable = true;
 	blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
-	blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
 	blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
 	blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
-	blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
 	blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
 	blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
 
@@ -404,9 +416,15 @@ void Game::CreateParticleStatesAndEmitters()
 
 	device->CreateDepthStencilState(&depthDesc, depthState.GetAddressOf());
 
-	//smoke emitter
+	//one worker per spare core for particle simulation
+	jobSystem = std::make_shared<JobSystem>();
+	//room for dozens of emitters the size of the chimney's each frame
+	particleSystem = std::make_shared<ParticleSystem>(device, 32768);
+
+	//smoke emitter, centered on the chimney mouth
+	DirectX::XMFLOAT3 smokePosition(2.36f, 2.47f, 4.0f);
 	smokeEmitter = std::make_shared<ParticleEmitter>(
-		DirectX::XMFLOAT3(1.2f, 1.1f, 1.9f),             //position
+		smokePosition,                                    //position
 		DirectX::XMFLOAT3(0.02f, 0.2f, 0.1f),             //start velocity
 		materials[7],
 		1000,                                            //max particles
@@ -418,8 +436,96 @@ void Game::CreateParticleStatesAndEmitters()
 		DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 0.0f),		    // end color
 		device
 	);
+	smokeEmitter->SetJobSystem(jobSystem);
+	smokeEmitter->SetDepthSorting(true);
+	//one lifetime for every smoke particle, so they die in spawn order and a ring needs no compaction
+	smokeEmitter->SetStorage(ParticleStorage::Ring);
 
-	smokeEmitter->InititalizeGeometry();
+	//emit from the upward facing top faces of the chimney, moved to world space and made relative to the emitter
+	{
+		DirectX::XMFLOAT4X4 chimneyWorld = gameEntities[2]->GetTransform()->GetWorldMatrix();
+		DirectX::XMMATRIX world = DirectX::XMLoadFloat4x4(&chimneyWorld);
+		const std::vector<DirectX::XMFLOAT3>& chimneyPositions = chimney->GetPositions();
+		std::vector<Float3> mouthPositions(chimneyPositions.size());
+		for (size_t i = 0; i < chimneyPositions.size(); i++)
+		{
+			DirectX::XMFLOAT3 p;
+			DirectX::XMStoreFloat3(&p, DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&chimneyPositions[i]), world));
+			mouthPositions[i] = { p.x - smokePosition.x, p.y - smokePosition.y, p.z - smokePosition.z };
+		}
+
+		const std::vector<unsigned int>& chimneyIndices = chimney->GetIndices();
+		smokeEmitter->SetEmissionShape(ParticleEmissionShape::MeshSurface(mouthPositions.data(), chimneyIndices.data(),
+			(int)chimneyIndices.size(), Float3{ 0.0f, 1.0f, 0.0f }, 0.99f));
+	}
+	//roof and walls in world space for smoke collisions, the chimney is left out so spawning on its mouth never collides
+	sceneBvh = std::make_shared<ParticleBvh>();
+	auto addCollider = [&](std::shared_ptr<GameEntity> entity, std::shared_ptr<Mesh> mesh) {
+		DirectX::XMFLOAT4X4 entityWorld = entity->GetTransform()->GetWorldMatrix();
+		DirectX::XMMATRIX world = DirectX::XMLoadFloat4x4(&entityWorld);
+		const std::vector<DirectX::XMFLOAT3>& meshPositions = mesh->GetPositions();
+		std::vector<Float3> worldPositions(meshPositions.size());
+		for (size_t i = 0; i < meshPositions.size(); i++)
+		{
+			DirectX::XMFLOAT3 p;
+			DirectX::XMStoreFloat3(&p, DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&meshPositions[i]), world));
+			worldPositions[i] = { p.x, p.y, p.z };
+		}
+		const std::vector<unsigned int>& meshIndices = mesh->GetIndices();
+		sceneBvh->AddMesh(worldPositions.data(), (int)worldPositions.size(), meshIndices.data(), (int)meshIndices.size());
+	};
+	addCollider(gameEntities[3], roof);
+	addCollider(gameEntities[5], walls);
+	sceneBvh->Build();
+	//smoke collides with a distance field baked from the same triangles, cached next to the executable under their hash
+	std::shared_ptr<ParticleDistanceField> sceneField = std::make_shared<ParticleDistanceField>();
+	sceneField->SetJobSystem(jobSystem);
+	sceneField->LoadOrBake(WideToNarrow(FixPath(L"scene_sdf.bin")).c_str(), *sceneBvh, 128, 4);
+
+	//grid smoke above the chimney for close ups, particles inside it ride its air instead of the forces below.
+	//32^3 cells and a 2 ms step budget, the solver drops pressure iterations to hold it
+	smokeFluid = std::make_shared<ParticleFluidSolver>(Float3{ smokePosition.x, smokePosition.y + 1.0f, smokePosition.z }, 2.4f, 32);
+	smokeFluid->SetSource(Float3{ smokePosition.x, smokePosition.y, smokePosition.z }, 0.12f, 1.0f, 2.0f, Float3{ 0.0f, 0.3f, 0.0f });
+	smokeFluid->SetStepBudget(2.0f);
+	smokeFluid->SetJobSystem(jobSystem);
+
+	//curl noise is generated once and cached next to the executable, later runs only load it
+	std::shared_ptr<ParticleNoiseVolume> smokeNoise = std::make_shared<ParticleNoiseVolume>();
+	smokeNoise->LoadOrGenerate(WideToNarrow(FixPath(L"smoke_noise.bin")).c_str(), NoiseQuality::Medium, 1);
+	//warm smoke rises, slows down, drifts with a light breeze, curls in turbulence rising with it and slides off the house
+	smokeEmitter->SetAffectors(
+		BuoyancyAffector(0.04f, 8.0f),
+		LinearDragAffector(0.05f),
+		WindAffector(Float3{ 0.1f, 0.0f, 0.03f }, 0.1f),
+		TurbulenceAffector(smokeNoise, 0.15f, 3.0f, Float3{ 0.0f, 0.2f, 0.0f }),
+		FluidAdvectionAffector(smokeFluid, 4.0f),
+		DistanceFieldCollisionAffector(sceneField, 0.05f, 0.1f, 0.3f));
+	//puffs grow fast then slowly, fade in just above the chimney and out over the rest of their life
+	ParticleCurve smokeSize;
+	smokeSize.AddKey(0.0f, 0.05f);
+	smokeSize.AddKey(0.3f, 0.6f);
+	smokeSize.AddKey(1.0f, 1.0f);
+	smokeEmitter->SetSizeOverLife(smokeSize);
+
+	ParticleGradient smokeColor;
+	smokeColor.AddColorKey(0.0f, Float3{ 0.0f, 0.0f, 0.0f });
+	smokeColor.AddColorKey(1.0f, Float3{ 1.0f, 1.0f, 1.0f });
+	smokeColor.AddAlphaKey(0.0f, 0.0f);
+	smokeColor.AddAlphaKey(0.08f, 1.0f);
+	smokeColor.AddAlphaKey(1.0f, 0.0f);
+	smokeEmitter->SetColorOverLife(smokeColor);
+	//one instance record per particle, corners built on the GPU
+	smokeEmitter->SetRenderMode(ParticleRenderMode::Instanced, materials[8]);
+	//the chimney already smokes when the scene opens instead of filling in over the first 10 s. The puffs ride the
+	//smoke grid, so it is stepped along with them rather than left as still air for the whole prewarm
+	smokeEmitter->Prewarm(0.0f);
+	const float prewarmStep = 1.0f / 30.0f;
+	for (int i = 0; i < 300; i++)
+	{
+		smokeFluid->Step(prewarmStep);
+		smokeEmitter->FastForward(prewarmStep);
+	}
+	particleSystem->AddEmitter(smokeEmitter);
 
 }
 
@@ -560,7 +666,7 @@ void Game::DrawParticles()
 	context->OMSetBlendState(blendState.Get(), 0, 0xffffffff);
 	context->OMSetDepthStencilState(depthState.Get(), 0);
 
-	smokeEmitter->DrawParticles(context, camera);
+	particleSystem->Draw(context, cameraFrame);
 
 	//reset states
 	context->OMSetBlendState(0, 0, 0xffffffff);
@@ -582,6 +688,7 @@ void Game::OnResize()
 	if (camera != 0)
 	{
 		camera->UpdateProjectionMatrix((float)this->windowWidth / this->windowHeight);
+		cameraFrame = camera->BuildFrame();
 	}
 }
 
@@ -609,10 +716,12 @@ void Game::Update(float deltaTime, float totalTime)
 
 	//update camera
 	camera->Update(deltaTime);
+	cameraFrame = camera->BuildFrame();
 
-
+	//step the smoke grid first, the emitter samples it while simulating
+	smokeFluid->Step(deltaTime);
 	//simulate particles
-	smokeEmitter->SimulateParticles(deltaTime, camera);
+	particleSystem->Simulate(deltaTime, cameraFrame);
 }
 
 // --------------------------------------------------------
@@ -644,11 +753,11 @@ void Game::Draw(float deltaTime, float totalTime)
 
 		ps->SetData("lights", &lightArray[0], sizeof(Light) * (int)lightArray.size());
 
-		gameEntities[i]->Draw(context, camera);
+		gameEntities[i]->Draw(context, cameraFrame);
 	}
 
 	//draw sky with 6 textures
-	skyObject1->Draw(context, camera);
+	skyObject1->Draw(context, cameraFrame);
 
 	//draw particles
 	DrawParticles();
@@ -14,6 +14,9 @@
 #include"WICTextureLoader.h"
 #include"Sky.h"
 #include"ParticleEmitter.h"
+#include"ParticleSystem.h"
+#include"ParticleCore/ParticleBvh.h"
+#include"ParticleCore/ParticleFluidSolver.h"
 
 class Game 
 	: public DXCore
@@ -67,6 +70,7 @@ private:
 	std::shared_ptr<SimplePixelShader> pixelShader_Normal;	
 	std::shared_ptr<SimpleVertexShader> vertexShader_Particles;
 	std::shared_ptr<SimplePixelShader> pixelShader_Particles;
+	std::shared_ptr<SimpleVertexShader> vertexShader_ParticlesInstanced;
 
 	// Mesh Stuff
 
@@ -89,6 +93,8 @@ private:
 
 	// Camera stuff
 	std::shared_ptr<Camera> camera;
+	//rebuilt every Update, everything drawn this frame reads from it
+	CameraFrame cameraFrame;
 
 	// Light stuff
 
@@ -147,7 +153,15 @@ private:
 	std::shared_ptr<Sky> skyObject2;
 
 	//Particle stuff
+	//every emitter, drawn from shared buffers with one draw per material
+	std::shared_ptr<ParticleSystem> particleSystem;
 	std::shared_ptr<ParticleEmitter> smokeEmitter;
+	//grid smoke solver the emitter's particles are advected through
+	std::shared_ptr<ParticleFluidSolver> smokeFluid;
+	//roof and wall triangles the smoke collides with
+	std::shared_ptr<ParticleBvh> sceneBvh;
+	//worker threads shared by every emitter
+	std::shared_ptr<JobSystem> jobSystem;
 
 	void DrawParticles();
 
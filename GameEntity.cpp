@@ -31,9 +31,9 @@ void GameEntity::SetMesh(std::shared_ptr<Mesh> mesh)
 	this->mesh = mesh;
 }
 
-void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, std::shared_ptr<Camera> camera)
+void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, const CameraFrame& cameraFrame)
 {
-	material->PrepareMaterial(&transform, camera);
+	material->PrepareMaterial(&transform, cameraFrame);
 
 	mesh->Draw();
 }
@@ -23,5 +23,5 @@ public:
 	void SetMaterial(std::shared_ptr<Material> material);
 	void SetMesh(std::shared_ptr<Mesh> mesh);
 
-	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, std::shared_ptr<Camera> camera);
+	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, const CameraFrame& cameraFrame);
 };
@@ -63,7 +63,7 @@ void Material::AddSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11Sa
     mapSamplerState.insert({ name, samplerState });
 }
 
-void Material::PrepareMaterial(Transformation* transform, std::shared_ptr<Camera> camera)
+void Material::PrepareMaterial(Transformation* transform, const CameraFrame& cameraFrame)
 {
     //Adding srv, sampler state, and material specific properties
     //color tint, roughness
@@ -77,11 +77,11 @@ void Material::PrepareMaterial(Transformation* transform, std::shared_ptr<Camera
     }
 
     vertexShader->SetMatrix4x4("worldMatrix", transform->GetWorldMatrix());
-    vertexShader->SetMatrix4x4("viewMatrix", camera->GetViewMatrix());
-    vertexShader->SetMatrix4x4("projectionMatrix", camera->GetProjectionMatrix());
+    vertexShader->SetMatrix4x4("viewMatrix", cameraFrame.view);
+    vertexShader->SetMatrix4x4("projectionMatrix", cameraFrame.projection);
     vertexShader->SetMatrix4x4("worldInvTransMatrix", transform->GetWorldInverseMatrix());
 
-    pixelShader->SetFloat3("cameraPosition", camera->GetTransform()->GetPosition());
+    pixelShader->SetFloat3("cameraPosition", cameraFrame.position);
 
     //material specific properties via simple shader
     pixelShader->SetFloat4("colorTint", GetColorTint());
@@ -35,7 +35,7 @@ public:
 	void AddShaderView(const char* name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderView);
 	void AddSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
 
-	void PrepareMaterial(Transformation* transform, std::shared_ptr<Camera> camera);
+	void PrepareMaterial(Transformation* transform, const CameraFrame& cameraFrame);
 #pragma endregion
 
 private:
@@ -38,6 +38,14 @@ void Mesh::Draw()
 void Mesh::CreateBuffers(Vertex* vertexArray, int numVertices, unsigned int* indexArray, int numIndices,
 	Microsoft::WRL::ComPtr<ID3D11Device> device)
 {
+	//keep the positions and indices around after upload
+	cpuPositions.resize(numVertices);
+	for (int i = 0; i < numVertices; i++)
+	{
+		cpuPositions[i] = vertexArray[i].Position;
+	}
+	cpuIndices.assign(indexArray, indexArray + numIndices);
+
 	//Create vertex buffer and fill description
 	{
 		D3D11_BUFFER_DESC vbDescription = {};
@@ -15,6 +15,10 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;      
 	int indexCount;
 
+	//CPU copy of the geometry for emission shapes and queries, same order as the GPU buffers
+	std::vector<DirectX::XMFLOAT3> cpuPositions;
+	std::vector<unsigned int> cpuIndices;
+
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 
 	
@@ -24,6 +28,9 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
 	
 	int GetIndexCount();
+
+	const std::vector<DirectX::XMFLOAT3>& GetPositions() const { return cpuPositions; }
+	const std::vector<unsigned int>& GetIndices() const { return cpuIndices; }
 	
 	void Draw();
 	
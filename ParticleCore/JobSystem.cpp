@@ -0,0 +1,159 @@
+#include "JobSystem.h"
+
+namespace
+{
+	//queue index of the worker running on this thread, -1 outside the pool
+	thread_local int workerQueueIndex = -1;
+	thread_local const JobSystem* workerOwner = nullptr;
+}
+
+JobSystem::JobSystem(int workerCount)
+{
+	Start(workerCount);
+}
+
+JobSystem::JobSystem()
+{
+	int hardwareThreads = (int)std::thread::hardware_concurrency();
+	Start(hardwareThreads > 1 ? hardwareThreads - 1 : 0);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		quit = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& t : threads)
+	{
+		t.join();
+	}
+}
+
+void JobSystem::Start(int workerCount)
+{
+	queuedJobs = 0;
+	quit = false;
+
+	for (int i = 0; i <= workerCount; i++)
+	{
+		queues.push_back(std::make_unique<WorkQueue>());
+	}
+	for (int i = 0; i < workerCount; i++)
+	{
+		threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+void JobSystem::ParallelFor(int count, int chunkSize, const std::function<void(int, int)>& body)
+{
+	if (count <= 0)
+		return;
+	if (chunkSize < 1)
+		chunkSize = 1;
+
+	//not worth a round trip through the queues
+	if (threads.empty() || count <= chunkSize)
+	{
+		body(0, count);
+		return;
+	}
+
+	int chunkCount = (count + chunkSize - 1) / chunkSize;
+	std::atomic<int> pending(chunkCount);
+
+	//deal chunks round robin so every worker starts with local work, stealing evens out the rest
+	int queueIndex = GetCurrentQueueIndex();
+	for (int c = 0; c < chunkCount; c++)
+	{
+		int begin = c * chunkSize;
+		int end = begin + chunkSize < count ? begin + chunkSize : count;
+		Push((queueIndex + c) % (int)queues.size(), Job{ &body, begin, end, &pending });
+	}
+	//a worker between its last empty check and its wait still holds wakeMutex, so this cannot be missed
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+	}
+	wake.notify_all();
+
+	//help until our loop is finished, possibly running other loops' jobs meanwhile
+	while (pending.load(std::memory_order_acquire) > 0)
+	{
+		if (!TryRunJob(queueIndex))
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::WorkerLoop(int queueIndex)
+{
+	workerQueueIndex = queueIndex;
+	workerOwner = this;
+
+	while (true)
+	{
+		if (TryRunJob(queueIndex))
+			continue;
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wake.wait(lock, [this] { return quit || queuedJobs.load() > 0; });
+		if (quit)
+			return;
+	}
+}
+
+void JobSystem::Push(int queueIndex, const Job& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(queues[queueIndex]->mutex);
+		queues[queueIndex]->jobs.push_back(job);
+	}
+	queuedJobs.fetch_add(1);
+}
+
+bool JobSystem::TryRunJob(int queueIndex)
+{
+	Job job = {};
+	bool found = false;
+
+	//own work, newest first
+	{
+		WorkQueue& own = *queues[queueIndex];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty())
+		{
+			job = own.jobs.back();
+			own.jobs.pop_back();
+			found = true;
+		}
+	}
+
+	//steal the oldest job of another queue
+	for (int i = 1; !found && i < (int)queues.size(); i++)
+	{
+		WorkQueue& victim = *queues[(queueIndex + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+			found = true;
+		}
+	}
+
+	if (!found)
+		return false;
+
+	queuedJobs.fetch_sub(1);
+	(*job.body)(job.begin, job.end);
+	job.pending->fetch_sub(1, std::memory_order_release);
+	return true;
+}
+
+int JobSystem::GetCurrentQueueIndex() const
+{
+	if (workerOwner == this)
+		return workerQueueIndex;
+	return (int)queues.size() - 1;
+}
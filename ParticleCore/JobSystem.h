@@ -0,0 +1,63 @@
+#pragma once
+
+#include<atomic>
+#include<condition_variable>
+#include<deque>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+//Work stealing job system used to split particle stages across cores.
+//Every worker owns a deque: it pops its own jobs from the back and steals from the front of the others.
+//The thread calling ParallelFor has a deque too and works on the loop until it is done.
+class JobSystem
+{
+public:
+	//workerCount threads on top of the calling thread, 0 runs everything inline
+	explicit JobSystem(int workerCount);
+	//one worker per hardware thread, minus the caller
+	JobSystem();
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	int GetWorkerCount() const { return (int)threads.size(); }
+
+	//call body(begin, end) over [0, count) in chunks of chunkSize, returns once every chunk ran
+	//chunk boundaries are multiples of chunkSize, so results do not depend on which thread ran a chunk
+	void ParallelFor(int count, int chunkSize, const std::function<void(int, int)>& body);
+
+private:
+	struct Job
+	{
+		const std::function<void(int, int)>* body;
+		int begin;
+		int end;
+		std::atomic<int>* pending;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	//one queue per worker, the last one is shared by threads outside the pool
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	std::vector<std::thread> threads;
+
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	std::atomic<int> queuedJobs;
+	bool quit;
+
+	void Start(int workerCount);
+	void WorkerLoop(int queueIndex);
+	void Push(int queueIndex, const Job& job);
+	//run one job, own queue first then steal, false when every queue is empty
+	bool TryRunJob(int queueIndex);
+	int GetCurrentQueueIndex() const;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include"ParticleMath.h"
+
+//per particle state lives in ParticleData (structure of arrays)
+
+//vertex layout consumed by VertexShader_Particles.hlsl
+struct ParticleVertex
+{
+	Float3 Position;
+	Float2 UV;
+	Float4 Color;
+};
+
+//one record per particle for the instanced path, VertexShader_ParticlesInstanced.hlsl
+//expands it to a camera facing quad from SV_VertexID
+struct ParticleInstance
+{
+	Float3 Center;
+	float Size;
+	//RGBA8, red in the low byte
+	unsigned int Color;
+	//radians around the view direction
+	float Rotation;
+};
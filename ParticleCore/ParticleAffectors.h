@@ -0,0 +1,256 @@
+#pragma once
+
+#include"ParticleData.h"
+#include"ParticleMath.h"
+#include"ParticleSimd.h"
+#include<memory>
+#include<tuple>
+#include<utility>
+
+//Forces and constraints on particle motion, composed at compile time.
+//Every affector is a small struct working on one SIMD batch of particles held in registers (ParticleLanes).
+//ParticleAffectorPipeline<A, B, ...> inlines all of them into a single loop over the SoA streams:
+//Apply of every affector (velocity changes), then p += v * dt, then Constrain of every affector (collisions).
+//Advance runs once per frame before any batch, on one thread, for affectors with state that moves over time.
+//It must be exact for any dt: a skip before a prewarm's last lifetime hands it the whole skipped interval at once.
+//The affectors of the noise, fluid, BVH and distance field modules are in their own headers, so only the emitters
+//that use a module depend on it.
+
+//one batch of PARTICLE_SIMD_WIDTH particles
+struct ParticleLanes
+{
+	SimdFloat positionX, positionY, positionZ;
+	SimdFloat velocityX, velocityY, velocityZ;
+	//already advanced to the end of the frame
+	SimdFloat age;
+};
+
+//no-op hooks, affectors hide the ones they use
+struct ParticleAffector
+{
+	void Advance(float dt) {}
+	void Apply(ParticleLanes& lanes, SimdFloat dt) const {}
+	void Constrain(ParticleLanes& lanes, SimdFloat dt) const {}
+};
+
+//constant acceleration
+struct GravityAffector : ParticleAffector
+{
+	Float3 acceleration;
+
+	GravityAffector(Float3 acceleration) : acceleration(acceleration) {}
+
+	void Apply(ParticleLanes& lanes, SimdFloat dt) const
+	{
+		lanes.velocityX = SimdMulAdd(SimdSet1(acceleration.x), dt, lanes.velocityX);
+		lanes.velocityY = SimdMulAdd(SimdSet1(acceleration.y), dt, lanes.velocityY);
+		lanes.velocityZ = SimdMulAdd(SimdSet1(acceleration.z), dt, lanes.velocityZ);
+	}
+};
+
+//velocity loses coefficient * dt of itself per step, clamped so it never reverses
+struct LinearDragAffector : ParticleAffector
+{
+	float coefficient;
+
+	LinearDragAffector(float coefficient) : coefficient(coefficient) {}
+
+	void Apply(ParticleLanes& lanes, SimdFloat dt) const
+	{
+		SimdFloat keep = SimdMax(SimdSet1(0.0f), SimdSub(SimdSet1(1.0f), SimdMul(SimdSet1(coefficient), dt)));
+		lanes.velocityX = SimdMul(lanes.velocityX, keep);
+		lanes.velocityY = SimdMul(lanes.velocityY, keep);
+		lanes.velocityZ = SimdMul(lanes.velocityZ, keep);
+	}
+};
+
+//pulls velocity towards the wind velocity, coupling is the fraction of the difference closed per second
+struct WindAffector : ParticleAffector
+{
+	Float3 velocity;
+	float coupling;
+
+	WindAffector(Float3 velocity, float coupling) : velocity(velocity), coupling(coupling) {}
+
+	void Apply(ParticleLanes& lanes, SimdFloat dt) const
+	{
+		SimdFloat t = SimdMin(SimdSet1(1.0f), SimdMul(SimdSet1(coupling), dt));
+		lanes.velocityX = SimdMulAdd(SimdSub(SimdSet1(velocity.x), lanes.velocityX), t, lanes.velocityX);
+		lanes.velocityY = SimdMulAdd(SimdSub(SimdSet1(velocity.y), lanes.velocityY), t, lanes.velocityY);
+		lanes.velocityZ = SimdMulAdd(SimdSub(SimdSet1(velocity.z), lanes.velocityZ), t, lanes.velocityZ);
+	}
+};
+
+//hot smoke rises: upward acceleration of lift that fades linearly to 0 as the particle cools over coolingTime
+struct BuoyancyAffector : ParticleAffector
+{
+	float lift;
+	float coolingTime;
+
+	BuoyancyAffector(float lift, float coolingTime) : lift(lift), coolingTime(coolingTime) {}
+
+	void Apply(ParticleLanes& lanes, SimdFloat dt) const
+	{
+		SimdFloat heat = SimdMax(SimdSet1(0.0f), SimdSub(SimdSet1(1.0f), SimdMul(lanes.age, SimdSet1(1.0f / coolingTime))));
+		lanes.velocityY = SimdMulAdd(SimdMul(SimdSet1(lift), heat), dt, lanes.velocityY);
+	}
+};
+
+//swirl around a line through center along axis (unit length), strength / (1 + distance^2) falloff
+struct VortexAffector : ParticleAffector
+{
+	Float3 center;
+	Float3 axis;
+	float strength;
+
+	VortexAffector(Float3 center, Float3 axis, float strength) : center(center), axis(axis), strength(strength) {}
+
+	void Apply(ParticleLanes& lanes, SimdFloat dt) const
+	{
+		SimdFloat rx = SimdSub(lanes.positionX, SimdSet1(center.x));
+		SimdFloat ry = SimdSub(lanes.positionY, SimdSet1(center.y));
+		SimdFloat rz = SimdSub(lanes.positionZ, SimdSet1(center.z));
+		SimdFloat ax = SimdSet1(axis.x);
+		SimdFloat ay = SimdSet1(axis.y);
+		SimdFloat az = SimdSet1(axis.z);
+
+		//axis x r is tangential and already scales with the distance from the axis
+		SimdFloat tx = SimdSub(SimdMul(ay, rz), SimdMul(az, ry));
+		SimdFloat ty = SimdSub(SimdMul(az, rx), SimdMul(ax, rz));
+		SimdFloat tz = SimdSub(SimdMul(ax, ry), SimdMul(ay, rx));
+		SimdFloat distanceSq = SimdMulAdd(tx, tx, SimdMulAdd(ty, ty, SimdMul(tz, tz)));
+		SimdFloat scale = SimdDiv(SimdMul(SimdSet1(strength), dt), SimdAdd(SimdSet1(1.0f), distanceSq));
+
+		lanes.velocityX = SimdMulAdd(tx, scale, lanes.velocityX);
+		lanes.velocityY = SimdMulAdd(ty, scale, lanes.velocityY);
+		lanes.velocityZ = SimdMulAdd(tz, scale, lanes.velocityZ);
+	}
+};
+
+//inverse square pull towards position (push for a negative strength), distances clamped to minDistance
+struct PointAttractorAffector : ParticleAffector
+{
+	Float3 position;
+	float strength;
+	float minDistance;
+
+	PointAttractorAffector(Float3 position, float strength, float minDistance)
+		: position(position), strength(strength), minDistance(minDistance) {}
+
+	void Apply(ParticleLanes& lanes, SimdFloat dt) const
+	{
+		SimdFloat dx = SimdSub(SimdSet1(position.x), lanes.positionX);
+		SimdFloat dy = SimdSub(SimdSet1(position.y), lanes.positionY);
+		SimdFloat dz = SimdSub(SimdSet1(position.z), lanes.positionZ);
+		SimdFloat distanceSq = SimdMax(SimdSet1(minDistance * minDistance), SimdMulAdd(dx, dx, SimdMulAdd(dy, dy, SimdMul(dz, dz))));
+		//strength / d^2 along d / |d|
+		SimdFloat scale = SimdDiv(SimdMul(SimdSet1(strength), dt), SimdMul(distanceSq, SimdSqrt(distanceSq)));
+
+		lanes.velocityX = SimdMulAdd(dx, scale, lanes.velocityX);
+		lanes.velocityY = SimdMulAdd(dy, scale, lanes.velocityY);
+		lanes.velocityZ = SimdMulAdd(dz, scale, lanes.velocityZ);
+	}
+};
+
+//horizontal plane at height: particles below it are put back on it and bounce with restitution,
+//friction is the fraction of horizontal velocity lost per bounce
+struct GroundBounceAffector : ParticleAffector
+{
+	float height;
+	float restitution;
+	float friction;
+
+	GroundBounceAffector(float height, float restitution, float friction)
+		: height(height), restitution(restitution), friction(friction) {}
+
+	void Constrain(ParticleLanes& lanes, SimdFloat dt) const
+	{
+		SimdFloat ground = SimdSet1(height);
+		SimdFloat hit = SimdLess(lanes.positionY, ground);
+		SimdFloat falling = SimdLess(lanes.velocityY, SimdSet1(0.0f));
+		SimdFloat bounce = SimdSelect(falling, SimdMul(lanes.velocityY, SimdSet1(-restitution)), lanes.velocityY);
+		SimdFloat slide = SimdSet1(1.0f - friction);
+
+		lanes.positionY = SimdSelect(hit, ground, lanes.positionY);
+		lanes.velocityY = SimdSelect(hit, bounce, lanes.velocityY);
+		lanes.velocityX = SimdSelect(hit, SimdMul(lanes.velocityX, slide), lanes.velocityX);
+		lanes.velocityZ = SimdSelect(hit, SimdMul(lanes.velocityZ, slide), lanes.velocityZ);
+	}
+};
+
+//type erased pipeline so an emitter can hold any composition, one virtual call per chunk not per particle
+class ParticleAffectorStage
+{
+public:
+	virtual ~ParticleAffectorStage() {}
+	//once per frame before Run
+	virtual void Advance(float dt) = 0;
+	//move particles [begin, end) by dt, begin must be a multiple of PARTICLE_STREAM_ALIGNMENT
+	//lanes past end (stream padding) are moved too and ignored
+	virtual void Run(ParticleData& particles, int begin, int end, float dt) const = 0;
+};
+
+//Run is compiled at the library's baseline width, not dispatched per cpu like the kernels (see ParticleKernelTable)
+template<typename... Affectors>
+class ParticleAffectorPipeline : public ParticleAffectorStage
+{
+public:
+	ParticleAffectorPipeline(const Affectors&... affectors) : affectors(affectors...) {}
+
+	void Advance(float dt) override
+	{
+		AdvanceAll(dt, std::index_sequence_for<Affectors...>());
+	}
+
+	void Run(ParticleData& particles, int begin, int end, float dt) const override
+	{
+		const SimdFloat vDt = SimdSet1(dt);
+		for (int i = begin; i < end; i += PARTICLE_SIMD_WIDTH)
+		{
+			ParticleLanes lanes;
+			lanes.positionX = SimdLoad(particles.PositionX + i);
+			lanes.positionY = SimdLoad(particles.PositionY + i);
+			lanes.positionZ = SimdLoad(particles.PositionZ + i);
+			lanes.velocityX = SimdLoad(particles.VelocityX + i);
+			lanes.velocityY = SimdLoad(particles.VelocityY + i);
+			lanes.velocityZ = SimdLoad(particles.VelocityZ + i);
+			lanes.age = SimdLoad(particles.Age + i);
+
+			ApplyAll(lanes, vDt, std::index_sequence_for<Affectors...>());
+
+			lanes.positionX = SimdMulAdd(lanes.velocityX, vDt, lanes.positionX);
+			lanes.positionY = SimdMulAdd(lanes.velocityY, vDt, lanes.positionY);
+			lanes.positionZ = SimdMulAdd(lanes.velocityZ, vDt, lanes.positionZ);
+
+			ConstrainAll(lanes, vDt, std::index_sequence_for<Affectors...>());
+
+			SimdStore(particles.PositionX + i, lanes.positionX);
+			SimdStore(particles.PositionY + i, lanes.positionY);
+			SimdStore(particles.PositionZ + i, lanes.positionZ);
+			SimdStore(particles.VelocityX + i, lanes.velocityX);
+			SimdStore(particles.VelocityY + i, lanes.velocityY);
+			SimdStore(particles.VelocityZ + i, lanes.velocityZ);
+		}
+	}
+
+private:
+	std::tuple<Affectors...> affectors;
+
+	template<size_t... I>
+	void AdvanceAll(float dt, std::index_sequence<I...>)
+	{
+		(std::get<I>(affectors).Advance(dt), ...);
+	}
+
+	template<size_t... I>
+	void ApplyAll(ParticleLanes& lanes, SimdFloat dt, std::index_sequence<I...>) const
+	{
+		(std::get<I>(affectors).Apply(lanes, dt), ...);
+	}
+
+	template<size_t... I>
+	void ConstrainAll(ParticleLanes& lanes, SimdFloat dt, std::index_sequence<I...>) const
+	{
+		(std::get<I>(affectors).Constrain(lanes, dt), ...);
+	}
+};
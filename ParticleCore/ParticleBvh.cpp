@@ -0,0 +1,478 @@
+#include "ParticleBvh.h"
+#include "ParticleSimd.h"
+#include <algorithm>
+#include <cfloat>
+
+namespace
+{
+	//SAH bins per axis
+	const int binCount = 12;
+	//a node this small stays a leaf when no split is cheaper
+	const int maxLeafSize = 8;
+	//nodes the traversal can have pending, the tree depth stays far below it for any real scene
+	const int traversalStackSize = 64;
+
+	Float3 Sub(Float3 a, Float3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	Float3 Cross(Float3 a, Float3 b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+	float Dot(Float3 a, Float3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	Float3 Min(Float3 a, Float3 b) { return { std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z) }; }
+	Float3 Max(Float3 a, Float3 b) { return { std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z) }; }
+	float Axis(Float3 v, int axis) { return axis == 0 ? v.x : (axis == 1 ? v.y : v.z); }
+
+	//half the surface area, enough to compare SAH costs
+	float HalfArea(Float3 boundsMin, Float3 boundsMax)
+	{
+		Float3 e = Sub(boundsMax, boundsMin);
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+
+	struct Bin
+	{
+		Float3 boundsMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+		Float3 boundsMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		int count = 0;
+	};
+
+	//1 / d with zero components replaced by a huge value of the same sign, so the slab test never sees 0 * inf
+	float SafeInverse(float d)
+	{
+		const float tiny = 1.0e-20f;
+		return 1.0f / (std::fabs(d) > tiny ? d : (d < 0.0f ? -tiny : tiny));
+	}
+
+	//squared distance from p to the box, 0 inside it
+	float BoxDistanceSq(Float3 boundsMin, Float3 boundsMax, Float3 p)
+	{
+		float dx = std::max(std::max(boundsMin.x - p.x, p.x - boundsMax.x), 0.0f);
+		float dy = std::max(std::max(boundsMin.y - p.y, p.y - boundsMax.y), 0.0f);
+		float dz = std::max(std::max(boundsMin.z - p.z, p.z - boundsMax.z), 0.0f);
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	//closest point on triangle abc to p, by the Voronoi regions of its vertices, edges and face
+	Float3 ClosestOnTriangle(Float3 p, Float3 a, Float3 b, Float3 c)
+	{
+		Float3 ab = Sub(b, a), ac = Sub(c, a), ap = Sub(p, a);
+		float d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return a;
+
+		Float3 bp = Sub(p, b);
+		float d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3)
+			return b;
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		{
+			float v = d1 / (d1 - d3);
+			return { a.x + ab.x * v, a.y + ab.y * v, a.z + ab.z * v };
+		}
+
+		Float3 cp = Sub(p, c);
+		float d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6)
+			return c;
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		{
+			float w = d2 / (d2 - d6);
+			return { a.x + ac.x * w, a.y + ac.y * w, a.z + ac.z * w };
+		}
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		{
+			float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			return { b.x + (c.x - b.x) * w, b.y + (c.y - b.y) * w, b.z + (c.z - b.z) * w };
+		}
+
+		float denominator = 1.0f / (va + vb + vc);
+		float v = vb * denominator, w = vc * denominator;
+		return { a.x + ab.x * v + ac.x * w, a.y + ab.y * v + ac.y * w, a.z + ab.z * v + ac.z * w };
+	}
+
+	//entry distance of the ray into the box if it enters before tMax, FLT_MAX otherwise
+	float EnterBox(Float3 boundsMin, Float3 boundsMax, Float3 origin, Float3 inverseDirection, float tMax)
+	{
+		float tx0 = (boundsMin.x - origin.x) * inverseDirection.x, tx1 = (boundsMax.x - origin.x) * inverseDirection.x;
+		float ty0 = (boundsMin.y - origin.y) * inverseDirection.y, ty1 = (boundsMax.y - origin.y) * inverseDirection.y;
+		float tz0 = (boundsMin.z - origin.z) * inverseDirection.z, tz1 = (boundsMax.z - origin.z) * inverseDirection.z;
+		float tEnter = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), 0.0f));
+		float tExit = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), tMax));
+		return tEnter <= tExit ? tEnter : FLT_MAX;
+	}
+}
+
+ParticleBvh::ParticleBvh()
+{
+}
+
+void ParticleBvh::AddMesh(const Float3* positions, int vertexCount, const unsigned int* indices, int indexCount)
+{
+	unsigned int base = (unsigned int)buildPositions.size();
+	buildPositions.insert(buildPositions.end(), positions, positions + vertexCount);
+	for (int i = 0; i + 2 < indexCount; i += 3)
+	{
+		buildIndices.push_back(base + indices[i]);
+		buildIndices.push_back(base + indices[i + 1]);
+		buildIndices.push_back(base + indices[i + 2]);
+	}
+}
+
+void ParticleBvh::Clear()
+{
+	buildPositions.clear();
+	buildIndices.clear();
+	triangles.clear();
+	nodes.clear();
+}
+
+void ParticleBvh::Build()
+{
+	int triangleCount = (int)buildIndices.size() / 3;
+	std::vector<Triangle> source;
+	std::vector<Float3> centroids, boundsMin, boundsMax;
+	source.reserve(triangleCount);
+	for (int t = 0; t < triangleCount; t++)
+	{
+		Float3 a = buildPositions[buildIndices[t * 3]];
+		Float3 b = buildPositions[buildIndices[t * 3 + 1]];
+		Float3 c = buildPositions[buildIndices[t * 3 + 2]];
+		Float3 edge1 = Sub(b, a);
+		Float3 edge2 = Sub(c, a);
+		Float3 normal = Cross(edge1, edge2);
+		float length = std::sqrt(Dot(normal, normal));
+		//degenerate triangles can never be hit, leave them out of the tree
+		if (!(length > 0.0f))
+			continue;
+
+		source.push_back({ a, edge1, edge2, { normal.x / length, normal.y / length, normal.z / length } });
+		centroids.push_back({ (a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f });
+		boundsMin.push_back(Min(Min(a, b), c));
+		boundsMax.push_back(Max(Max(a, b), c));
+	}
+
+	std::vector<int> order(source.size());
+	for (int i = 0; i < (int)order.size(); i++)
+	{
+		order[i] = i;
+	}
+
+	//a binary tree over n leaves has at most 2n - 1 nodes
+	nodes.clear();
+	nodes.reserve(std::max<size_t>(1, source.size() * 2));
+	nodes.push_back({ { 0.0f, 0.0f, 0.0f }, 0, { 0.0f, 0.0f, 0.0f }, (int)source.size() });
+	if (!source.empty())
+		Subdivide(0, order, centroids, boundsMin, boundsMax);
+
+	//leaves index straight into triangles, in tree order so a leaf's triangles are contiguous
+	triangles.resize(source.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		triangles[i] = source[order[i]];
+	}
+}
+
+void ParticleBvh::Subdivide(int node, std::vector<int>& order, const std::vector<Float3>& centroids,
+	const std::vector<Float3>& boundsMin, const std::vector<Float3>& boundsMax)
+{
+	int first = nodes[node].first;
+	int count = nodes[node].count;
+
+	Float3 nodeMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+	Float3 nodeMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	Float3 centroidMin = nodeMin;
+	Float3 centroidMax = nodeMax;
+	for (int i = first; i < first + count; i++)
+	{
+		nodeMin = Min(nodeMin, boundsMin[order[i]]);
+		nodeMax = Max(nodeMax, boundsMax[order[i]]);
+		centroidMin = Min(centroidMin, centroids[order[i]]);
+		centroidMax = Max(centroidMax, centroids[order[i]]);
+	}
+	nodes[node].boundsMin = nodeMin;
+	nodes[node].boundsMax = nodeMax;
+
+	//cheapest plane over the bin boundaries of all 3 axes
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestSplit = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float low = Axis(centroidMin, axis);
+		float extent = Axis(centroidMax, axis) - low;
+		if (!(extent > 0.0f))
+			continue;
+
+		Bin bins[binCount];
+		float scale = binCount / extent;
+		for (int i = first; i < first + count; i++)
+		{
+			int b = std::min(binCount - 1, (int)((Axis(centroids[order[i]], axis) - low) * scale));
+			bins[b].count++;
+			bins[b].boundsMin = Min(bins[b].boundsMin, boundsMin[order[i]]);
+			bins[b].boundsMax = Max(bins[b].boundsMax, boundsMax[order[i]]);
+		}
+
+		//left sweep, then right sweep adding up the cost of every plane
+		float leftArea[binCount - 1];
+		int leftCount[binCount - 1];
+		Bin left;
+		for (int b = 0; b < binCount - 1; b++)
+		{
+			left.count += bins[b].count;
+			left.boundsMin = Min(left.boundsMin, bins[b].boundsMin);
+			left.boundsMax = Max(left.boundsMax, bins[b].boundsMax);
+			leftCount[b] = left.count;
+			leftArea[b] = left.count > 0 ? HalfArea(left.boundsMin, left.boundsMax) : 0.0f;
+		}
+		Bin right;
+		for (int b = binCount - 1; b > 0; b--)
+		{
+			right.count += bins[b].count;
+			right.boundsMin = Min(right.boundsMin, bins[b].boundsMin);
+			right.boundsMax = Max(right.boundsMax, bins[b].boundsMax);
+			if (right.count == 0 || leftCount[b - 1] == 0)
+				continue;
+
+			float cost = leftCount[b - 1] * leftArea[b - 1] + right.count * HalfArea(right.boundsMin, right.boundsMax);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+
+	//traversing one more node costs about as much as one triangle test
+	float leafCost = count * HalfArea(nodeMin, nodeMax);
+	if (bestAxis < 0 || (count <= maxLeafSize && bestCost >= leafCost))
+		return;
+
+	float low = Axis(centroidMin, bestAxis);
+	float scale = binCount / (Axis(centroidMax, bestAxis) - low);
+	int* middle = std::partition(order.data() + first, order.data() + first + count, [&](int t) {
+		return std::min(binCount - 1, (int)((Axis(centroids[t], bestAxis) - low) * scale)) < bestSplit;
+	});
+	int leftCount = (int)(middle - (order.data() + first));
+
+	int leftChild = (int)nodes.size();
+	nodes.push_back({ { 0.0f, 0.0f, 0.0f }, first, { 0.0f, 0.0f, 0.0f }, leftCount });
+	nodes.push_back({ { 0.0f, 0.0f, 0.0f }, first + leftCount, { 0.0f, 0.0f, 0.0f }, count - leftCount });
+	nodes[node].first = leftChild;
+	nodes[node].count = 0;
+
+	Subdivide(leftChild, order, centroids, boundsMin, boundsMax);
+	Subdivide(leftChild + 1, order, centroids, boundsMin, boundsMax);
+}
+
+bool ParticleBvh::IntersectSegment(Float3 start, Float3 end, ParticleBvhHit& hit) const
+{
+	hit.hit = false;
+	hit.t = 1.0f;
+	if (nodes.empty() || triangles.empty())
+		return false;
+
+	Float3 direction = Sub(end, start);
+	Float3 inverseDirection = { SafeInverse(direction.x), SafeInverse(direction.y), SafeInverse(direction.z) };
+	float tBest = 1.0f;
+	int bestTriangle = -1;
+
+	int stack[traversalStackSize];
+	int stackSize = 0;
+	if (EnterBox(nodes[0].boundsMin, nodes[0].boundsMax, start, inverseDirection, tBest) == FLT_MAX)
+		return false;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				const Triangle& triangle = triangles[i];
+				Float3 p = Cross(direction, triangle.edge2);
+				float det = Dot(triangle.edge1, p);
+				if (std::fabs(det) < 1.0e-12f)
+					continue;
+
+				float inverseDet = 1.0f / det;
+				Float3 s = Sub(start, triangle.v0);
+				float u = Dot(s, p) * inverseDet;
+				if (u < 0.0f || u > 1.0f)
+					continue;
+
+				Float3 q = Cross(s, triangle.edge1);
+				float v = Dot(direction, q) * inverseDet;
+				if (v < 0.0f || u + v > 1.0f)
+					continue;
+
+				float t = Dot(triangle.edge2, q) * inverseDet;
+				if (t >= 0.0f && t < tBest)
+				{
+					tBest = t;
+					bestTriangle = i;
+				}
+			}
+			continue;
+		}
+
+		//nearer child last so it is popped first, boxes behind the closest hit are skipped
+		float tLeft = EnterBox(nodes[node.first].boundsMin, nodes[node.first].boundsMax, start, inverseDirection, tBest);
+		float tRight = EnterBox(nodes[node.first + 1].boundsMin, nodes[node.first + 1].boundsMax, start, inverseDirection, tBest);
+		int nearChild = tLeft <= tRight ? node.first : node.first + 1;
+		int farChild = tLeft <= tRight ? node.first + 1 : node.first;
+		float tFar = std::max(tLeft, tRight);
+		float tNear = std::min(tLeft, tRight);
+		if (tFar != FLT_MAX && stackSize < traversalStackSize)
+			stack[stackSize++] = farChild;
+		if (tNear != FLT_MAX && stackSize < traversalStackSize)
+			stack[stackSize++] = nearChild;
+	}
+
+	if (bestTriangle < 0)
+		return false;
+
+	const Triangle& triangle = triangles[bestTriangle];
+	Float3 normal = triangle.normal;
+	if (Dot(normal, direction) > 0.0f)
+		normal = { -normal.x, -normal.y, -normal.z };
+
+	hit.hit = true;
+	hit.t = tBest;
+	hit.point = { start.x + direction.x * tBest, start.y + direction.y * tBest, start.z + direction.z * tBest };
+	hit.normal = normal;
+	return true;
+}
+
+void ParticleBvh::IntersectSegments(const float* startX, const float* startY, const float* startZ,
+	const float* endX, const float* endY, const float* endZ, int count, ParticleBvhHit* hits) const
+{
+	if (nodes.empty() || triangles.empty())
+	{
+		for (int i = 0; i < count; i++)
+		{
+			hits[i].hit = false;
+			hits[i].t = 1.0f;
+		}
+		return;
+	}
+
+	const Float3 sceneMin = nodes[0].boundsMin;
+	const Float3 sceneMax = nodes[0].boundsMax;
+	const SimdFloat minX = SimdSet1(sceneMin.x), minY = SimdSet1(sceneMin.y), minZ = SimdSet1(sceneMin.z);
+	const SimdFloat maxX = SimdSet1(sceneMax.x), maxY = SimdSet1(sceneMax.y), maxZ = SimdSet1(sceneMax.z);
+
+	int i = 0;
+	for (; i + PARTICLE_SIMD_WIDTH <= count; i += PARTICLE_SIMD_WIDTH)
+	{
+		//a segment whose box misses the scene box on any axis can not hit anything
+		SimdFloat sx = SimdLoadUnaligned(startX + i), ex = SimdLoadUnaligned(endX + i);
+		SimdFloat sy = SimdLoadUnaligned(startY + i), ey = SimdLoadUnaligned(endY + i);
+		SimdFloat sz = SimdLoadUnaligned(startZ + i), ez = SimdLoadUnaligned(endZ + i);
+		int missing = SimdMoveMask(SimdLess(SimdMax(sx, ex), minX)) | SimdMoveMask(SimdLess(maxX, SimdMin(sx, ex))) |
+			SimdMoveMask(SimdLess(SimdMax(sy, ey), minY)) | SimdMoveMask(SimdLess(maxY, SimdMin(sy, ey))) |
+			SimdMoveMask(SimdLess(SimdMax(sz, ez), minZ)) | SimdMoveMask(SimdLess(maxZ, SimdMin(sz, ez)));
+
+		for (int l = 0; l < PARTICLE_SIMD_WIDTH; l++)
+		{
+			if (missing & (1 << l))
+			{
+				hits[i + l].hit = false;
+				hits[i + l].t = 1.0f;
+				continue;
+			}
+			IntersectSegment({ startX[i + l], startY[i + l], startZ[i + l] }, { endX[i + l], endY[i + l], endZ[i + l] }, hits[i + l]);
+		}
+	}
+	for (; i < count; i++)
+	{
+		IntersectSegment({ startX[i], startY[i], startZ[i] }, { endX[i], endY[i], endZ[i] }, hits[i]);
+	}
+}
+
+bool ParticleBvh::FindClosest(Float3 position, float maxDistance, Float3& closest, Float3& normal) const
+{
+	if (nodes.empty() || triangles.empty())
+		return false;
+
+	float bestSq = maxDistance * maxDistance;
+	int bestTriangle = -1;
+
+	int stack[traversalStackSize];
+	int stackSize = 0;
+	if (BoxDistanceSq(nodes[0].boundsMin, nodes[0].boundsMax, position) > bestSq)
+		return false;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				const Triangle& triangle = triangles[i];
+				Float3 b = { triangle.v0.x + triangle.edge1.x, triangle.v0.y + triangle.edge1.y, triangle.v0.z + triangle.edge1.z };
+				Float3 c = { triangle.v0.x + triangle.edge2.x, triangle.v0.y + triangle.edge2.y, triangle.v0.z + triangle.edge2.z };
+				Float3 point = ClosestOnTriangle(position, triangle.v0, b, c);
+				Float3 offset = Sub(position, point);
+				float distanceSq = Dot(offset, offset);
+				if (distanceSq < bestSq)
+				{
+					bestSq = distanceSq;
+					bestTriangle = i;
+					closest = point;
+				}
+			}
+			continue;
+		}
+
+		//nearer box last so it is popped first, boxes farther than the best so far are skipped
+		float dLeft = BoxDistanceSq(nodes[node.first].boundsMin, nodes[node.first].boundsMax, position);
+		float dRight = BoxDistanceSq(nodes[node.first + 1].boundsMin, nodes[node.first + 1].boundsMax, position);
+		int nearChild = dLeft <= dRight ? node.first : node.first + 1;
+		int farChild = dLeft <= dRight ? node.first + 1 : node.first;
+		if (std::max(dLeft, dRight) < bestSq && stackSize < traversalStackSize)
+			stack[stackSize++] = farChild;
+		if (std::min(dLeft, dRight) < bestSq && stackSize < traversalStackSize)
+			stack[stackSize++] = nearChild;
+	}
+
+	if (bestTriangle < 0)
+		return false;
+	normal = triangles[bestTriangle].normal;
+	return true;
+}
+
+void ParticleBvh::GetBounds(Float3& boundsMin, Float3& boundsMax) const
+{
+	boundsMin = nodes.empty() ? Float3{ 0.0f, 0.0f, 0.0f } : nodes[0].boundsMin;
+	boundsMax = nodes.empty() ? Float3{ 0.0f, 0.0f, 0.0f } : nodes[0].boundsMax;
+}
+
+uint64_t ParticleBvh::GetContentHash() const
+{
+	//FNV-1a over the raw bytes
+	uint64_t hash = 0xcbf29ce484222325ull;
+	auto add = [&hash](const void* data, size_t bytes) {
+		const unsigned char* p = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < bytes; i++)
+		{
+			hash = (hash ^ p[i]) * 0x100000001b3ull;
+		}
+	};
+	add(buildPositions.data(), buildPositions.size() * sizeof(Float3));
+	add(buildIndices.data(), buildIndices.size() * sizeof(unsigned int));
+	return hash;
+}
+
+size_t ParticleBvh::GetMemoryBytes() const
+{
+	return nodes.capacity() * sizeof(Node) + triangles.capacity() * sizeof(Triangle) +
+		buildPositions.capacity() * sizeof(Float3) + buildIndices.capacity() * sizeof(unsigned int);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include"ParticleMath.h"
+#include<cstdint>
+#include<vector>
+
+//closest hit of a segment, t is the fraction of the way from start to end
+struct ParticleBvhHit
+{
+	bool hit;
+	float t;
+	Float3 point;
+	//unit geometric normal, facing the segment's start
+	Float3 normal;
+};
+
+//Bounding volume hierarchy over static world space triangles, built with the binned surface area heuristic.
+//Answers particle collision queries as segments from the previous to the current position, in batches
+//laid out like the particle streams. Queries only read the tree, so any number of threads may run them at once.
+class ParticleBvh
+{
+public:
+	ParticleBvh();
+
+	//append world space triangles, 3 indices each, Build must run before the next query
+	void AddMesh(const Float3* positions, int vertexCount, const unsigned int* indices, int indexCount);
+	void Build();
+	//drop every triangle and the tree
+	void Clear();
+
+	//closest hit along start -> end
+	bool IntersectSegment(Float3 start, Float3 end, ParticleBvhHit& hit) const;
+	//count segments from (startX[i], startY[i], startZ[i]) to (endX[i], endY[i], endZ[i]), one hit per segment.
+	//whole SIMD batches are first tested against the scene bounds, so particles away from geometry cost almost nothing
+	void IntersectSegments(const float* startX, const float* startY, const float* startZ,
+		const float* endX, const float* endY, const float* endZ, int count, ParticleBvhHit* hits) const;
+
+	//closest surface point to position within maxDistance, with the normal of its triangle (as wound, not flipped)
+	bool FindClosest(Float3 position, float maxDistance, Float3& closest, Float3& normal) const;
+
+	//bounds of every triangle, only valid after Build with at least one triangle
+	void GetBounds(Float3& boundsMin, Float3& boundsMax) const;
+	//hash of the added positions and indices, equal for equal input meshes, to key caches of data baked from them
+	uint64_t GetContentHash() const;
+
+	int GetTriangleCount() const { return (int)triangles.size(); }
+	int GetNodeCount() const { return (int)nodes.size(); }
+	size_t GetMemoryBytes() const;
+
+private:
+	//leaves hold count > 0 triangles from first, inner nodes have count 0 and children first, first + 1
+	struct Node
+	{
+		Float3 boundsMin;
+		int first;
+		Float3 boundsMax;
+		int count;
+	};
+
+	//precomputed for the Moller-Trumbore test
+	struct Triangle
+	{
+		Float3 v0;
+		Float3 edge1;
+		Float3 edge2;
+		Float3 normal;
+	};
+
+	std::vector<Float3> buildPositions;
+	std::vector<unsigned int> buildIndices;
+	std::vector<Triangle> triangles;
+	std::vector<Node> nodes;
+
+	//split the triangles order[first, first + count) of node at the cheapest binned SAH plane, or leave it a leaf
+	void Subdivide(int node, std::vector<int>& order, const std::vector<Float3>& centroids,
+		const std::vector<Float3>& boundsMin, const std::vector<Float3>& boundsMax);
+};
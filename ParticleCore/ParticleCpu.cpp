@@ -0,0 +1,97 @@
+#include "ParticleCpu.h"
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace
+{
+	void Cpuid(unsigned int leaf, unsigned int subleaf, unsigned int registers[4])
+	{
+#if defined(_MSC_VER)
+		int values[4];
+		__cpuidex(values, (int)leaf, (int)subleaf);
+		for (int r = 0; r < 4; r++)
+		{
+			registers[r] = (unsigned int)values[r];
+		}
+#else
+		__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+	}
+
+	//XCR0, which register files the OS saves
+	uint64_t ReadXcr0()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int low, high;
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		return ((uint64_t)high << 32) | low;
+#endif
+	}
+
+	struct CpuFeatures
+	{
+		bool sse41;
+		bool avx;
+		bool avx2;
+		bool avx512;
+	};
+
+	CpuFeatures DetectFeatures()
+	{
+		CpuFeatures features = { false, false, false, false };
+		unsigned int registers[4];
+		Cpuid(0, 0, registers);
+		unsigned int maxLeaf = registers[0];
+		if (maxLeaf < 1)
+			return features;
+
+		Cpuid(1, 0, registers);
+		features.sse41 = (registers[2] & (1u << 19)) != 0;
+		//AVX needs the OS to save the YMM halves (XCR0 bits 1 and 2), AVX-512 also the opmask and ZMM state (bits 5 to 7)
+		bool osxsave = (registers[2] & (1u << 27)) != 0;
+		uint64_t xcr0 = osxsave ? ReadXcr0() : 0;
+		bool ymmSaved = (xcr0 & 0x6) == 0x6;
+		bool zmmSaved = ymmSaved && (xcr0 & 0xe0) == 0xe0;
+		features.avx = ymmSaved && (registers[2] & (1u << 28)) != 0;
+
+		if (maxLeaf >= 7)
+		{
+			Cpuid(7, 0, registers);
+			features.avx2 = features.avx && (registers[1] & (1u << 5)) != 0;
+			features.avx512 = features.avx2 && zmmSaved && (registers[1] & (1u << 16)) != 0;
+		}
+		return features;
+	}
+}
+
+const char* GetParticleIsaName(ParticleIsa isa)
+{
+	switch (isa)
+	{
+	case ParticleIsa::Sse41: return "sse4.1";
+	case ParticleIsa::Avx: return "avx";
+	case ParticleIsa::Avx2: return "avx2";
+	case ParticleIsa::Avx512: return "avx512";
+	default: return "sse2";
+	}
+}
+
+bool IsParticleIsaSupported(ParticleIsa isa)
+{
+	static const CpuFeatures features = DetectFeatures();
+	switch (isa)
+	{
+	case ParticleIsa::Sse41: return features.sse41;
+	case ParticleIsa::Avx: return features.avx;
+	case ParticleIsa::Avx2: return features.avx2;
+	case ParticleIsa::Avx512: return features.avx512;
+	default: return true;
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+//x86 instruction sets the particle kernels are built for, in order of preference
+enum class ParticleIsa
+{
+	Sse2,
+	Sse41,
+	Avx,
+	Avx2,
+	Avx512
+};
+
+//lower case name, e.g. "avx2", as taken by the PARTICLE_KERNELS environment variable
+const char* GetParticleIsaName(ParticleIsa isa);
+//whether this cpu and the OS (register state saved on context switches) run code built for isa, from CPUID and XGETBV
+bool IsParticleIsaSupported(ParticleIsa isa);
@@ -0,0 +1,125 @@
+#include "ParticleCurves.h"
+#include <algorithm>
+#include <cmath>
+
+ParticleCurve::ParticleCurve(CurveInterpolation interpolation)
+	: interpolation(interpolation)
+{
+}
+
+ParticleCurve ParticleCurve::Linear(float start, float end)
+{
+	ParticleCurve curve(CurveInterpolation::Linear);
+	curve.AddKey(0.0f, start);
+	curve.AddKey(1.0f, end);
+	return curve;
+}
+
+void ParticleCurve::AddKey(float time, float value)
+{
+	time = std::min(1.0f, std::max(0.0f, time));
+	Float2 key = { time, value };
+	auto at = std::upper_bound(keys.begin(), keys.end(), key, [](const Float2& a, const Float2& b) { return a.x < b.x; });
+	keys.insert(at, key);
+}
+
+float ParticleCurve::Evaluate(float time) const
+{
+	if (keys.empty())
+		return 0.0f;
+	if (time <= keys.front().x)
+		return keys.front().y;
+	if (time >= keys.back().x)
+		return keys.back().y;
+
+	//segment k holds time
+	size_t k = 1;
+	while (keys[k].x < time)
+	{
+		k++;
+	}
+	const Float2& p0 = keys[k - 1];
+	const Float2& p1 = keys[k];
+	float width = p1.x - p0.x;
+	if (width <= 0.0f)
+		return p1.y;
+	float t = (time - p0.x) / width;
+
+	if (interpolation == CurveInterpolation::Linear)
+		return p0.y + (p1.y - p0.y) * t;
+
+	//secant slopes either side of a key, a key between rising and falling segments gets a flat tangent
+	auto secant = [&](size_t i) { return (keys[i + 1].y - keys[i].y) / std::max(keys[i + 1].x - keys[i].x, 1.0e-6f); };
+	auto tangent = [&](size_t i) {
+		if (i == 0)
+			return secant(0);
+		if (i == keys.size() - 1)
+			return secant(i - 1);
+		float before = secant(i - 1);
+		float after = secant(i);
+		if (before * after <= 0.0f)
+			return 0.0f;
+		//harmonic mean keeps the segment monotone
+		return 2.0f * before * after / (before + after);
+	};
+	float m0 = tangent(k - 1) * width;
+	float m1 = tangent(k) * width;
+
+	//cubic hermite basis
+	float t2 = t * t;
+	float t3 = t2 * t;
+	return (2.0f * t3 - 3.0f * t2 + 1.0f) * p0.y + (t3 - 2.0f * t2 + t) * m0 + (-2.0f * t3 + 3.0f * t2) * p1.y + (t3 - t2) * m1;
+}
+
+void ParticleCurve::Bake(float* table) const
+{
+	for (int i = 0; i < PARTICLE_CURVE_LUT_SIZE; i++)
+	{
+		table[i] = Evaluate((float)i / (PARTICLE_CURVE_LUT_SIZE - 1));
+	}
+}
+
+ParticleGradient::ParticleGradient(CurveInterpolation interpolation)
+	: red(interpolation), green(interpolation), blue(interpolation), alpha(interpolation)
+{
+}
+
+ParticleGradient ParticleGradient::Linear(Float4 start, Float4 end)
+{
+	ParticleGradient gradient(CurveInterpolation::Linear);
+	gradient.AddKey(0.0f, start);
+	gradient.AddKey(1.0f, end);
+	return gradient;
+}
+
+void ParticleGradient::AddKey(float time, Float4 color)
+{
+	AddColorKey(time, Float3{ color.x, color.y, color.z });
+	AddAlphaKey(time, color.w);
+}
+
+void ParticleGradient::AddColorKey(float time, Float3 color)
+{
+	red.AddKey(time, color.x);
+	green.AddKey(time, color.y);
+	blue.AddKey(time, color.z);
+}
+
+void ParticleGradient::AddAlphaKey(float time, float alpha)
+{
+	this->alpha.AddKey(time, alpha);
+}
+
+Float4 ParticleGradient::Evaluate(float time) const
+{
+	return Float4{ red.Evaluate(time), green.Evaluate(time), blue.Evaluate(time), alpha.Evaluate(time) };
+}
+
+void ParticleLifeTables::Bake(const ParticleCurve& size, const ParticleGradient& color)
+{
+	size.Bake(Size);
+	color.red.Bake(ColorR);
+	color.green.Bake(ColorG);
+	color.blue.Bake(ColorB);
+	color.alpha.Bake(ColorA);
+}
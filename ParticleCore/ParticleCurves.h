@@ -0,0 +1,84 @@
+#pragma once
+
+#include"ParticleMath.h"
+#include"ParticleSimd.h"
+#include<vector>
+
+//entries in every baked over-life table
+#define PARTICLE_CURVE_LUT_SIZE 256
+
+enum class CurveInterpolation
+{
+	Linear,
+	//monotone cubic (Fritsch-Carlson), eases between keys without overshooting them
+	Smooth
+};
+
+//Value over normalized particle life [0, 1], authored as keys and only evaluated when baking.
+class ParticleCurve
+{
+public:
+	ParticleCurve(CurveInterpolation interpolation = CurveInterpolation::Smooth);
+
+	//straight line from start to end, the same as the old start / end lerp
+	static ParticleCurve Linear(float start, float end);
+
+	//keys may be added in any order, time is clamped to [0, 1]
+	void AddKey(float time, float value);
+	int GetKeyCount() const { return (int)keys.size(); }
+
+	//constant outside the first / last key, 0 without keys
+	float Evaluate(float time) const;
+	//PARTICLE_CURVE_LUT_SIZE samples evenly spaced over [0, 1]
+	void Bake(float* table) const;
+
+private:
+	CurveInterpolation interpolation;
+	//sorted by time
+	std::vector<Float2> keys;
+};
+
+//Color over life, one curve per channel so color and alpha can be keyed at different times.
+class ParticleGradient
+{
+public:
+	ParticleGradient(CurveInterpolation interpolation = CurveInterpolation::Linear);
+
+	static ParticleGradient Linear(Float4 start, Float4 end);
+
+	//key all four channels
+	void AddKey(float time, Float4 color);
+	void AddColorKey(float time, Float3 color);
+	void AddAlphaKey(float time, float alpha);
+
+	Float4 Evaluate(float time) const;
+
+	ParticleCurve red;
+	ParticleCurve green;
+	ParticleCurve blue;
+	ParticleCurve alpha;
+};
+
+//Size and color over life baked for the update kernel, so curve complexity costs nothing per frame.
+struct ParticleLifeTables
+{
+	float Size[PARTICLE_CURVE_LUT_SIZE];
+	float ColorR[PARTICLE_CURVE_LUT_SIZE];
+	float ColorG[PARTICLE_CURVE_LUT_SIZE];
+	float ColorB[PARTICLE_CURVE_LUT_SIZE];
+	float ColorA[PARTICLE_CURVE_LUT_SIZE];
+
+	void Bake(const ParticleCurve& size, const ParticleGradient& color);
+};
+
+//table values at life ratios t, clamped to [0, 1], linear between entries.
+//Same ops at every SIMD width, so all kernel variants read the same bits
+static inline SimdFloat SimdSampleLifeTable(const float* table, SimdFloat t)
+{
+	t = SimdMin(SimdMax(t, SimdSet1(0.0f)), SimdSet1(1.0f));
+	SimdFloat x = SimdMul(t, SimdSet1((float)(PARTICLE_CURVE_LUT_SIZE - 1)));
+	SimdFloat index = SimdMin(SimdTruncate(x), SimdSet1((float)(PARTICLE_CURVE_LUT_SIZE - 2)));
+	SimdFloat a, b;
+	SimdGatherPair(table, index, a, b);
+	return SimdMulAdd(SimdSub(b, a), SimdSub(x, index), a);
+}
@@ -0,0 +1,75 @@
+#include "ParticleData.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	//every stream, in allocation order
+	float* ParticleData::* const streamMembers[ParticleData::StreamCount] = {
+		&ParticleData::PositionX, &ParticleData::PositionY, &ParticleData::PositionZ,
+		&ParticleData::VelocityX, &ParticleData::VelocityY, &ParticleData::VelocityZ,
+		&ParticleData::Age, &ParticleData::Size,
+		&ParticleData::ColorR, &ParticleData::ColorG, &ParticleData::ColorB, &ParticleData::ColorA,
+		&ParticleData::Rotation };
+
+	float* AllocateStreams(size_t floatCount)
+	{
+		size_t bytes = floatCount * sizeof(float);
+#if defined(_MSC_VER)
+		return static_cast<float*>(_aligned_malloc(bytes, 64));
+#else
+		return static_cast<float*>(std::aligned_alloc(64, bytes));
+#endif
+	}
+
+	void FreeStreams(float* memory)
+	{
+#if defined(_MSC_VER)
+		_aligned_free(memory);
+#else
+		std::free(memory);
+#endif
+	}
+}
+
+ParticleData::ParticleData(int maxParticleCount)
+{
+	Allocate(maxParticleCount);
+}
+
+ParticleData::~ParticleData()
+{
+	FreeStreams(memory);
+}
+
+void ParticleData::Reallocate(int maxParticleCount)
+{
+	FreeStreams(memory);
+	Allocate(maxParticleCount);
+}
+
+void ParticleData::Allocate(int maxParticleCount)
+{
+	//round up to whole cache lines, and keep at least one so the streams are never null
+	capacity = (maxParticleCount + PARTICLE_STREAM_ALIGNMENT - 1) / PARTICLE_STREAM_ALIGNMENT * PARTICLE_STREAM_ALIGNMENT;
+	if (capacity == 0)
+		capacity = PARTICLE_STREAM_ALIGNMENT;
+
+	memory = AllocateStreams((size_t)capacity * StreamCount);
+	//fill memory with 0s
+	memset(memory, 0, sizeof(float) * capacity * StreamCount);
+
+	for (int i = 0; i < StreamCount; i++)
+	{
+		this->*streamMembers[i] = memory + (size_t)capacity * i;
+	}
+}
+
+void ParticleData::MoveParticle(int from, int to)
+{
+	for (int i = 0; i < StreamCount; i++)
+	{
+		float* stream = this->*streamMembers[i];
+		stream[to] = stream[from];
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+//Structure of arrays particle storage
+//Every stream is its own 64 byte aligned array, so the update kernel only pulls
+//the cache lines it actually reads. Capacity is padded to a whole number of
+//cache lines, which lets SIMD loops run full width past the live count.
+
+//floats per 64 byte cache line
+#define PARTICLE_STREAM_ALIGNMENT 16
+
+//slots [first, first + count) of the streams
+struct ParticleSpan
+{
+	int first;
+	int count;
+};
+
+class ParticleData
+{
+public:
+	ParticleData(int maxParticleCount);
+	~ParticleData();
+
+	ParticleData(const ParticleData&) = delete;
+	ParticleData& operator=(const ParticleData&) = delete;
+
+	//padded size of every stream
+	int GetCapacity() const { return capacity; }
+
+	//copy every stream of particle from into slot to
+	void MoveParticle(int from, int to);
+	//free the streams and allocate zeroed ones for maxParticleCount particles
+	void Reallocate(int maxParticleCount);
+
+	float* PositionX;
+	float* PositionY;
+	float* PositionZ;
+	float* VelocityX;
+	float* VelocityY;
+	float* VelocityZ;
+	float* Age;
+	float* Size;
+	float* ColorR;
+	float* ColorG;
+	float* ColorB;
+	float* ColorA;
+	//radians around the view direction, both billboard paths spin the quad by it
+	float* Rotation;
+
+	static const int StreamCount = 13;
+
+private:
+	int capacity;
+	//one allocation holding every stream back to back
+	float* memory;
+
+	void Allocate(int maxParticleCount);
+};
@@ -0,0 +1,409 @@
+#include "ParticleDensityVolume.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	//particle ranges splatted in parallel, fixed so the merge order and so the result never depends on the thread count.
+	//every partition keeps its own copy of the bricks it touches, so this also bounds the scratch memory
+	const int splatPartitionCount = 8;
+	//small counts use fewer partitions, the merge would cost more than splatting them serially saves
+	const int minPartitionSize = 8192;
+	//marks an empty BrickTable entry, MakeKey never sets the top bit
+	const uint64_t emptyKey = ~0ull;
+	const int brickMask = ParticleDensityVolume::BrickSize - 1;
+	const int brickShift = 3;
+
+	int VoxelIndex(int x, int y, int z)
+	{
+		return ((z & brickMask) * ParticleDensityVolume::BrickSize + (y & brickMask)) * ParticleDensityVolume::BrickSize + (x & brickMask);
+	}
+
+	//lower voxel corner and weights of a trilinear lookup or splat around p
+	void Locate(float voxelSize, float px, float py, float pz, int cell[3], float frac[3])
+	{
+		float coords[3] = { px / voxelSize - 0.5f, py / voxelSize - 0.5f, pz / voxelSize - 0.5f };
+		for (int a = 0; a < 3; a++)
+		{
+			float i = std::floor(coords[a]);
+			cell[a] = (int)i;
+			frac[a] = coords[a] - i;
+		}
+	}
+}
+
+ParticleDensityVolume::ParticleDensityVolume(float voxelSize)
+	: voxelSize(voxelSize)
+{
+}
+
+ParticleDensityVolume::BrickTable::BrickTable()
+	: keys(64, emptyKey), values(64, -1), count(0), mask(63), shift(58)
+{
+}
+
+void ParticleDensityVolume::BrickTable::Clear()
+{
+	std::fill(keys.begin(), keys.end(), emptyKey);
+	count = 0;
+}
+
+int ParticleDensityVolume::BrickTable::Find(BrickKey key) const
+{
+	for (size_t i = Slot(key);; i = (i + 1) & mask)
+	{
+		if (keys[i] == key)
+			return values[i];
+		if (keys[i] == emptyKey)
+			return -1;
+	}
+}
+
+void ParticleDensityVolume::BrickTable::Insert(BrickKey key, int value)
+{
+	if ((size_t)(count + 1) * 2 > keys.size())
+		Grow();
+
+	size_t i = Slot(key);
+	while (keys[i] != emptyKey)
+	{
+		i = (i + 1) & mask;
+	}
+	keys[i] = key;
+	values[i] = value;
+	count++;
+}
+
+void ParticleDensityVolume::BrickTable::Grow()
+{
+	std::vector<BrickKey> oldKeys(keys.size() * 2, emptyKey);
+	std::vector<int> oldValues(values.size() * 2, -1);
+	oldKeys.swap(keys);
+	oldValues.swap(values);
+	mask = keys.size() - 1;
+	shift--;
+	count = 0;
+	for (size_t i = 0; i < oldKeys.size(); i++)
+	{
+		if (oldKeys[i] != emptyKey)
+			Insert(oldKeys[i], oldValues[i]);
+	}
+}
+
+void ParticleDensityVolume::SetJobSystem(std::shared_ptr<JobSystem> jobSystem)
+{
+	this->jobSystem = jobSystem;
+}
+
+ParticleDensityVolume::BrickKey ParticleDensityVolume::MakeKey(int bx, int by, int bz)
+{
+	const BrickKey mask = (1u << 21) - 1;
+	return (((BrickKey)bx & mask) << 42) | (((BrickKey)by & mask) << 21) | ((BrickKey)bz & mask);
+}
+
+void ParticleDensityVolume::Clear()
+{
+	bricks.Clear();
+	brickVoxels.clear();
+	slotKeys.clear();
+	freeSlots.clear();
+	slotFilled.clear();
+}
+
+int ParticleDensityVolume::AllocateSlot(BrickKey key)
+{
+	int slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+		slotKeys[slot] = key;
+	}
+	else
+	{
+		slot = (int)slotKeys.size();
+		slotKeys.push_back(key);
+		brickVoxels.resize(brickVoxels.size() + BrickVoxels);
+		slotFilled.push_back(0);
+	}
+	bricks.Insert(key, slot);
+	return slot;
+}
+
+void ParticleDensityVolume::SplatPartition(const ParticleData& particles, const ParticleSpan* spans, int spanCount, int begin, int end,
+	PartitionBricks& partition) const
+{
+	partition.lookup.Clear();
+	partition.keys.clear();
+	partition.voxels.clear();
+
+	//particles come in clumps, so the brick of the previous corner is usually the next one's too
+	BrickKey lastKey = 0;
+	float* lastBrick = nullptr;
+	auto brickOf = [&](int x, int y, int z) {
+		BrickKey key = MakeKey(x >> brickShift, y >> brickShift, z >> brickShift);
+		if (lastBrick && key == lastKey)
+			return lastBrick;
+
+		int brick = partition.lookup.Find(key);
+		if (brick < 0)
+		{
+			brick = (int)partition.keys.size();
+			partition.lookup.Insert(key, brick);
+			partition.keys.push_back(key);
+			partition.voxels.resize(partition.voxels.size() + BrickVoxels, 0.0f);
+		}
+		lastKey = key;
+		lastBrick = partition.voxels.data() + (size_t)brick * BrickVoxels;
+		return lastBrick;
+	};
+
+	auto splatParticle = [&](int i) {
+		float mass = particles.ColorA[i];
+		if (!(mass > 0.0f))
+			return;
+
+		int cell[3];
+		float frac[3];
+		Locate(voxelSize, particles.PositionX[i], particles.PositionY[i], particles.PositionZ[i], cell, frac);
+		float wx[2] = { 1.0f - frac[0], frac[0] };
+		float wy[2] = { 1.0f - frac[1], frac[1] };
+		float wz[2] = { 1.0f - frac[2], frac[2] };
+
+		//all 8 corners in one brick unless the cell sits on a brick's last voxel
+		bool inside = (cell[0] & brickMask) != brickMask && (cell[1] & brickMask) != brickMask && (cell[2] & brickMask) != brickMask;
+		if (inside)
+		{
+			float* brick = brickOf(cell[0], cell[1], cell[2]);
+			int base = VoxelIndex(cell[0], cell[1], cell[2]);
+			for (int dz = 0; dz < 2; dz++)
+			{
+				for (int dy = 0; dy < 2; dy++)
+				{
+					float* row = brick + base + (dz * BrickSize + dy) * BrickSize;
+					float w = mass * wz[dz] * wy[dy];
+					row[0] += w * wx[0];
+					row[1] += w * wx[1];
+				}
+			}
+			return;
+		}
+
+		for (int dz = 0; dz < 2; dz++)
+		{
+			for (int dy = 0; dy < 2; dy++)
+			{
+				float w = mass * wz[dz] * wy[dy];
+				for (int dx = 0; dx < 2; dx++)
+				{
+					int x = cell[0] + dx, y = cell[1] + dy, z = cell[2] + dz;
+					brickOf(x, y, z)[VoxelIndex(x, y, z)] += w * wx[dx];
+				}
+			}
+		}
+	};
+
+	//the partition's share of every span
+	int spanStart = 0;
+	for (int s = 0; s < spanCount; s++)
+	{
+		int first = std::max(begin, spanStart);
+		int last = std::min(end, spanStart + spans[s].count);
+		for (int i = first; i < last; i++)
+		{
+			splatParticle(spans[s].first + i - spanStart);
+		}
+		spanStart += spans[s].count;
+	}
+}
+
+void ParticleDensityVolume::Splat(const ParticleData& particles, int count)
+{
+	ParticleSpan span = { 0, count };
+	Splat(particles, &span, 1);
+}
+
+void ParticleDensityVolume::Splat(const ParticleData& particles, const ParticleSpan* spans, int spanCount)
+{
+	int count = 0;
+	for (int s = 0; s < spanCount; s++)
+	{
+		count += spans[s].count;
+	}
+
+	//whole cache lines per partition
+	int partitionSize = (count + splatPartitionCount - 1) / splatPartitionCount;
+	partitionSize = std::max(minPartitionSize, (partitionSize + PARTICLE_STREAM_ALIGNMENT - 1) / PARTICLE_STREAM_ALIGNMENT * PARTICLE_STREAM_ALIGNMENT);
+	int partitionCount = (count + partitionSize - 1) / partitionSize;
+	if ((int)partitions.size() < partitionCount)
+		partitions.resize(partitionCount);
+
+	//every partition into its own bricks, no sharing between threads
+	auto splatPartitions = [&](int begin, int end) {
+		for (int first = begin; first < end; first += partitionSize)
+		{
+			SplatPartition(particles, spans, spanCount, first, std::min(first + partitionSize, end), partitions[first / partitionSize]);
+		}
+	};
+	if (jobSystem)
+		jobSystem->ParallelFor(count, partitionSize, splatPartitions);
+	else
+		splatPartitions(0, count);
+
+	//find or allocate the shared brick of every partition brick, in partition order
+	contributions.clear();
+	for (int p = 0; p < partitionCount; p++)
+	{
+		const PartitionBricks& partition = partitions[p];
+		for (int b = 0; b < (int)partition.keys.size(); b++)
+		{
+			int slot = bricks.Find(partition.keys[b]);
+			if (slot < 0)
+				slot = AllocateSlot(partition.keys[b]);
+			contributions.push_back({ slot, p, b });
+		}
+	}
+	//group by brick, stable so each brick still adds its partitions in partition order
+	std::stable_sort(contributions.begin(), contributions.end(), [](const Contribution& a, const Contribution& b) { return a.slot < b.slot; });
+
+	std::fill(slotFilled.begin(), slotFilled.end(), 0);
+	groupStarts.clear();
+	for (int i = 0; i < (int)contributions.size(); i++)
+	{
+		if (i == 0 || contributions[i].slot != contributions[i - 1].slot)
+			groupStarts.push_back(i);
+	}
+	groupStarts.push_back((int)contributions.size());
+
+	//every shared brick is written by one group only, so groups run in parallel
+	auto merge = [&](int begin, int end) {
+		for (int g = begin; g < end; g++)
+		{
+			const Contribution& first = contributions[groupStarts[g]];
+			float* target = brickVoxels.data() + (size_t)first.slot * BrickVoxels;
+			memcpy(target, partitions[first.partition].voxels.data() + (size_t)first.brick * BrickVoxels, sizeof(float) * BrickVoxels);
+			for (int i = groupStarts[g] + 1; i < groupStarts[g + 1]; i++)
+			{
+				const float* source = partitions[contributions[i].partition].voxels.data() + (size_t)contributions[i].brick * BrickVoxels;
+				for (int v = 0; v < BrickVoxels; v++)
+				{
+					target[v] += source[v];
+				}
+			}
+
+			bool filled = false;
+			for (int v = 0; v < BrickVoxels && !filled; v++)
+			{
+				filled = target[v] != 0.0f;
+			}
+			slotFilled[first.slot] = filled ? 1 : 0;
+		}
+	};
+	int groupCount = (int)groupStarts.size() - 1;
+	if (jobSystem)
+		jobSystem->ParallelFor(groupCount, 64, merge);
+	else
+		merge(0, groupCount);
+
+	//bricks nothing landed on this time, or only zero weights, go back to the pool.
+	//the table is rebuilt from the survivors and the free list pushed high to low, so new bricks take the lowest slots
+	bricks.Clear();
+	freeSlots.clear();
+	for (int slot = (int)slotKeys.size() - 1; slot >= 0; slot--)
+	{
+		if (slotFilled[slot])
+			bricks.Insert(slotKeys[slot], slot);
+		else
+			freeSlots.push_back(slot);
+	}
+}
+
+int ParticleDensityVolume::FindSlot(int x, int y, int z) const
+{
+	return bricks.Find(MakeKey(x >> brickShift, y >> brickShift, z >> brickShift));
+}
+
+float ParticleDensityVolume::VoxelAt(int x, int y, int z) const
+{
+	int slot = FindSlot(x, y, z);
+	return slot >= 0 ? brickVoxels[(size_t)slot * BrickVoxels + VoxelIndex(x, y, z)] : 0.0f;
+}
+
+float ParticleDensityVolume::Sample(Float3 position) const
+{
+	float density;
+	Sample(&position.x, &position.y, &position.z, &density, 1);
+	return density;
+}
+
+void ParticleDensityVolume::Sample(const float* x, const float* y, const float* z, float* density, int count) const
+{
+	BrickKey lastKey = 0;
+	int lastSlot = -2;
+
+	for (int i = 0; i < count; i++)
+	{
+		int cell[3];
+		float frac[3];
+		Locate(voxelSize, x[i], y[i], z[i], cell, frac);
+
+		float corners[8];
+		bool inside = (cell[0] & brickMask) != brickMask && (cell[1] & brickMask) != brickMask && (cell[2] & brickMask) != brickMask;
+		if (inside)
+		{
+			//one brick lookup for all 8 corners, skipped when the previous point was in the same brick
+			BrickKey key = MakeKey(cell[0] >> brickShift, cell[1] >> brickShift, cell[2] >> brickShift);
+			if (lastSlot == -2 || key != lastKey)
+			{
+				lastSlot = bricks.Find(key);
+				lastKey = key;
+			}
+			if (lastSlot < 0)
+			{
+				density[i] = 0.0f;
+				continue;
+			}
+
+			const float* brick = brickVoxels.data() + (size_t)lastSlot * BrickVoxels + VoxelIndex(cell[0], cell[1], cell[2]);
+			for (int c = 0; c < 4; c++)
+			{
+				const float* row = brick + ((c >> 1) * BrickSize + (c & 1)) * BrickSize;
+				corners[c * 2] = row[0];
+				corners[c * 2 + 1] = row[1];
+			}
+		}
+		else
+		{
+			for (int c = 0; c < 8; c++)
+			{
+				corners[c] = VoxelAt(cell[0] + (c & 1), cell[1] + ((c >> 1) & 1), cell[2] + (c >> 2));
+			}
+		}
+
+		//corners are x fastest, then y, then z
+		float c00 = (corners[1] - corners[0]) * frac[0] + corners[0];
+		float c10 = (corners[3] - corners[2]) * frac[0] + corners[2];
+		float c01 = (corners[5] - corners[4]) * frac[0] + corners[4];
+		float c11 = (corners[7] - corners[6]) * frac[0] + corners[6];
+		float c0 = (c10 - c00) * frac[1] + c00;
+		float c1 = (c11 - c01) * frac[1] + c01;
+		density[i] = (c1 - c0) * frac[2] + c0;
+	}
+}
+
+size_t ParticleDensityVolume::GetMemoryBytes() const
+{
+	return brickVoxels.capacity() * sizeof(float) + slotKeys.capacity() * sizeof(BrickKey) +
+		freeSlots.capacity() * sizeof(int) + slotFilled.capacity() + bricks.GetMemoryBytes();
+}
+
+size_t ParticleDensityVolume::GetScratchBytes() const
+{
+	size_t bytes = contributions.capacity() * sizeof(Contribution) + groupStarts.capacity() * sizeof(int);
+	for (const PartitionBricks& partition : partitions)
+	{
+		bytes += partition.voxels.capacity() * sizeof(float) + partition.keys.capacity() * sizeof(BrickKey) + partition.lookup.GetMemoryBytes();
+	}
+	return bytes;
+}
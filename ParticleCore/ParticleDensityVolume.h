@@ -0,0 +1,116 @@
+#pragma once
+
+#include"ParticleData.h"
+#include"ParticleMath.h"
+#include"JobSystem.h"
+#include<cstdint>
+#include<memory>
+#include<vector>
+
+//Sparse particle density on a voxel grid of voxelSize cubes, stored as a hash of 8^3 voxel bricks.
+//Only bricks some particle touched exist, so a plume over a large scene costs memory for the plume alone.
+//Splat rebuilds it from the particles: the particles are cut into a fixed number of partitions that splat into their
+//own bricks in parallel, then those are summed into the shared bricks in partition order, so any thread count gives the same bits.
+class ParticleDensityVolume
+{
+public:
+	static const int BrickSize = 8;
+	static const int BrickVoxels = BrickSize * BrickSize * BrickSize;
+
+	explicit ParticleDensityVolume(float voxelSize);
+
+	ParticleDensityVolume(const ParticleDensityVolume&) = delete;
+	ParticleDensityVolume& operator=(const ParticleDensityVolume&) = delete;
+
+	//replace the density with the first count particles, each adding its alpha to the 8 voxels around it (cloud in cell).
+	//bricks nothing landed on are freed back to the brick pool
+	void Splat(const ParticleData& particles, int count);
+	//Splat over the particles in spanCount slot spans, counted in span order for the partitions
+	void Splat(const ParticleData& particles, const ParticleSpan* spans, int spanCount);
+	//free every brick
+	void Clear();
+
+	//split splatting over the job system's workers, null runs on the calling thread
+	void SetJobSystem(std::shared_ptr<JobSystem> jobSystem);
+
+	//trilinear density at a world position, 0 where no brick exists
+	float Sample(Float3 position) const;
+	//Sample for count points, reusing the brick found for the previous point when it holds the next one too
+	void Sample(const float* x, const float* y, const float* z, float* density, int count) const;
+
+	float GetVoxelSize() const { return voxelSize; }
+	int GetBrickCount() const { return bricks.GetCount(); }
+	//bricks, the free pool and the hash table
+	size_t GetMemoryBytes() const;
+	//per partition bricks kept between splats, up to one copy of the touched bricks per partition
+	size_t GetScratchBytes() const;
+
+private:
+	//a brick coordinate packed as 3 x 21 bit signed fields
+	typedef uint64_t BrickKey;
+
+	//open addressing key to index table, linear probing, at most half full
+	class BrickTable
+	{
+	public:
+		BrickTable();
+		void Clear();
+		//index stored for key, -1 if absent
+		int Find(BrickKey key) const;
+		void Insert(BrickKey key, int value);
+		int GetCount() const { return count; }
+		size_t GetMemoryBytes() const { return keys.capacity() * sizeof(BrickKey) + values.capacity() * sizeof(int); }
+
+	private:
+		std::vector<BrickKey> keys;
+		std::vector<int> values;
+		int count;
+		size_t mask;
+		//64 - log2(table size)
+		int shift;
+
+		//Fibonacci hashing, the top bits of the product depend on every coordinate
+		size_t Slot(BrickKey key) const { return (size_t)((key * 0x9e3779b97f4a7c15ull) >> shift); }
+		void Grow();
+	};
+
+	//bricks one partition of particles splatted into
+	struct PartitionBricks
+	{
+		BrickTable lookup;
+		std::vector<BrickKey> keys;
+		std::vector<float> voxels;
+	};
+
+	//a partition brick to add into a shared brick
+	struct Contribution
+	{
+		int slot;
+		int partition;
+		int brick;
+	};
+
+	float voxelSize;
+	//shared brick slot per key, the voxels of slot s are brickVoxels[s * BrickVoxels ...]
+	BrickTable bricks;
+	std::vector<float> brickVoxels;
+	std::vector<BrickKey> slotKeys;
+	std::vector<int> freeSlots;
+
+	std::vector<PartitionBricks> partitions;
+	std::vector<Contribution> contributions;
+	std::vector<int> groupStarts;
+	//per slot, whether the last Splat left any density in it
+	std::vector<char> slotFilled;
+
+	std::shared_ptr<JobSystem> jobSystem;
+
+	static BrickKey MakeKey(int bx, int by, int bz);
+	//particles [begin, end) counted through the spans
+	void SplatPartition(const ParticleData& particles, const ParticleSpan* spans, int spanCount, int begin, int end, PartitionBricks& partition) const;
+	int AllocateSlot(BrickKey key);
+	//voxel value, 0 outside every brick
+	float VoxelAt(int x, int y, int z) const;
+	//brick slot holding voxel (x, y, z), -1 if none
+	int FindSlot(int x, int y, int z) const;
+};
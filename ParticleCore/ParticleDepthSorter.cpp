@@ -0,0 +1,259 @@
+#include "ParticleDepthSorter.h"
+#include "ParticleKernels.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	//particles per job when building keys and writing the order
+	const int keyChunkSize = 16384;
+	//the radix passes split the items into at most this many partitions, of at least minPartitionSize
+	const int maxPartitions = 8;
+	const int minPartitionSize = 32768;
+	//3 passes of 11 bits move the items less than 4 of 8, the 2048 buckets per partition still fit in L1
+	const int radixBits = 11;
+	const int radixBuckets = 1 << radixBits;
+	const int radixPasses = (32 + radixBits - 1) / radixBits;
+	//the repair gives up when more than 1 / repairLimit of the entries are out of place, past that a full sort is cheaper
+	const int repairLimit = 16;
+	//most kept entries one entry may push out of the repair's run
+	const int repairWindow = 8;
+	//sorts that skip the repair after it gave up, so a scene too busy for it does not pay for a failed try every frame
+	const int repairBackoff = 8;
+
+	bool InSpans(unsigned int slot, const ParticleSpan* spans, int spanCount)
+	{
+		for (int s = 0; s < spanCount; s++)
+		{
+			if (slot - (unsigned int)spans[s].first < (unsigned int)spans[s].count)
+				return true;
+		}
+		return false;
+	}
+}
+
+ParticleDepthSorter::ParticleDepthSorter()
+	: maxCameraMove(0.1f), minCameraTurnCos(std::cos(0.02f)), hasPrevious(false), previousPosition{ 0.0f, 0.0f, 0.0f },
+	previousForward{ 0.0f, 0.0f, 1.0f }, count(0), spans{ { 0, 0 }, { 0, 0 } }, spanCount(0), incremental(false), repairCooldown(0)
+{
+}
+
+void ParticleDepthSorter::SetJobSystem(std::shared_ptr<JobSystem> jobSystem)
+{
+	this->jobSystem = jobSystem;
+}
+
+void ParticleDepthSorter::SetIncrementalLimits(float maxCameraMove, float maxCameraTurn)
+{
+	this->maxCameraMove = maxCameraMove;
+	minCameraTurnCos = std::cos(maxCameraTurn);
+}
+
+void ParticleDepthSorter::Reset()
+{
+	hasPrevious = false;
+	repairCooldown = 0;
+}
+
+void ParticleDepthSorter::ParallelFor(int count, int chunkSize, const std::function<void(int, int)>& body)
+{
+	if (jobSystem)
+		jobSystem->ParallelFor(count, chunkSize, body);
+	else
+		body(0, count);
+}
+
+void ParticleDepthSorter::Sort(const ParticleData& particles, int count, Float3 cameraPosition, Float3 cameraForward)
+{
+	ParticleSpan span = { 0, count };
+	Sort(particles, &span, count > 0 ? 1 : 0, cameraPosition, cameraForward);
+}
+
+void ParticleDepthSorter::Sort(const ParticleData& particles, const ParticleSpan* spans, int spanCount, Float3 cameraPosition, Float3 cameraForward)
+{
+	Float3 move = { cameraPosition.x - previousPosition.x, cameraPosition.y - previousPosition.y, cameraPosition.z - previousPosition.z };
+	float turnCos = cameraForward.x * previousForward.x + cameraForward.y * previousForward.y + cameraForward.z * previousForward.z;
+	bool tryRepair = hasPrevious && repairCooldown == 0 && move.x * move.x + move.y * move.y + move.z * move.z <= maxCameraMove * maxCameraMove &&
+		turnCos >= minCameraTurnCos;
+	repairCooldown = std::max(repairCooldown - 1, 0);
+
+	ParticleSpan previousSpans[2] = { this->spans[0], this->spans[1] };
+	int previousSpanCount = this->spanCount;
+	int previousCount = this->count;
+	int count = 0;
+	for (int s = 0; s < spanCount; s++)
+	{
+		this->spans[s] = spans[s];
+		count += spans[s].count;
+	}
+	this->spanCount = spanCount;
+	this->count = count;
+	if (order.size() < (size_t)count)
+	{
+		order.resize(count);
+		items.resize(count);
+		scratch.resize(count);
+	}
+
+	incremental = false;
+	if (tryRepair)
+	{
+		//dropping the slots that are no longer live and appending the ones that were not live before turns the previous
+		//order into an order of the current slots. A compact pool keeps [0, count) and moves its last particles into the
+		//dead slots, those come out as far outliers. A ring drops its oldest slots and appends the newest ones
+		int kept = 0;
+		for (int i = 0; i < previousCount; i++)
+		{
+			if (InSpans(order[i], spans, spanCount))
+				order[kept++] = order[i];
+		}
+		for (int s = 0; s < spanCount; s++)
+		{
+			for (int slot = spans[s].first; slot < spans[s].first + spans[s].count; slot++)
+			{
+				if (!InSpans((unsigned int)slot, previousSpans, previousSpanCount))
+					order[kept++] = (unsigned int)slot;
+			}
+		}
+		BuildKeys(particles, order.data(), cameraPosition, cameraForward);
+		incremental = Repair();
+		repairCooldown = incremental ? 0 : repairBackoff;
+	}
+	if (!incremental)
+	{
+		BuildKeys(particles, nullptr, cameraPosition, cameraForward);
+		RadixSort();
+	}
+
+	ParallelFor(count, keyChunkSize, [&](int begin, int end) {
+		for (int i = begin; i < end; i++)
+		{
+			order[i] = (unsigned int)items[i];
+		}
+	});
+
+	hasPrevious = true;
+	previousPosition = cameraPosition;
+	previousForward = cameraForward;
+}
+
+void ParticleDepthSorter::BuildKeys(const ParticleData& particles, const unsigned int* slots, Float3 cameraPosition, Float3 cameraForward)
+{
+	ParallelFor(count, keyChunkSize, [&](int begin, int end) {
+		if (slots)
+		{
+			BuildDepthKeys(particles, slots + begin, 0, end - begin, cameraPosition, cameraForward, items.data() + begin);
+			return;
+		}
+		//the spans in slot order (a wrapped ring lists its upper span first), so the stable radix sort over the depth
+		//bits leaves equal depths in slot order, the same tie order the repair's full 64 bit compare gives
+		const bool swapped = spanCount == 2 && spans[1].first < spans[0].first;
+		const ParticleSpan& low = swapped ? spans[1] : spans[0];
+		const ParticleSpan& high = swapped ? spans[0] : spans[1];
+		//the chunk's part of each span
+		int split = std::min(std::max(begin, low.count), end);
+		if (split > begin)
+			BuildDepthKeys(particles, nullptr, low.first + begin, split - begin, cameraPosition, cameraForward, items.data() + begin);
+		if (end > split)
+			BuildDepthKeys(particles, nullptr, high.first + split - low.count, end - split, cameraPosition, cameraForward,
+				items.data() + split);
+	});
+}
+
+void ParticleDepthSorter::RadixSort()
+{
+	const int partitionCount = std::max(1, std::min(maxPartitions, count / minPartitionSize));
+	histograms.resize((size_t)partitionCount * radixBuckets);
+	auto partitionBegin = [this, partitionCount](int p) { return (int)((int64_t)count * p / partitionCount); };
+
+	for (int pass = 0; pass < radixPasses; pass++)
+	{
+		//the partitions hold other items after every scatter, so each pass counts its own digit again
+		const int shift = 32 + pass * radixBits;
+		ParallelFor(partitionCount, 1, [&](int pBegin, int pEnd) {
+			for (int p = pBegin; p < pEnd; p++)
+			{
+				unsigned int* histogram = histograms.data() + (size_t)p * radixBuckets;
+				std::fill(histogram, histogram + radixBuckets, 0u);
+				for (int i = partitionBegin(p); i < partitionBegin(p + 1); i++)
+				{
+					histogram[(items[i] >> shift) & (radixBuckets - 1)]++;
+				}
+			}
+		});
+
+		//histograms turned into bucket starts, bucket major then partition, which keeps the scatter stable
+		unsigned int running = 0;
+		bool oneBucket = false;
+		for (int bucket = 0; bucket < radixBuckets; bucket++)
+		{
+			unsigned int bucketStart = running;
+			for (int p = 0; p < partitionCount; p++)
+			{
+				unsigned int& slot = histograms[(size_t)p * radixBuckets + bucket];
+				unsigned int bucketCount = slot;
+				slot = running;
+				running += bucketCount;
+			}
+			oneBucket = oneBucket || running - bucketStart == (unsigned int)count;
+		}
+		//every key has the same digit here (typically the sign and exponent of nearby depths), the pass would only copy
+		if (oneBucket)
+			continue;
+
+		ParallelFor(partitionCount, 1, [&](int pBegin, int pEnd) {
+			for (int p = pBegin; p < pEnd; p++)
+			{
+				unsigned int* offset = histograms.data() + (size_t)p * radixBuckets;
+				for (int i = partitionBegin(p); i < partitionBegin(p + 1); i++)
+				{
+					uint64_t item = items[i];
+					scratch[offset[(item >> shift) & (radixBuckets - 1)]++] = item;
+				}
+			}
+		});
+		items.swap(scratch);
+	}
+}
+
+bool ParticleDepthSorter::Repair()
+{
+	//keep an ascending run in place. An entry smaller than the run's last one is a misfit, unless only a few of the
+	//last ones are in its way (far outliers, like particles the pool swapped into dead slots), then those are the misfits.
+	//Spawned particles, appended nearest first, become misfits too. Misfits are sorted on their own and merged in
+	misfits.clear();
+	const size_t limit = (size_t)count / repairLimit + 2;
+	int kept = 0;
+	for (int i = 0; i < count; i++)
+	{
+		uint64_t item = items[i];
+		if (kept > 0 && item < items[kept - 1])
+		{
+			int inTheWay = 1;
+			while (inTheWay < kept && inTheWay < repairWindow && item < items[kept - 1 - inTheWay])
+			{
+				inTheWay++;
+			}
+			if (inTheWay < repairWindow)
+			{
+				misfits.insert(misfits.end(), items.begin() + (kept - inTheWay), items.begin() + kept);
+				kept -= inTheWay;
+			}
+			else
+			{
+				misfits.push_back(item);
+				if (misfits.size() > limit)
+					return false;
+				continue;
+			}
+		}
+		items[kept++] = item;
+	}
+	if (misfits.size() > limit)
+		return false;
+
+	std::sort(misfits.begin(), misfits.end());
+	std::merge(items.begin(), items.begin() + kept, misfits.begin(), misfits.end(), scratch.begin());
+	items.swap(scratch);
+	return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include"ParticleData.h"
+#include"ParticleMath.h"
+#include"JobSystem.h"
+#include<cstdint>
+#include<memory>
+#include<vector>
+
+//Back to front order of the live particles along the view direction, for alpha blended drawing.
+//A full sort is a least significant digit radix sort of 32 bit depth keys, 11 bits per pass, over a fixed number of
+//partitions that histogram and scatter in parallel, so any thread count gives the same order.
+//While the camera barely moves and the particles keep their relative depths (slow or sparse effects) the previous
+//frame's order is nearly right: it is repaired by pulling out the entries out of place, sorting only those and merging
+//them back. A full sort runs instead when too many are out of place, and the repair rests for a few frames after that.
+class ParticleDepthSorter
+{
+public:
+	ParticleDepthSorter();
+
+	ParticleDepthSorter(const ParticleDepthSorter&) = delete;
+	ParticleDepthSorter& operator=(const ParticleDepthSorter&) = delete;
+
+	//order the first count particles farthest first along cameraForward (unit length), ties by slot
+	void Sort(const ParticleData& particles, int count, Float3 cameraPosition, Float3 cameraForward);
+	//Sort over the particles in spanCount (at most 2) slot spans, e.g. a ring pool's live range
+	void Sort(const ParticleData& particles, const ParticleSpan* spans, int spanCount, Float3 cameraPosition, Float3 cameraForward);
+	//next Sort is a full one
+	void Reset();
+
+	//split key building and the radix passes over the job system's workers, null runs on the calling thread
+	void SetJobSystem(std::shared_ptr<JobSystem> jobSystem);
+	//camera movement since the last sort up to which the previous order is repaired, in world units and radians,
+	//0.1 and 0.02 by default
+	void SetIncrementalLimits(float maxCameraMove, float maxCameraTurn);
+
+	//slot of the particle to draw i-th, GetCount() entries
+	const unsigned int* GetOrder() const { return order.data(); }
+	int GetCount() const { return count; }
+	//whether the last Sort repaired the previous order instead of sorting from scratch
+	bool WasIncremental() const { return incremental; }
+
+private:
+	std::shared_ptr<JobSystem> jobSystem;
+	float maxCameraMove;
+	float minCameraTurnCos;
+
+	bool hasPrevious;
+	Float3 previousPosition;
+	Float3 previousForward;
+	int count;
+	//live slots of the current and previous sort
+	ParticleSpan spans[2];
+	int spanCount;
+	bool incremental;
+	//sorts left before the repair is tried again
+	int repairCooldown;
+
+	std::vector<unsigned int> order;
+	//depth key in the high 32 bits, slot in the low 32, so a plain integer compare orders by key then slot
+	std::vector<uint64_t> items;
+	std::vector<uint64_t> scratch;
+	//out of place entries pulled out by the repair
+	std::vector<uint64_t> misfits;
+	//256 buckets per partition, counts then scatter offsets of the current pass
+	std::vector<unsigned int> histograms;
+
+	//items[i] = key of particle slots[i], or of the i-th live particle in slot order when slots is null
+	void BuildKeys(const ParticleData& particles, const unsigned int* slots, Float3 cameraPosition, Float3 cameraForward);
+	void RadixSort();
+	//false when too much is out of place, items are then left unsorted
+	bool Repair();
+	void ParallelFor(int count, int chunkSize, const std::function<void(int, int)>& body);
+};
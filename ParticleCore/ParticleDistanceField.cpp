@@ -0,0 +1,272 @@
+#include "ParticleDistanceField.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+	//cache file header
+	const char cacheMagic[4] = { 'P', 'S', 'D', '1' };
+	//the flat sample index goes through a float in the SIMD sampler, exact below 2^24
+	const size_t maxSamples = (size_t)1 << 24;
+}
+
+ParticleDistanceField::ParticleDistanceField()
+	: key(0), origin{ 0.0f, 0.0f, 0.0f }, voxelSize(1.0f), band(0.0f), sizeX(0), sizeY(0), sizeZ(0)
+{
+}
+
+uint64_t ParticleDistanceField::MakeKey(const ParticleBvh& bvh, int resolution, int bandCells)
+{
+	uint64_t hash = bvh.GetContentHash();
+	hash = (hash ^ (uint64_t)(unsigned int)resolution) * 0x100000001b3ull;
+	hash = (hash ^ (uint64_t)(unsigned int)bandCells) * 0x100000001b3ull;
+	return hash;
+}
+
+void ParticleDistanceField::SetJobSystem(std::shared_ptr<JobSystem> jobSystem)
+{
+	this->jobSystem = jobSystem;
+}
+
+void ParticleDistanceField::Bake(const ParticleBvh& bvh, int resolution, int bandCells)
+{
+	resolution = std::max(resolution, 2);
+	bandCells = std::max(bandCells, 1);
+	key = MakeKey(bvh, resolution, bandCells);
+
+	Float3 boundsMin, boundsMax;
+	bvh.GetBounds(boundsMin, boundsMax);
+	float extent[3] = { boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z };
+	float longest = std::max(std::max(extent[0], extent[1]), std::max(extent[2], 1e-6f));
+	//resolution samples span the longest axis including a band on both ends
+	voxelSize = longest / (resolution - 1 - 2 * bandCells > 0 ? resolution - 1 - 2 * bandCells : 1);
+	band = voxelSize * bandCells;
+	origin = { boundsMin.x - band, boundsMin.y - band, boundsMin.z - band };
+	int sizes[3];
+	for (int a = 0; a < 3; a++)
+	{
+		sizes[a] = std::max(2, (int)std::ceil((extent[a] + 2.0f * band) / voxelSize) + 1);
+	}
+	sizeX = sizes[0];
+	sizeY = sizes[1];
+	sizeZ = sizes[2];
+	//very flat scenes can still overflow the index, shed z slabs first since they are the slowest axis
+	while ((size_t)sizeX * sizeY * sizeZ > maxSamples)
+	{
+		sizeZ--;
+	}
+	distances.assign((size_t)sizeX * sizeY * sizeZ, band);
+
+	//a little over the band so samples on its edge still find their triangle
+	const float searchDistance = band * 1.01f;
+	auto bakeSlabs = [&](int zBegin, int zEnd) {
+		for (int k = zBegin; k < zEnd; k++)
+		{
+			for (int j = 0; j < sizeY; j++)
+			{
+				float* row = distances.data() + ((size_t)k * sizeY + j) * sizeX;
+				for (int i = 0; i < sizeX; i++)
+				{
+					Float3 p = { origin.x + i * voxelSize, origin.y + j * voxelSize, origin.z + k * voxelSize };
+					Float3 closest, normal;
+					if (!bvh.FindClosest(p, searchDistance, closest, normal))
+						continue;
+
+					Float3 offset = { p.x - closest.x, p.y - closest.y, p.z - closest.z };
+					float distance = std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+					//behind the closest triangle is inside. At shared edges and vertices any of the triangles
+					//gives the right side for convex corners, which is all the smoke can reach
+					bool inside = offset.x * normal.x + offset.y * normal.y + offset.z * normal.z < 0.0f;
+					distance = std::min(distance, band);
+					row[i] = inside ? -distance : distance;
+				}
+			}
+		}
+	};
+	if (jobSystem)
+		jobSystem->ParallelFor(sizeZ, 1, bakeSlabs);
+	else
+		bakeSlabs(0, sizeZ);
+}
+
+bool ParticleDistanceField::Load(const char* path, const ParticleBvh& bvh, int resolution, int bandCells)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return false;
+
+	char magic[4] = {};
+	uint64_t fileKey = 0;
+	int sizes[3] = {};
+	float header[5] = {};
+	bool ok = fread(magic, 1, 4, file) == 4 && fread(&fileKey, sizeof(uint64_t), 1, file) == 1 &&
+		fread(sizes, sizeof(int), 3, file) == 3 && fread(header, sizeof(float), 5, file) == 5;
+	ok = ok && magic[0] == cacheMagic[0] && magic[1] == cacheMagic[1] && magic[2] == cacheMagic[2] && magic[3] == cacheMagic[3];
+	ok = ok && fileKey == MakeKey(bvh, std::max(resolution, 2), std::max(bandCells, 1));
+	ok = ok && sizes[0] >= 2 && sizes[1] >= 2 && sizes[2] >= 2 && (size_t)sizes[0] * sizes[1] * sizes[2] <= maxSamples;
+
+	std::vector<float> samples;
+	if (ok)
+	{
+		size_t count = (size_t)sizes[0] * sizes[1] * sizes[2];
+		samples.resize(count);
+		ok = fread(samples.data(), sizeof(float), count, file) == count;
+	}
+	fclose(file);
+	if (!ok)
+		return false;
+
+	key = fileKey;
+	sizeX = sizes[0];
+	sizeY = sizes[1];
+	sizeZ = sizes[2];
+	origin = { header[0], header[1], header[2] };
+	voxelSize = header[3];
+	band = header[4];
+	distances.swap(samples);
+	return true;
+}
+
+bool ParticleDistanceField::Save(const char* path) const
+{
+	if (distances.empty())
+		return false;
+
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return false;
+
+	int sizes[3] = { sizeX, sizeY, sizeZ };
+	float header[5] = { origin.x, origin.y, origin.z, voxelSize, band };
+	bool ok = fwrite(cacheMagic, 1, 4, file) == 4 && fwrite(&key, sizeof(uint64_t), 1, file) == 1 &&
+		fwrite(sizes, sizeof(int), 3, file) == 3 && fwrite(header, sizeof(float), 5, file) == 5 &&
+		fwrite(distances.data(), sizeof(float), distances.size(), file) == distances.size();
+	fclose(file);
+	return ok;
+}
+
+bool ParticleDistanceField::LoadOrBake(const char* path, const ParticleBvh& bvh, int resolution, int bandCells)
+{
+	if (Load(path, bvh, resolution, bandCells))
+		return true;
+
+	Bake(bvh, resolution, bandCells);
+	//a failed write only means the next start bakes again
+	Save(path);
+	return false;
+}
+
+float ParticleDistanceField::Sample(Float3 position, Float3& gradient) const
+{
+	gradient = { 0.0f, 0.0f, 0.0f };
+	if (distances.empty())
+		return band;
+
+	const float invVoxel = 1.0f / voxelSize;
+	float coords[3] = { (position.x - origin.x) * invVoxel, (position.y - origin.y) * invVoxel, (position.z - origin.z) * invVoxel };
+	int sizes[3] = { sizeX, sizeY, sizeZ };
+	int cell[3];
+	float frac[3];
+	//how far outside the grid, in samples, same expression as the SIMD path
+	float outside = 0.0f;
+	for (int a = 0; a < 3; a++)
+	{
+		float maxCoord = (float)(sizes[a] - 1);
+		outside = std::max(outside, std::max(0.0f - coords[a], coords[a] - maxCoord));
+		float c = std::min(std::max(coords[a], 0.0f), maxCoord);
+		float i = std::min(std::floor(c), maxCoord - 1.0f);
+		cell[a] = (int)i;
+		frac[a] = c - i;
+	}
+	if (0.0f < outside)
+		return band;
+
+	const float* v = distances.data();
+	size_t strideY = sizeX;
+	size_t strideZ = (size_t)sizeX * sizeY;
+	size_t base = ((size_t)cell[2] * sizeY + cell[1]) * sizeX + cell[0];
+
+	//x differences along the 4 yz corners, then y, then z, the same order as the SIMD path
+	float dx00 = v[base + 1] - v[base];
+	float dx10 = v[base + strideY + 1] - v[base + strideY];
+	float dx01 = v[base + strideZ + 1] - v[base + strideZ];
+	float dx11 = v[base + strideZ + strideY + 1] - v[base + strideZ + strideY];
+	float c00 = dx00 * frac[0] + v[base];
+	float c10 = dx10 * frac[0] + v[base + strideY];
+	float c01 = dx01 * frac[0] + v[base + strideZ];
+	float c11 = dx11 * frac[0] + v[base + strideZ + strideY];
+
+	float dy0 = c10 - c00;
+	float dy1 = c11 - c01;
+	float c0 = dy0 * frac[1] + c00;
+	float c1 = dy1 * frac[1] + c01;
+	float dx0 = (dx10 - dx00) * frac[1] + dx00;
+	float dx1 = (dx11 - dx01) * frac[1] + dx01;
+
+	gradient.x = ((dx1 - dx0) * frac[2] + dx0) * invVoxel;
+	gradient.y = ((dy1 - dy0) * frac[2] + dy0) * invVoxel;
+	gradient.z = (c1 - c0) * invVoxel;
+	return (c1 - c0) * frac[2] + c0;
+}
+
+SimdFloat ParticleDistanceField::Sample(SimdFloat px, SimdFloat py, SimdFloat pz, SimdFloat& gx, SimdFloat& gy, SimdFloat& gz) const
+{
+	const SimdFloat zero = SimdSet1(0.0f);
+	const SimdFloat farDistance = SimdSet1(band);
+	if (distances.empty())
+	{
+		gx = gy = gz = zero;
+		return farDistance;
+	}
+
+	const SimdFloat invVoxel = SimdSet1(1.0f / voxelSize);
+	SimdFloat coords[3] = { SimdMul(SimdSub(px, SimdSet1(origin.x)), invVoxel), SimdMul(SimdSub(py, SimdSet1(origin.y)), invVoxel),
+		SimdMul(SimdSub(pz, SimdSet1(origin.z)), invVoxel) };
+	int sizes[3] = { sizeX, sizeY, sizeZ };
+	SimdFloat cell[3];
+	SimdFloat frac[3];
+	SimdFloat outside = zero;
+	for (int a = 0; a < 3; a++)
+	{
+		SimdFloat maxCoord = SimdSet1((float)(sizes[a] - 1));
+		outside = SimdMax(outside, SimdMax(SimdSub(zero, coords[a]), SimdSub(coords[a], maxCoord)));
+		SimdFloat c = SimdMin(SimdMax(coords[a], zero), maxCoord);
+		SimdFloat i = SimdMin(SimdFloor(c), SimdSet1((float)(sizes[a] - 2)));
+		cell[a] = i;
+		frac[a] = SimdSub(c, i);
+	}
+
+	const float* v = distances.data();
+	SimdFloat strideY = SimdSet1((float)sizeX);
+	SimdFloat strideZ = SimdSet1((float)sizeX * (float)sizeY);
+	//flat index as a float, exact since the grid has at most 2^24 samples
+	SimdFloat base = SimdAdd(SimdMul(SimdAdd(SimdMul(cell[2], SimdSet1((float)sizeY)), cell[1]), strideY), cell[0]);
+
+	SimdFloat a, b;
+	SimdGatherPair(v, base, a, b);
+	SimdFloat dx00 = SimdSub(b, a);
+	SimdFloat c00 = SimdMulAdd(dx00, frac[0], a);
+	SimdGatherPair(v, SimdAdd(base, strideY), a, b);
+	SimdFloat dx10 = SimdSub(b, a);
+	SimdFloat c10 = SimdMulAdd(dx10, frac[0], a);
+	SimdGatherPair(v, SimdAdd(base, strideZ), a, b);
+	SimdFloat dx01 = SimdSub(b, a);
+	SimdFloat c01 = SimdMulAdd(dx01, frac[0], a);
+	SimdGatherPair(v, SimdAdd(SimdAdd(base, strideZ), strideY), a, b);
+	SimdFloat dx11 = SimdSub(b, a);
+	SimdFloat c11 = SimdMulAdd(dx11, frac[0], a);
+
+	SimdFloat dy0 = SimdSub(c10, c00);
+	SimdFloat dy1 = SimdSub(c11, c01);
+	SimdFloat c0 = SimdMulAdd(dy0, frac[1], c00);
+	SimdFloat c1 = SimdMulAdd(dy1, frac[1], c01);
+	SimdFloat dx0 = SimdMulAdd(SimdSub(dx10, dx00), frac[1], dx00);
+	SimdFloat dx1 = SimdMulAdd(SimdSub(dx11, dx01), frac[1], dx01);
+
+	SimdFloat isOutside = SimdLess(zero, outside);
+	gx = SimdSelect(isOutside, zero, SimdMul(SimdMulAdd(SimdSub(dx1, dx0), frac[2], dx0), invVoxel));
+	gy = SimdSelect(isOutside, zero, SimdMul(SimdMulAdd(SimdSub(dy1, dy0), frac[2], dy0), invVoxel));
+	gz = SimdSelect(isOutside, zero, SimdMul(SimdSub(c1, c0), invVoxel));
+	return SimdSelect(isOutside, farDistance, SimdMulAdd(SimdSub(c1, c0), frac[2], c0));
+}
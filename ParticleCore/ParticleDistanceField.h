@@ -0,0 +1,60 @@
+#pragma once
+
+#include"ParticleMath.h"
+#include"ParticleSimd.h"
+#include"ParticleBvh.h"
+#include"JobSystem.h"
+#include<cstdint>
+#include<memory>
+#include<vector>
+
+//Signed distance to static scene triangles, baked once onto a regular grid of samples so a collision test is one
+//trilinear lookup. Negative behind a triangle (by its winding), limited to a narrow band around the surface:
+//samples farther than the band hold +band, as collisions only need the distance close to geometry.
+//The bake is keyed by the source mesh content hash, resolution and band, and can be cached to disk.
+class ParticleDistanceField
+{
+public:
+	ParticleDistanceField();
+
+	//sample every grid point against the triangles of a built bvh, resolution samples along the longest axis
+	//of its bounds plus the band, bandCells voxels on each side of the surface. Slabs of the grid bake in parallel
+	//on the job system, every sample only depends on its position so any thread count gives the same bits
+	void Bake(const ParticleBvh& bvh, int resolution, int bandCells);
+	//binary cache, false when the file is missing or was baked from other meshes or settings
+	bool Load(const char* path, const ParticleBvh& bvh, int resolution, int bandCells);
+	bool Save(const char* path) const;
+	//load the cache, or bake and write it when it is missing or stale, true when it was loaded
+	bool LoadOrBake(const char* path, const ParticleBvh& bvh, int resolution, int bandCells);
+
+	//bake slabs on the job system's workers, null bakes on the calling thread
+	void SetJobSystem(std::shared_ptr<JobSystem> jobSystem);
+
+	//distance at a world position and its gradient (the derivative of the trilinear filter, not normalized),
+	//outside the grid the distance is the band and the gradient 0
+	float Sample(Float3 position, Float3& gradient) const;
+	//same as Sample per lane, bit for bit
+	SimdFloat Sample(SimdFloat px, SimdFloat py, SimdFloat pz, SimdFloat& gx, SimdFloat& gy, SimdFloat& gz) const;
+
+	int GetSizeX() const { return sizeX; }
+	int GetSizeY() const { return sizeY; }
+	int GetSizeZ() const { return sizeZ; }
+	float GetVoxelSize() const { return voxelSize; }
+	float GetBand() const { return band; }
+	size_t GetMemoryBytes() const { return distances.size() * sizeof(float); }
+
+private:
+	std::shared_ptr<JobSystem> jobSystem;
+	//hash of the source meshes and bake settings
+	uint64_t key;
+	Float3 origin;
+	float voxelSize;
+	float band;
+	int sizeX;
+	int sizeY;
+	int sizeZ;
+	//sizeX * sizeY * sizeZ samples, x fastest, sample (i, j, k) at origin + (i, j, k) * voxelSize
+	std::vector<float> distances;
+
+	static uint64_t MakeKey(const ParticleBvh& bvh, int resolution, int bandCells);
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include"ParticleAffectors.h"
+#include"ParticleDistanceField.h"
+#include<memory>
+
+//baked signed distance field collisions: particles closer to the surface than radius (or behind it, within the band)
+//are pushed out along the field gradient and bounce like SceneCollisionAffector. One trilinear lookup per particle
+//whatever the scene, but a particle moving more than radius plus the band in one step can pass through thin geometry
+struct DistanceFieldCollisionAffector : ParticleAffector
+{
+	std::shared_ptr<const ParticleDistanceField> field;
+	float radius;
+	float restitution;
+	float friction;
+
+	DistanceFieldCollisionAffector(std::shared_ptr<const ParticleDistanceField> field, float radius, float restitution, float friction)
+		: field(field), radius(radius), restitution(restitution), friction(friction) {}
+
+	void Constrain(ParticleLanes& lanes, SimdFloat dt) const
+	{
+		SimdFloat gx, gy, gz;
+		SimdFloat distance = field->Sample(lanes.positionX, lanes.positionY, lanes.positionZ, gx, gy, gz);
+		SimdFloat lengthSq = SimdMulAdd(gx, gx, SimdMulAdd(gy, gy, SimdMul(gz, gz)));
+		//a flat gradient means no surface nearby (outside the grid, or deep inside past the band)
+		SimdFloat hit = SimdLess(distance, SimdSet1(radius));
+		hit = SimdSelect(SimdLess(SimdSet1(1e-12f), lengthSq), hit, SimdSet1(0.0f));
+		if (SimdMoveMask(hit) == 0)
+			return;
+
+		SimdFloat invLength = SimdDiv(SimdSet1(1.0f), SimdSqrt(SimdMax(lengthSq, SimdSet1(1e-12f))));
+		SimdFloat nx = SimdMul(gx, invLength);
+		SimdFloat ny = SimdMul(gy, invLength);
+		SimdFloat nz = SimdMul(gz, invLength);
+
+		SimdFloat push = SimdSub(SimdSet1(radius), distance);
+		lanes.positionX = SimdSelect(hit, SimdMulAdd(nx, push, lanes.positionX), lanes.positionX);
+		lanes.positionY = SimdSelect(hit, SimdMulAdd(ny, push, lanes.positionY), lanes.positionY);
+		lanes.positionZ = SimdSelect(hit, SimdMulAdd(nz, push, lanes.positionZ), lanes.positionZ);
+
+		//only velocity into the surface bounces, tangential velocity loses friction
+		SimdFloat vn = SimdMulAdd(lanes.velocityX, nx, SimdMulAdd(lanes.velocityY, ny, SimdMul(lanes.velocityZ, nz)));
+		hit = SimdSelect(SimdLess(vn, SimdSet1(0.0f)), hit, SimdSet1(0.0f));
+		SimdFloat slide = SimdSet1(1.0f - friction);
+		SimdFloat bounce = SimdMul(vn, SimdSet1(-restitution));
+		SimdFloat vx = SimdMulAdd(nx, bounce, SimdMul(SimdSub(lanes.velocityX, SimdMul(vn, nx)), slide));
+		SimdFloat vy = SimdMulAdd(ny, bounce, SimdMul(SimdSub(lanes.velocityY, SimdMul(vn, ny)), slide));
+		SimdFloat vz = SimdMulAdd(nz, bounce, SimdMul(SimdSub(lanes.velocityZ, SimdMul(vn, nz)), slide));
+		lanes.velocityX = SimdSelect(hit, vx, lanes.velocityX);
+		lanes.velocityY = SimdSelect(hit, vy, lanes.velocityY);
+		lanes.velocityZ = SimdSelect(hit, vz, lanes.velocityZ);
+	}
+};
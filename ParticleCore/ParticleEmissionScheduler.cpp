@@ -0,0 +1,205 @@
+#include "ParticleEmissionScheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+ParticleEmissionScheduler::ParticleEmissionScheduler(float particlesPerSecond)
+	: rate(particlesPerSecond), rateCurveDuration(0.0f), loopDuration(1.0), loopAmount(0.0), time(0.0), accumulated(0.0)
+{
+	BuildSegments();
+}
+
+void ParticleEmissionScheduler::SetRate(float particlesPerSecond)
+{
+	rate = particlesPerSecond;
+	BuildSegments();
+}
+
+void ParticleEmissionScheduler::SetRateCurve(const std::vector<Float2>& points, float duration)
+{
+	rateCurve = points;
+	rateCurveDuration = duration;
+	BuildSegments();
+}
+
+void ParticleEmissionScheduler::AddBurst(const ParticleBurst& burst)
+{
+	bursts.push_back(burst);
+	burstsFired.push_back(0);
+}
+
+void ParticleEmissionScheduler::ClearBursts()
+{
+	bursts.clear();
+	burstsFired.clear();
+}
+
+void ParticleEmissionScheduler::Reset()
+{
+	time = 0.0;
+	accumulated = 0.0;
+	for (int64_t& fired : burstsFired)
+	{
+		fired = 0;
+	}
+}
+
+void ParticleEmissionScheduler::BuildSegments()
+{
+	//(time, particles per second) knots over one loop, held flat to 0 and to the loop end
+	std::vector<Float2> knots;
+	if (rateCurve.empty() || rateCurveDuration <= 0.0f)
+	{
+		loopDuration = 1.0;
+		knots = { Float2{ 0.0f, rate }, Float2{ 1.0f, rate } };
+	}
+	else
+	{
+		loopDuration = rateCurveDuration;
+		knots.push_back(Float2{ 0.0f, rate * rateCurve.front().y });
+		for (const Float2& point : rateCurve)
+		{
+			knots.push_back(Float2{ std::min(std::max(point.x, 0.0f), rateCurveDuration), rate * point.y });
+		}
+		knots.push_back(Float2{ rateCurveDuration, rate * rateCurve.back().y });
+	}
+
+	segments.clear();
+	loopAmount = 0.0;
+	for (size_t i = 1; i < knots.size(); i++)
+	{
+		double duration = (double)knots[i].x - knots[i - 1].x;
+		if (duration <= 0.0)
+			continue;
+
+		RateSegment segment;
+		segment.start = knots[i - 1].x;
+		segment.duration = duration;
+		segment.rate = std::max((double)knots[i - 1].y, 0.0);
+		segment.slope = (std::max((double)knots[i].y, 0.0) - segment.rate) / duration;
+		segment.amountBefore = loopAmount;
+		segments.push_back(segment);
+		loopAmount += (segment.rate + 0.5 * segment.slope * duration) * duration;
+	}
+}
+
+double ParticleEmissionScheduler::Integrate(double t) const
+{
+	double loops = std::floor(t / loopDuration);
+	double local = t - loops * loopDuration;
+
+	//last segment starting at or before local
+	auto segment = std::upper_bound(segments.begin(), segments.end(), local,
+		[](double value, const RateSegment& s) { return value < s.start; });
+	if (segment == segments.begin())
+		return loops * loopAmount;
+	--segment;
+	double u = std::min(local - segment->start, segment->duration);
+	return loops * loopAmount + segment->amountBefore + (segment->rate + 0.5 * segment->slope * u) * u;
+}
+
+double ParticleEmissionScheduler::Invert(double amount) const
+{
+	double loops = std::floor(amount / loopAmount);
+	double rest = amount - loops * loopAmount;
+	//a whole number of loops is reached at the end of the previous loop's last emitting segment
+	if (rest <= 0.0 && loops > 0.0)
+	{
+		loops -= 1.0;
+		rest = loopAmount;
+	}
+
+	//last segment with less than rest emitted before it, zero rate segments are passed over
+	auto segment = std::lower_bound(segments.begin(), segments.end(), rest,
+		[](const RateSegment& s, double value) { return s.amountBefore < value; });
+	if (segment != segments.begin())
+		--segment;
+
+	//solve rate * u + slope * u^2 / 2 = d for u, in the form that stays exact for a slope near 0
+	double d = rest - segment->amountBefore;
+	double root = std::sqrt(std::max(segment->rate * segment->rate + 2.0 * segment->slope * d, 0.0));
+	double u = segment->rate + root > 0.0 ? 2.0 * d / (segment->rate + root) : 0.0;
+	return loops * loopDuration + segment->start + std::min(std::max(u, 0.0), segment->duration);
+}
+
+int ParticleEmissionScheduler::Advance(float dt, float maxAge, std::vector<float>& ages)
+{
+	size_t start = ages.size();
+	if (dt <= 0.0f)
+		return 0;
+
+	//bursts that fall inside the frame, age is the time left in the frame after firing
+	double frameEnd = time + dt;
+	for (size_t b = 0; b < bursts.size(); b++)
+	{
+		const ParticleBurst& burst = bursts[b];
+
+		//no interval, every cycle fires at once
+		if (burst.interval <= 0.0f)
+		{
+			if (burstsFired[b] == 0 && burst.time < frameEnd)
+			{
+				int cycles = burst.cycles > 0 ? burst.cycles : 1;
+				burstsFired[b] = cycles;
+				if (burst.time >= time && frameEnd - burst.time < maxAge)
+					ages.insert(ages.end(), (size_t)burst.count * cycles, (float)(frameEnd - burst.time));
+			}
+			continue;
+		}
+
+		//cycles already dead at the end of the frame are only counted, so a long skip costs no loop per cycle.
+		//Counted in double and clamped, a skip of days over a short interval would not fit the counter
+		double deadBefore = frameEnd - maxAge;
+		if (deadBefore > burst.time)
+		{
+			double dead = std::ceil((deadBefore - burst.time) / burst.interval);
+			dead = std::min(dead, burst.cycles > 0 ? (double)burst.cycles : 4.0e18);
+			burstsFired[b] = std::max(burstsFired[b], (int64_t)dead);
+		}
+		while (burst.cycles == 0 || burstsFired[b] < burst.cycles)
+		{
+			double fireTime = burst.time + (double)burstsFired[b] * burst.interval;
+			if (fireTime >= frameEnd)
+				break;
+
+			burstsFired[b]++;
+			//missed before the first Advance, or already dead by the end of the frame
+			if (fireTime < time || frameEnd - fireTime >= maxAge)
+				continue;
+			ages.insert(ages.end(), burst.count, (float)(frameEnd - fireTime));
+		}
+	}
+	size_t burstEnd = ages.size();
+
+	//continuous rate: birth k happens where the integral since the frame start reaches k + 1 - accumulated
+	double amountBefore = Integrate(time);
+	double total = accumulated + (Integrate(frameEnd) - amountBefore);
+	if (loopAmount > 0.0 && total >= 1.0)
+	{
+		double count = std::floor(total);
+
+		//births already maxAge old at the end of the frame are only counted, never materialised
+		double first = 0.0;
+		double oldest = frameEnd - maxAge;
+		if (oldest > time)
+			first = std::max(0.0, std::ceil(Integrate(oldest) - amountBefore + accumulated - 1.0));
+		for (double k = first; k < count; k++)
+		{
+			double age = frameEnd - Invert(amountBefore + (k + 1.0 - accumulated));
+			if (age < maxAge)
+				ages.push_back(age < 0.0 ? 0.0f : (float)age);
+		}
+		accumulated = total - count;
+	}
+	else
+	{
+		accumulated = total;
+	}
+
+	//rate births are already oldest first, only a frame with bursts needs the merge
+	if (burstEnd > start)
+		std::sort(ages.begin() + start, ages.end(), std::greater<float>());
+
+	time = frameEnd;
+	return (int)(ages.size() - start);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include"ParticleMath.h"
+#include<cstdint>
+#include<vector>
+
+//burst of count particles at time, repeated every interval seconds for cycles bursts (0 repeats forever)
+struct ParticleBurst
+{
+	float time;
+	int count;
+	int cycles;
+	float interval;
+};
+
+//Decides how many particles an emitter spawns each frame and when inside the frame each one was born.
+//A continuous rate (particles per second, optionally shaped by a looping rate curve) accumulates fractional
+//particles across frames, and bursts fire at fixed times. Advance works out the whole frame in one step:
+//the curve is integrated exactly between its points and births are placed where its integral crosses each
+//whole particle, so a hitch or a skip of any length emits what the same time in small frames would.
+class ParticleEmissionScheduler
+{
+public:
+	ParticleEmissionScheduler(float particlesPerSecond = 0.0f);
+
+	void SetRate(float particlesPerSecond);
+	float GetRate() const { return rate; }
+	//rate multiplier over time, (time, multiplier) points sorted by time in [0, duration], linear in between and
+	//held before the first and after the last. The curve loops every duration seconds, an empty curve is a constant
+	//multiplier of 1, multipliers below 0 count as 0
+	void SetRateCurve(const std::vector<Float2>& points, float duration);
+	void AddBurst(const ParticleBurst& burst);
+	void ClearBursts();
+
+	//back to time 0 with nothing accumulated, bursts fire again
+	void Reset();
+	//seconds advanced since the last Reset, a double so burst times and the rate curve keep sub
+	//millisecond resolution over days of runtime
+	double GetTime() const { return time; }
+
+	//advance by dt and append the age at the end of the frame of every particle born during it, oldest first
+	//births that would already be maxAge old are skipped, so a long hitch costs at most one lifetime of particles,
+	//and a maxAge of 0 skips time without any births. Returns how many were appended
+	int Advance(float dt, float maxAge, std::vector<float>& ages);
+
+private:
+	//piece of one loop of the rate curve where particles per second change linearly
+	struct RateSegment
+	{
+		double start;
+		double duration;
+		//particles per second at start, and their change per second
+		double rate;
+		double slope;
+		//particles emitted in the loop before start
+		double amountBefore;
+	};
+
+	float rate;
+	std::vector<Float2> rateCurve;
+	float rateCurveDuration;
+	//rate times rate curve over one loop, rebuilt by SetRate and SetRateCurve
+	std::vector<RateSegment> segments;
+	double loopDuration;
+	double loopAmount;
+	std::vector<ParticleBurst> bursts;
+	//bursts already fired per entry of bursts
+	std::vector<int64_t> burstsFired;
+
+	double time;
+	//fraction of a particle carried over from earlier frames, in [0, 1)
+	double accumulated;
+
+	void BuildSegments();
+	//particles the rate emits from time 0 to t
+	double Integrate(double t) const;
+	//first time Integrate reaches amount, amount > 0 and loopAmount > 0
+	double Invert(double amount) const;
+};
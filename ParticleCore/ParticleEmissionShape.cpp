@@ -0,0 +1,245 @@
+#include "ParticleEmissionShape.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const float twoPi = 6.28318530718f;
+	//random values are drawn in blocks of this many samples, so shapes that need more than 3 per sample
+	//use stack scratch instead of allocating per burst
+	const int sampleBlock = 256;
+}
+
+ParticleEmissionShape::ParticleEmissionShape(EmissionShapeType type)
+	: type(type), radius(0.0f), halfAngle(0.0f), axis{ 0.0f, 1.0f, 0.0f }, halfExtents{ 0.0f, 0.0f, 0.0f }, surfaceArea(0.0f)
+{
+}
+
+ParticleEmissionShape ParticleEmissionShape::Point()
+{
+	return ParticleEmissionShape(EmissionShapeType::Point);
+}
+
+ParticleEmissionShape ParticleEmissionShape::Sphere(float radius)
+{
+	ParticleEmissionShape shape(EmissionShapeType::Sphere);
+	shape.radius = radius;
+	return shape;
+}
+
+ParticleEmissionShape ParticleEmissionShape::Cone(Float3 axis, float halfAngle, float length)
+{
+	ParticleEmissionShape shape(EmissionShapeType::Cone);
+	shape.axis = axis;
+	shape.halfAngle = halfAngle;
+	shape.radius = length;
+	return shape;
+}
+
+ParticleEmissionShape ParticleEmissionShape::Box(Float3 halfExtents)
+{
+	ParticleEmissionShape shape(EmissionShapeType::Box);
+	shape.halfExtents = halfExtents;
+	return shape;
+}
+
+ParticleEmissionShape ParticleEmissionShape::Disc(Float3 normal, float radius)
+{
+	ParticleEmissionShape shape(EmissionShapeType::Disc);
+	shape.axis = normal;
+	shape.radius = radius;
+	return shape;
+}
+
+ParticleEmissionShape ParticleEmissionShape::MeshSurface(const Float3* positions, const unsigned int* indices, int indexCount,
+	Float3 facing, float minFacing)
+{
+	ParticleEmissionShape shape(EmissionShapeType::MeshSurface);
+	bool filter = facing.x != 0.0f || facing.y != 0.0f || facing.z != 0.0f;
+
+	std::vector<double> areas;
+	double totalArea = 0.0;
+	for (int i = 0; i + 2 < indexCount; i += 3)
+	{
+		Float3 a = positions[indices[i]];
+		Float3 b = positions[indices[i + 1]];
+		Float3 c = positions[indices[i + 2]];
+		Float3 ab = { b.x - a.x, b.y - a.y, b.z - a.z };
+		Float3 ac = { c.x - a.x, c.y - a.y, c.z - a.z };
+		Float3 n = { ab.y * ac.z - ab.z * ac.y, ab.z * ac.x - ab.x * ac.z, ab.x * ac.y - ab.y * ac.x };
+		double length = std::sqrt((double)n.x * n.x + (double)n.y * n.y + (double)n.z * n.z);
+
+		//degenerate triangles can never be picked
+		if (length <= 0.0)
+			continue;
+		if (filter && (n.x * facing.x + n.y * facing.y + n.z * facing.z) / length < minFacing)
+			continue;
+
+		shape.triangleCorners.push_back(a);
+		shape.triangleEdgesA.push_back(ab);
+		shape.triangleEdgesB.push_back(ac);
+		areas.push_back(length * 0.5);
+		totalArea += length * 0.5;
+	}
+
+	int triangleCount = (int)areas.size();
+	shape.surfaceArea = (float)totalArea;
+	shape.aliasProbability.resize(triangleCount);
+	shape.aliasIndex.resize(triangleCount);
+
+	//Vose: scale weights to mean 1, pair every light column with a heavy one that tops it up
+	std::vector<double> scaled(triangleCount);
+	std::vector<int> small;
+	std::vector<int> large;
+	for (int i = 0; i < triangleCount; i++)
+	{
+		scaled[i] = areas[i] * triangleCount / totalArea;
+		if (scaled[i] < 1.0)
+			small.push_back(i);
+		else
+			large.push_back(i);
+	}
+	while (!small.empty() && !large.empty())
+	{
+		int light = small.back();
+		small.pop_back();
+		int heavy = large.back();
+
+		shape.aliasProbability[light] = (float)scaled[light];
+		shape.aliasIndex[light] = heavy;
+
+		scaled[heavy] -= 1.0 - scaled[light];
+		if (scaled[heavy] < 1.0)
+		{
+			large.pop_back();
+			small.push_back(heavy);
+		}
+	}
+	//what is left is 1 up to rounding
+	for (int i : large)
+	{
+		shape.aliasProbability[i] = 1.0f;
+		shape.aliasIndex[i] = i;
+	}
+	for (int i : small)
+	{
+		shape.aliasProbability[i] = 1.0f;
+		shape.aliasIndex[i] = i;
+	}
+
+	return shape;
+}
+
+void ParticleEmissionShape::Sample(ParticleRandom& random, float* x, float* y, float* z, int count) const
+{
+	switch (type)
+	{
+	case EmissionShapeType::Point:
+		std::fill(x, x + count, 0.0f);
+		std::fill(y, y + count, 0.0f);
+		std::fill(z, z + count, 0.0f);
+		break;
+	case EmissionShapeType::Sphere:
+		random.InSphere(x, y, z, count, radius);
+		break;
+	case EmissionShapeType::Cone:
+		SampleCone(random, x, y, z, count);
+		break;
+	case EmissionShapeType::Box:
+		random.Uniform(x, count, -halfExtents.x, halfExtents.x);
+		random.Uniform(y, count, -halfExtents.y, halfExtents.y);
+		random.Uniform(z, count, -halfExtents.z, halfExtents.z);
+		break;
+	case EmissionShapeType::Disc:
+		SampleDisc(random, x, y, z, count);
+		break;
+	case EmissionShapeType::MeshSurface:
+		SampleMesh(random, x, y, z, count);
+		break;
+	}
+}
+
+void ParticleEmissionShape::SampleCone(ParticleRandom& random, float* x, float* y, float* z, int count) const
+{
+	//direction inside the cone, then distance from the apex with a cube root for uniform volume
+	random.InCone(x, y, z, count, axis, halfAngle);
+
+	float distance[sampleBlock];
+	for (int start = 0; start < count; start += sampleBlock)
+	{
+		int n = std::min(sampleBlock, count - start);
+		random.Uniform(distance, n);
+		for (int i = 0; i < n; i++)
+		{
+			float d = radius * std::cbrt(distance[i]);
+			x[start + i] *= d;
+			y[start + i] *= d;
+			z[start + i] *= d;
+		}
+	}
+}
+
+void ParticleEmissionShape::SampleDisc(ParticleRandom& random, float* x, float* y, float* z, int count) const
+{
+	Float3 tangent, bitangent;
+	MakeOrthonormalBasis(axis, tangent, bitangent);
+
+	//square root radius for a uniform area density, z is only scratch until the last write
+	random.Uniform(x, count);
+	random.Uniform(y, count);
+	for (int i = 0; i < count; i++)
+	{
+		float r = radius * std::sqrt(x[i]);
+		float phi = twoPi * y[i];
+		float t = r * std::cos(phi);
+		float b = r * std::sin(phi);
+		x[i] = tangent.x * t + bitangent.x * b;
+		y[i] = tangent.y * t + bitangent.y * b;
+		z[i] = tangent.z * t + bitangent.z * b;
+	}
+}
+
+void ParticleEmissionShape::SampleMesh(ParticleRandom& random, float* x, float* y, float* z, int count) const
+{
+	int triangleCount = (int)aliasProbability.size();
+	if (triangleCount == 0)
+	{
+		std::fill(x, x + count, 0.0f);
+		std::fill(y, y + count, 0.0f);
+		std::fill(z, z + count, 0.0f);
+		return;
+	}
+
+	//4 values per sample: alias column, alias compare, 2 for the barycentric point
+	float column[sampleBlock];
+	float pick[sampleBlock];
+	float u[sampleBlock];
+	float v[sampleBlock];
+	for (int start = 0; start < count; start += sampleBlock)
+	{
+		int n = std::min(sampleBlock, count - start);
+		random.Uniform(column, n);
+		random.Uniform(pick, n);
+		random.Uniform(u, n);
+		random.Uniform(v, n);
+
+		for (int i = 0; i < n; i++)
+		{
+			//O(1) triangle pick regardless of triangle count
+			int t = std::min((int)(column[i] * triangleCount), triangleCount - 1);
+			if (pick[i] >= aliasProbability[t])
+				t = aliasIndex[t];
+
+			//uniform point in the triangle: a + s(1 - v) ab + s v ac with s = sqrt(u)
+			float s = std::sqrt(u[i]);
+			float wa = s * (1.0f - v[i]);
+			float wb = s * v[i];
+			const Float3& a = triangleCorners[t];
+			const Float3& ab = triangleEdgesA[t];
+			const Float3& ac = triangleEdgesB[t];
+			x[start + i] = a.x + ab.x * wa + ac.x * wb;
+			y[start + i] = a.y + ab.y * wa + ac.y * wb;
+			z[start + i] = a.z + ab.z * wa + ac.z * wb;
+		}
+	}
+}
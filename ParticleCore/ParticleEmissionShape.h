@@ -0,0 +1,70 @@
+#pragma once
+
+#include"ParticleMath.h"
+#include"ParticleRandom.h"
+#include<vector>
+
+enum class EmissionShapeType
+{
+	Point,
+	Sphere,
+	Cone,
+	Box,
+	Disc,
+	MeshSurface
+};
+
+//Where new particles start, as offsets from the emitter position.
+//Sample fills a whole burst in one call straight into SoA streams, so a frame's emission is a single batch.
+class ParticleEmissionShape
+{
+public:
+	//every particle at the emitter position
+	static ParticleEmissionShape Point();
+	//uniform inside a ball
+	static ParticleEmissionShape Sphere(float radius);
+	//uniform inside a spherical cone with its apex at the emitter, opening halfAngle radians around axis (unit length)
+	static ParticleEmissionShape Cone(Float3 axis, float halfAngle, float length);
+	//uniform inside an axis aligned box centered on the emitter
+	static ParticleEmissionShape Box(Float3 halfExtents);
+	//uniform over a flat disc facing normal (unit length), e.g. a chimney mouth
+	static ParticleEmissionShape Disc(Float3 normal, float radius);
+	//uniform over the area of a triangle list, positions already relative to the emitter
+	//only triangles with dot(unit normal, facing) >= minFacing are kept, a zero facing keeps every triangle
+	//normals follow the D3D clockwise winding the Mesh loader produces
+	static ParticleEmissionShape MeshSurface(const Float3* positions, const unsigned int* indices, int indexCount,
+		Float3 facing = Float3{ 0.0f, 0.0f, 0.0f }, float minFacing = 0.0f);
+
+	EmissionShapeType GetType() const { return type; }
+	//triangles kept by MeshSurface, 0 for the analytic shapes
+	int GetTriangleCount() const { return (int)aliasProbability.size(); }
+	//total area of the kept triangles
+	float GetSurfaceArea() const { return surfaceArea; }
+
+	//count offsets into x, y, z, consuming values from random
+	void Sample(ParticleRandom& random, float* x, float* y, float* z, int count) const;
+
+private:
+	ParticleEmissionShape(EmissionShapeType type);
+
+	EmissionShapeType type;
+	//sphere / disc radius, cone length
+	float radius;
+	float halfAngle;
+	//cone axis, disc normal
+	Float3 axis;
+	Float3 halfExtents;
+
+	//mesh surface: per triangle first corner and the two edges from it
+	std::vector<Float3> triangleCorners;
+	std::vector<Float3> triangleEdgesA;
+	std::vector<Float3> triangleEdgesB;
+	//area weighted alias table (Vose), a sample is one column pick plus one compare
+	std::vector<float> aliasProbability;
+	std::vector<int> aliasIndex;
+	float surfaceArea;
+
+	void SampleCone(ParticleRandom& random, float* x, float* y, float* z, int count) const;
+	void SampleDisc(ParticleRandom& random, float* x, float* y, float* z, int count) const;
+	void SampleMesh(ParticleRandom& random, float* x, float* y, float* z, int count) const;
+};
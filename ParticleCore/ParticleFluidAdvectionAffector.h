@@ -0,0 +1,25 @@
+#pragma once
+
+#include"ParticleAffectors.h"
+#include"ParticleFluidSolver.h"
+#include<memory>
+
+//particles inside a ParticleFluidSolver's grid are carried by its air, the solver must not Step while they run.
+//coupling is the fraction of the velocity difference closed per second, outside the grid velocity is untouched
+struct FluidAdvectionAffector : ParticleAffector
+{
+	std::shared_ptr<const ParticleFluidSolver> solver;
+	float coupling;
+
+	FluidAdvectionAffector(std::shared_ptr<const ParticleFluidSolver> solver, float coupling) : solver(solver), coupling(coupling) {}
+
+	void Apply(ParticleLanes& lanes, SimdFloat dt) const
+	{
+		SimdFloat fx, fy, fz;
+		SimdFloat inside = solver->Sample(lanes.positionX, lanes.positionY, lanes.positionZ, fx, fy, fz);
+		SimdFloat t = SimdSelect(inside, SimdMin(SimdSet1(1.0f), SimdMul(SimdSet1(coupling), dt)), SimdSet1(0.0f));
+		lanes.velocityX = SimdMulAdd(SimdSub(fx, lanes.velocityX), t, lanes.velocityX);
+		lanes.velocityY = SimdMulAdd(SimdSub(fy, lanes.velocityY), t, lanes.velocityY);
+		lanes.velocityZ = SimdMulAdd(SimdSub(fz, lanes.velocityZ), t, lanes.velocityZ);
+	}
+};
@@ -0,0 +1,503 @@
+#include "ParticleFluidSolver.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	//pressure iteration range the step budget may pick from
+	const int minPressureIterations = 4;
+	const int maxPressureIterations = 200;
+
+	double Milliseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+ParticleFluidSolver::ParticleFluidSolver(Float3 center, float size, int resolution)
+	: center(center), size(size), resolution(0), cellSize(0.0f), minCorner{ 0.0f, 0.0f, 0.0f },
+	pressureIterations(20), stepBudget(0.0f), lastStepMilliseconds(0.0f),
+	sourcePosition(center), sourceRadius(0.0f), sourceDensityRate(0.0f), sourceTemperatureRate(0.0f), sourceVelocity{ 0.0f, 0.0f, 0.0f },
+	densityWeight(0.05f), temperatureLift(1.0f), confinement(0.3f), densityDissipation(0.1f), temperatureDissipation(0.5f)
+{
+	SetResolution(resolution);
+}
+
+void ParticleFluidSolver::SetResolution(int resolution)
+{
+	resolution = std::max(4, resolution);
+	if (resolution == this->resolution)
+		return;
+
+	this->resolution = resolution;
+	cellSize = size / resolution;
+	minCorner = { center.x - size * 0.5f, center.y - size * 0.5f, center.z - size * 0.5f };
+	ResizeFields();
+}
+
+void ParticleFluidSolver::SetPressureIterations(int iterations)
+{
+	pressureIterations = std::max(1, iterations);
+}
+
+void ParticleFluidSolver::SetStepBudget(float milliseconds)
+{
+	stepBudget = milliseconds;
+}
+
+void ParticleFluidSolver::SetJobSystem(std::shared_ptr<JobSystem> jobSystem)
+{
+	this->jobSystem = jobSystem;
+}
+
+void ParticleFluidSolver::SetSource(Float3 position, float radius, float densityRate, float temperatureRate, Float3 velocity)
+{
+	sourcePosition = position;
+	sourceRadius = radius;
+	sourceDensityRate = densityRate;
+	sourceTemperatureRate = temperatureRate;
+	sourceVelocity = velocity;
+}
+
+void ParticleFluidSolver::SetBuoyancy(float densityWeight, float temperatureLift)
+{
+	this->densityWeight = densityWeight;
+	this->temperatureLift = temperatureLift;
+}
+
+void ParticleFluidSolver::SetVorticityConfinement(float strength)
+{
+	confinement = strength;
+}
+
+void ParticleFluidSolver::SetDissipation(float density, float temperature)
+{
+	densityDissipation = density;
+	temperatureDissipation = temperature;
+}
+
+void ParticleFluidSolver::ResizeFields()
+{
+	size_t cells = (size_t)resolution * resolution * resolution;
+	std::vector<float>* fields[] = { &velocityX, &velocityY, &velocityZ, &density, &temperature, &scratchX, &scratchY, &scratchZ,
+		&pressure, &pressureScratch, &divergence, &curlX, &curlY, &curlZ, &curlLength };
+	for (std::vector<float>* field : fields)
+	{
+		field->assign(cells, 0.0f);
+	}
+	zeroRow.assign(resolution, 0.0f);
+}
+
+void ParticleFluidSolver::Clear()
+{
+	ResizeFields();
+}
+
+void ParticleFluidSolver::ParallelSlabs(const std::function<void(int, int)>& body)
+{
+	//still air decays into denormals, which would make the passes several times slower, on every thread that runs a slab
+	auto flushedBody = [&body](int begin, int end) {
+		SimdFlushDenormals flush;
+		body(begin, end);
+	};
+	if (!jobSystem)
+	{
+		flushedBody(0, resolution);
+		return;
+	}
+	//a few slabs per thread so stealing can even out the load
+	int chunk = std::max(1, resolution / (4 * (jobSystem->GetWorkerCount() + 1)));
+	jobSystem->ParallelFor(resolution, chunk, flushedBody);
+}
+
+void ParticleFluidSolver::Step(float dt)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	AddForces(dt);
+	AdvectVelocity(dt);
+
+	auto projectStart = std::chrono::steady_clock::now();
+	Project();
+	double projectMilliseconds = Milliseconds(projectStart);
+
+	AdvectScalars(dt);
+
+	lastStepMilliseconds = (float)Milliseconds(start);
+
+	//the solve is the only part that scales with the iterations, aim what is left of the budget at it
+	if (stepBudget > 0.0f)
+	{
+		double perIteration = projectMilliseconds / pressureIterations;
+		double fixed = lastStepMilliseconds - projectMilliseconds;
+		int target = perIteration > 0.0 ? (int)((stepBudget - fixed) / perIteration) : maxPressureIterations;
+		target = std::min(maxPressureIterations, std::max(minPressureIterations, target));
+		//move halfway so one slow frame does not halve the quality
+		pressureIterations = std::max(minPressureIterations, (pressureIterations + target + 1) / 2);
+	}
+}
+
+void ParticleFluidSolver::AddForces(float dt)
+{
+	const int n = resolution;
+	const int slab = n * n;
+	const float invTwoH = 0.5f / cellSize;
+
+	//vorticity at the cell centres, needed by the neighbours of every cell so in its own pass.
+	//Neighbours past the walls are the cell itself, as in the projection
+	if (confinement > 0.0f)
+	{
+		ParallelSlabs([&](int zBegin, int zEnd) {
+			for (int z = zBegin; z < zEnd; z++)
+			{
+				int backOffset = z > 0 ? -slab : 0;
+				int frontOffset = z < n - 1 ? slab : 0;
+				for (int y = 0; y < n; y++)
+				{
+					int row = Index(0, y, z);
+					int downOffset = y > 0 ? -n : 0;
+					int upOffset = y < n - 1 ? n : 0;
+					const float* u = velocityX.data() + row;
+					const float* v = velocityY.data() + row;
+					const float* w = velocityZ.data() + row;
+					for (int x = 0; x < n; x++)
+					{
+						int left = x > 0 ? x - 1 : x;
+						int right = x < n - 1 ? x + 1 : x;
+						float dwdy = w[x + upOffset] - w[x + downOffset];
+						float dvdz = v[x + frontOffset] - v[x + backOffset];
+						float dudz = u[x + frontOffset] - u[x + backOffset];
+						float dwdx = w[right] - w[left];
+						float dvdx = v[right] - v[left];
+						float dudy = u[x + upOffset] - u[x + downOffset];
+
+						int i = row + x;
+						float cx = (dwdy - dvdz) * invTwoH;
+						float cy = (dudz - dwdx) * invTwoH;
+						float cz = (dvdx - dudy) * invTwoH;
+						curlX[i] = cx;
+						curlY[i] = cy;
+						curlZ[i] = cz;
+						curlLength[i] = std::sqrt(cx * cx + cy * cy + cz * cz);
+					}
+				}
+			}
+		});
+	}
+
+	const float sourceRadiusSq = sourceRadius * sourceRadius;
+	const float densityGain = sourceDensityRate * dt;
+	const float temperatureGain = sourceTemperatureRate * dt;
+	const float confinementScale = confinement * cellSize * dt;
+
+	ParallelSlabs([&](int zBegin, int zEnd) {
+		for (int z = zBegin; z < zEnd; z++)
+		{
+			int backOffset = z > 0 ? -slab : 0;
+			int frontOffset = z < n - 1 ? slab : 0;
+			float pz = minCorner.z + (z + 0.5f) * cellSize - sourcePosition.z;
+			for (int y = 0; y < n; y++)
+			{
+				int row = Index(0, y, z);
+				int downOffset = y > 0 ? -n : 0;
+				int upOffset = y < n - 1 ? n : 0;
+				float py = minCorner.y + (y + 0.5f) * cellSize - sourcePosition.y;
+				float* u = velocityX.data() + row;
+				float* v = velocityY.data() + row;
+				float* w = velocityZ.data() + row;
+				float* d = density.data() + row;
+				float* t = temperature.data() + row;
+
+				//only rows crossing the source sphere look for it
+				if (py * py + pz * pz < sourceRadiusSq)
+				{
+					for (int x = 0; x < n; x++)
+					{
+						float px = minCorner.x + (x + 0.5f) * cellSize - sourcePosition.x;
+						if (px * px + py * py + pz * pz < sourceRadiusSq)
+						{
+							d[x] += densityGain;
+							t[x] += temperatureGain;
+							u[x] = sourceVelocity.x;
+							v[x] = sourceVelocity.y;
+							w[x] = sourceVelocity.z;
+						}
+					}
+				}
+
+				//hot air rises, smoke is heavy, ambient air is at temperature 0
+				for (int x = 0; x < n; x++)
+				{
+					v[x] += (temperatureLift * t[x] - densityWeight * d[x]) * dt;
+				}
+
+				if (confinement > 0.0f)
+				{
+					const float* length = curlLength.data() + row;
+					const float* cx = curlX.data() + row;
+					const float* cy = curlY.data() + row;
+					const float* cz = curlZ.data() + row;
+					for (int x = 0; x < n; x++)
+					{
+						//towards increasing vorticity, so the force spins the swirls up around their cores
+						float gx = length[x < n - 1 ? x + 1 : x] - length[x > 0 ? x - 1 : x];
+						float gy = length[x + upOffset] - length[x + downOffset];
+						float gz = length[x + frontOffset] - length[x + backOffset];
+						float scale = confinementScale / (std::sqrt(gx * gx + gy * gy + gz * gz) + 1.0e-6f);
+
+						u[x] += (gy * cz[x] - gz * cy[x]) * scale;
+						v[x] += (gz * cx[x] - gx * cz[x]) * scale;
+						w[x] += (gx * cy[x] - gy * cx[x]) * scale;
+					}
+				}
+			}
+		}
+	});
+}
+
+ParticleFluidSolver::SamplePoint ParticleFluidSolver::Locate(float x, float y, float z) const
+{
+	const float last = (float)(resolution - 1);
+	float coords[3] = { std::min(std::max(x, 0.0f), last), std::min(std::max(y, 0.0f), last), std::min(std::max(z, 0.0f), last) };
+	int cell[3];
+	SamplePoint point;
+	float* frac[3] = { &point.fx, &point.fy, &point.fz };
+	for (int a = 0; a < 3; a++)
+	{
+		//coordinates are not negative here, so truncating is flooring
+		cell[a] = std::min((int)coords[a], resolution - 2);
+		*frac[a] = coords[a] - cell[a];
+	}
+	point.base = Index(cell[0], cell[1], cell[2]);
+	return point;
+}
+
+float ParticleFluidSolver::SampleField(const std::vector<float>& field, const SamplePoint& point) const
+{
+	//x pairs along the 4 yz corners, then y, then z, same order as SimdSampleTrilinear
+	const float* v = field.data() + point.base;
+	const int strideY = resolution;
+	const int strideZ = resolution * resolution;
+	float c00 = (v[1] - v[0]) * point.fx + v[0];
+	float c10 = (v[strideY + 1] - v[strideY]) * point.fx + v[strideY];
+	float c01 = (v[strideZ + 1] - v[strideZ]) * point.fx + v[strideZ];
+	float c11 = (v[strideZ + strideY + 1] - v[strideZ + strideY]) * point.fx + v[strideZ + strideY];
+	float c0 = (c10 - c00) * point.fy + c00;
+	float c1 = (c11 - c01) * point.fy + c01;
+	return (c1 - c0) * point.fz + c0;
+}
+
+void ParticleFluidSolver::AdvectVelocity(float dt)
+{
+	const int n = resolution;
+	const float dtCells = dt / cellSize;
+
+	//trace every cell centre back through the velocity field and pick up what was there
+	ParallelSlabs([&](int zBegin, int zEnd) {
+		for (int z = zBegin; z < zEnd; z++)
+		{
+			for (int y = 0; y < n; y++)
+			{
+				for (int x = 0; x < n; x++)
+				{
+					int i = Index(x, y, z);
+					SamplePoint back = Locate(x - velocityX[i] * dtCells, y - velocityY[i] * dtCells, z - velocityZ[i] * dtCells);
+					scratchX[i] = SampleField(velocityX, back);
+					scratchY[i] = SampleField(velocityY, back);
+					scratchZ[i] = SampleField(velocityZ, back);
+				}
+			}
+		}
+	});
+	velocityX.swap(scratchX);
+	velocityY.swap(scratchY);
+	velocityZ.swap(scratchZ);
+}
+
+void ParticleFluidSolver::Project()
+{
+	const int n = resolution;
+	const int slab = n * n;
+
+	//closed walls on the sides and floor, open top: normal velocity is 0 on the walls,
+	//pressure copies the cell inside (no flow) except above the top where it is 0 so smoke can leave.
+	//Neighbour rows outside the grid point at the cell's own row (copy) or at zeroRow (0), so the x loops have no branches
+	ParallelSlabs([&](int zBegin, int zEnd) {
+		for (int z = zBegin; z < zEnd; z++)
+		{
+			for (int y = 0; y < n; y++)
+			{
+				int row = Index(0, y, z);
+				velocityX[row] = 0.0f;
+				velocityX[row + n - 1] = 0.0f;
+				for (int x = 0; x < n; x++)
+				{
+					if (y == 0)
+						velocityY[row + x] = 0.0f;
+					if (z == 0 || z == n - 1)
+						velocityZ[row + x] = 0.0f;
+				}
+			}
+		}
+	});
+
+	ParallelSlabs([&](int zBegin, int zEnd) {
+		for (int z = zBegin; z < zEnd; z++)
+		{
+			for (int y = 0; y < n; y++)
+			{
+				int row = Index(0, y, z);
+				const float* u = velocityX.data() + row;
+				const float* vDown = velocityY.data() + (y > 0 ? row - n : row);
+				const float* vUp = velocityY.data() + (y < n - 1 ? row + n : row);
+				const float* wBack = velocityZ.data() + (z > 0 ? row - slab : row);
+				const float* wFront = velocityZ.data() + (z < n - 1 ? row + slab : row);
+				float* div = divergence.data() + row;
+				for (int x = 0; x < n; x++)
+				{
+					float du = u[x < n - 1 ? x + 1 : x] - u[x > 0 ? x - 1 : x];
+					div[x] = -0.5f * cellSize * (du + vUp[x] - vDown[x] + wFront[x] - wBack[x]);
+				}
+			}
+		}
+	});
+	std::fill(pressure.begin(), pressure.end(), 0.0f);
+
+	//Jacobi rather than Gauss-Seidel: every cell reads only the last iteration, so slabs run in any order with the same result
+	const float* zeros = zeroRow.data();
+	for (int iteration = 0; iteration < pressureIterations; iteration++)
+	{
+		ParallelSlabs([&](int zBegin, int zEnd) {
+			for (int z = zBegin; z < zEnd; z++)
+			{
+				for (int y = 0; y < n; y++)
+				{
+					int row = Index(0, y, z);
+					const float* p = pressure.data() + row;
+					const float* down = y > 0 ? p - n : p;
+					const float* up = y < n - 1 ? p + n : zeros;
+					const float* back = z > 0 ? p - slab : p;
+					const float* front = z < n - 1 ? p + slab : p;
+					const float* div = divergence.data() + row;
+					float* out = pressureScratch.data() + row;
+
+					out[0] = (div[0] + p[0] + p[1] + down[0] + up[0] + back[0] + front[0]) * (1.0f / 6.0f);
+					for (int x = 1; x < n - 1; x++)
+					{
+						out[x] = (div[x] + p[x - 1] + p[x + 1] + down[x] + up[x] + back[x] + front[x]) * (1.0f / 6.0f);
+					}
+					out[n - 1] = (div[n - 1] + p[n - 2] + p[n - 1] + down[n - 1] + up[n - 1] + back[n - 1] + front[n - 1]) * (1.0f / 6.0f);
+				}
+			}
+		});
+		pressure.swap(pressureScratch);
+	}
+
+	//subtract the pressure gradient, what is left is divergence free
+	const float invTwoH = 0.5f / cellSize;
+	ParallelSlabs([&](int zBegin, int zEnd) {
+		for (int z = zBegin; z < zEnd; z++)
+		{
+			for (int y = 0; y < n; y++)
+			{
+				int row = Index(0, y, z);
+				const float* p = pressure.data() + row;
+				const float* down = y > 0 ? p - n : p;
+				const float* up = y < n - 1 ? p + n : zeros;
+				const float* back = z > 0 ? p - slab : p;
+				const float* front = z < n - 1 ? p + slab : p;
+				float* u = velocityX.data() + row;
+				float* v = velocityY.data() + row;
+				float* w = velocityZ.data() + row;
+				for (int x = 0; x < n; x++)
+				{
+					u[x] -= (p[x < n - 1 ? x + 1 : x] - p[x > 0 ? x - 1 : x]) * invTwoH;
+					v[x] -= (up[x] - down[x]) * invTwoH;
+					w[x] -= (front[x] - back[x]) * invTwoH;
+				}
+			}
+		}
+	});
+}
+
+void ParticleFluidSolver::AdvectScalars(float dt)
+{
+	const int n = resolution;
+	const float dtCells = dt / cellSize;
+	const float keepDensity = 1.0f / (1.0f + densityDissipation * dt);
+	const float keepTemperature = 1.0f / (1.0f + temperatureDissipation * dt);
+
+	ParallelSlabs([&](int zBegin, int zEnd) {
+		for (int z = zBegin; z < zEnd; z++)
+		{
+			for (int y = 0; y < n; y++)
+			{
+				for (int x = 0; x < n; x++)
+				{
+					int i = Index(x, y, z);
+					SamplePoint back = Locate(x - velocityX[i] * dtCells, y - velocityY[i] * dtCells, z - velocityZ[i] * dtCells);
+					scratchX[i] = SampleField(density, back) * keepDensity;
+					scratchY[i] = SampleField(temperature, back) * keepTemperature;
+				}
+			}
+		}
+	});
+	density.swap(scratchX);
+	temperature.swap(scratchY);
+}
+
+bool ParticleFluidSolver::Sample(Float3 position, Float3& velocity) const
+{
+	const float invH = 1.0f / cellSize;
+	float coords[3] = { (position.x - minCorner.x) * invH - 0.5f, (position.y - minCorner.y) * invH - 0.5f,
+		(position.z - minCorner.z) * invH - 0.5f };
+	for (int a = 0; a < 3; a++)
+	{
+		if (!(-0.5f < coords[a] && coords[a] < resolution - 0.5f))
+		{
+			velocity = { 0.0f, 0.0f, 0.0f };
+			return false;
+		}
+	}
+	SamplePoint point = Locate(coords[0], coords[1], coords[2]);
+	velocity = { SampleField(velocityX, point), SampleField(velocityY, point), SampleField(velocityZ, point) };
+	return true;
+}
+
+SimdFloat ParticleFluidSolver::Sample(SimdFloat px, SimdFloat py, SimdFloat pz, SimdFloat& vx, SimdFloat& vy, SimdFloat& vz) const
+{
+	const SimdFloat invH = SimdSet1(1.0f / cellSize);
+	const SimdFloat half = SimdSet1(0.5f);
+	const SimdFloat low = SimdSet1(-0.5f);
+	const SimdFloat high = SimdSet1(resolution - 0.5f);
+	const SimdFloat zero = SimdSet1(0.0f);
+	const SimdFloat last = SimdSet1((float)(resolution - 1));
+	const SimdFloat lastCell = SimdSet1((float)(resolution - 2));
+	const SimdFloat corner[3] = { SimdSet1(minCorner.x), SimdSet1(minCorner.y), SimdSet1(minCorner.z) };
+
+	SimdFloat coords[3] = { px, py, pz };
+	SimdFloat cell[3];
+	SimdFloat frac[3];
+	//all bits set while every axis is strictly inside, the same test as the scalar path
+	SimdFloat inside = SimdLess(SimdSet1(-1.0f), SimdSet1(0.0f));
+	for (int a = 0; a < 3; a++)
+	{
+		SimdFloat c = SimdSub(SimdMul(SimdSub(coords[a], corner[a]), invH), half);
+		inside = SimdSelect(SimdLess(low, c), inside, zero);
+		inside = SimdSelect(SimdLess(c, high), inside, zero);
+		c = SimdMin(SimdMax(c, zero), last);
+		//coordinates are not negative here, so truncating is flooring
+		cell[a] = SimdMin(SimdTruncate(c), lastCell);
+		frac[a] = SimdSub(c, cell[a]);
+	}
+
+	const SimdFloat strideY = SimdSet1((float)resolution);
+	const SimdFloat strideZ = SimdSet1((float)(resolution * resolution));
+	SimdFloat base = SimdAdd(SimdAdd(SimdMul(cell[2], strideZ), SimdMul(cell[1], strideY)), cell[0]);
+
+	vx = SimdSelect(inside, SimdSampleTrilinear(velocityX.data(), base, strideY, strideZ, frac[0], frac[1], frac[2]), zero);
+	vy = SimdSelect(inside, SimdSampleTrilinear(velocityY.data(), base, strideY, strideZ, frac[0], frac[1], frac[2]), zero);
+	vz = SimdSelect(inside, SimdSampleTrilinear(velocityZ.data(), base, strideY, strideZ, frac[0], frac[1], frac[2]), zero);
+	return inside;
+}
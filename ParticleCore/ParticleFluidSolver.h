@@ -0,0 +1,109 @@
+#pragma once
+
+#include"ParticleMath.h"
+#include"ParticleSimd.h"
+#include"JobSystem.h"
+#include<memory>
+#include<vector>
+
+//Stable fluids smoke on a cube of resolution^3 cells centred on a point (semi-Lagrangian advection,
+//buoyancy from density and temperature, vorticity confinement, Jacobi pressure projection).
+//Every pass works on z slabs split over the job system, each slab only writes its own cells.
+//Resolution and pressure iterations can change at any time, so a caller can trade quality for a fixed ms per step.
+class ParticleFluidSolver
+{
+public:
+	ParticleFluidSolver(Float3 center, float size, int resolution);
+
+	ParticleFluidSolver(const ParticleFluidSolver&) = delete;
+	ParticleFluidSolver& operator=(const ParticleFluidSolver&) = delete;
+
+	//advance the smoke by dt seconds
+	void Step(float dt);
+	//drop every field back to still, empty air
+	void Clear();
+
+	//cells per axis, clears the fields when it changes (at least 4)
+	void SetResolution(int resolution);
+	//Jacobi iterations of the pressure solve, more removes more divergence
+	void SetPressureIterations(int iterations);
+	//when above 0, pressure iterations are retuned after every step so Step takes about this long
+	void SetStepBudget(float milliseconds);
+	//split every pass over the job system's workers, null runs on the calling thread
+	void SetJobSystem(std::shared_ptr<JobSystem> jobSystem);
+
+	//sphere adding density and temperature per second and pushing the air inside it to velocity
+	void SetSource(Float3 position, float radius, float densityRate, float temperatureRate, Float3 velocity);
+	//upward acceleration of temperatureLift per degree, minus densityWeight per unit of smoke
+	void SetBuoyancy(float densityWeight, float temperatureLift);
+	//strength of the force feeding back small swirls that advection smooths away
+	void SetVorticityConfinement(float strength);
+	//fraction of density and temperature lost per second
+	void SetDissipation(float density, float temperature);
+
+	int GetResolution() const { return resolution; }
+	int GetPressureIterations() const { return pressureIterations; }
+	float GetLastStepMilliseconds() const { return lastStepMilliseconds; }
+	Float3 GetMinCorner() const { return minCorner; }
+	float GetCellSize() const { return cellSize; }
+	//resolution^3 cells, x fastest
+	const float* GetDensity() const { return density.data(); }
+
+	//trilinear air velocity at a world position, false (and zero) outside the grid
+	bool Sample(Float3 position, Float3& velocity) const;
+	//same per lane, returns a mask set in lanes inside the grid, velocity is zero in the others
+	SimdFloat Sample(SimdFloat px, SimdFloat py, SimdFloat pz, SimdFloat& vx, SimdFloat& vy, SimdFloat& vz) const;
+
+private:
+	Float3 center;
+	float size;
+	int resolution;
+	float cellSize;
+	Float3 minCorner;
+
+	int pressureIterations;
+	float stepBudget;
+	float lastStepMilliseconds;
+
+	Float3 sourcePosition;
+	float sourceRadius;
+	float sourceDensityRate;
+	float sourceTemperatureRate;
+	Float3 sourceVelocity;
+	float densityWeight;
+	float temperatureLift;
+	float confinement;
+	float densityDissipation;
+	float temperatureDissipation;
+
+	std::vector<float> velocityX, velocityY, velocityZ;
+	std::vector<float> density, temperature;
+	//advection targets, swapped with the fields after every advection
+	std::vector<float> scratchX, scratchY, scratchZ;
+	std::vector<float> pressure, pressureScratch, divergence;
+	//vorticity per cell, then its length in curlLength
+	std::vector<float> curlX, curlY, curlZ, curlLength;
+	//pressure above the open top
+	std::vector<float> zeroRow;
+
+	std::shared_ptr<JobSystem> jobSystem;
+
+	int Index(int x, int y, int z) const { return (z * resolution + y) * resolution + x; }
+	//run body over z slabs [begin, end)
+	void ParallelSlabs(const std::function<void(int, int)>& body);
+
+	void AddForces(float dt);
+	void AdvectVelocity(float dt);
+	void Project();
+	void AdvectScalars(float dt);
+	//low corner and weights of a trilinear lookup, shared by every field read at the same point
+	struct SamplePoint
+	{
+		int base;
+		float fx, fy, fz;
+	};
+	//point in cell coordinates, clamped to the grid
+	SamplePoint Locate(float x, float y, float z) const;
+	float SampleField(const std::vector<float>& field, const SamplePoint& point) const;
+	void ResizeFields();
+};
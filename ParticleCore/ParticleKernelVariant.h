@@ -0,0 +1,320 @@
+#pragma once
+
+#include"ParticleKernels.h"
+#include"ParticleSimd.h"
+#include<cstring>
+
+//Bodies of the dispatched kernels, compiled once per instruction set: by ParticleKernels.cpp for the baseline the
+//library is built for, and by ParticleKernelsSse41.cpp, ParticleKernelsAvx2.cpp and ParticleKernelsAvx512.cpp with
+//that set enabled. Everything here has internal linkage so every file keeps its own width.
+//Multiply and add stay separate at every width, so all variants write the same bits.
+
+//Corner offsets in [-1,1] matching the clockwise uvs (0,0) (1,0) (1,1) (0,1), with Y flipped
+static const float quadOffsetX[4] = { -1.0f, 1.0f, 1.0f, -1.0f };
+static const float quadOffsetY[4] = { 1.0f, 1.0f, -1.0f, -1.0f };
+
+static inline unsigned int PackChannel(float c)
+{
+	c = c < 0.0f ? 0.0f : (c > 1.0f ? 1.0f : c);
+	return (unsigned int)(c * 255.0f + 0.5f);
+}
+
+static inline unsigned int PackColor(float r, float g, float b, float a)
+{
+	return PackChannel(r) | (PackChannel(g) << 8) | (PackChannel(b) << 16) | (PackChannel(a) << 24);
+}
+
+//float bits mapped to an unsigned int with the same order, flipped so larger depths come first
+static inline uint32_t FarFirstKey(float depth)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &depth, sizeof(bits));
+	uint32_t mask = (uint32_t)((int32_t)bits >> 31) | 0x80000000u;
+	return ~(bits ^ mask);
+}
+
+static void UpdateParticleDataVariant(ParticleData& particles, int begin, int end, float dt, const ParticleUpdateParams& params)
+{
+	const SimdFloat vDt = SimdSet1(dt);
+	const SimdFloat invLifetime = SimdSet1(1.0f / params.lifetime);
+	const ParticleLifeTables& tables = *params.tables;
+
+	for (int i = begin; i < end; i += PARTICLE_SIMD_WIDTH)
+	{
+		//update age for size and color lookups
+		SimdFloat age = SimdAdd(SimdLoad(particles.Age + i), vDt);
+		SimdStore(particles.Age + i, age);
+		SimdFloat ageRatio = SimdMul(age, invLifetime);
+
+		//Determine size on basis of age
+		SimdStore(particles.Size + i, SimdSampleLifeTable(tables.Size, ageRatio));
+
+		//Determine color on basis of age
+		SimdStore(particles.ColorR + i, SimdSampleLifeTable(tables.ColorR, ageRatio));
+		SimdStore(particles.ColorG + i, SimdSampleLifeTable(tables.ColorG, ageRatio));
+		SimdStore(particles.ColorB + i, SimdSampleLifeTable(tables.ColorB, ageRatio));
+		SimdStore(particles.ColorA + i, SimdSampleLifeTable(tables.ColorA, ageRatio));
+	}
+}
+
+static void AdvanceSpawnedParticlesVariant(ParticleData& particles, int begin, int end, const float* ages, const ParticleUpdateParams& params)
+{
+	const SimdFloat invLifetime = SimdSet1(1.0f / params.lifetime);
+	const ParticleLifeTables& tables = *params.tables;
+
+	//spawn runs start anywhere, so batches load and store unaligned and the last one only touches its live lanes
+	for (int i = begin; i < end; i += PARTICLE_SIMD_WIDTH)
+	{
+		const int count = end - i;
+		SimdFloat age = SimdLoadPartial(ages + (i - begin), count);
+		SimdStorePartial(particles.Age + i, age, count);
+		SimdFloat ageRatio = SimdMul(age, invLifetime);
+
+		//catch position up to the birth time
+		SimdStorePartial(particles.PositionX + i,
+			SimdMulAdd(SimdLoadPartial(particles.VelocityX + i, count), age, SimdLoadPartial(particles.PositionX + i, count)), count);
+		SimdStorePartial(particles.PositionY + i,
+			SimdMulAdd(SimdLoadPartial(particles.VelocityY + i, count), age, SimdLoadPartial(particles.PositionY + i, count)), count);
+		SimdStorePartial(particles.PositionZ + i,
+			SimdMulAdd(SimdLoadPartial(particles.VelocityZ + i, count), age, SimdLoadPartial(particles.PositionZ + i, count)), count);
+
+		SimdStorePartial(particles.Size + i, SimdSampleLifeTable(tables.Size, ageRatio), count);
+		SimdStorePartial(particles.ColorR + i, SimdSampleLifeTable(tables.ColorR, ageRatio), count);
+		SimdStorePartial(particles.ColorG + i, SimdSampleLifeTable(tables.ColorG, ageRatio), count);
+		SimdStorePartial(particles.ColorB + i, SimdSampleLifeTable(tables.ColorB, ageRatio), count);
+		SimdStorePartial(particles.ColorA + i, SimdSampleLifeTable(tables.ColorA, ageRatio), count);
+	}
+}
+
+//Credits: Prof Cascioli (corner math from CalcParticleVertexPosition)
+//lanes [0, count) of stream at particles order[first + l], or first + l when order is null, zero past count
+static inline SimdFloat LoadParticleLanes(const float* stream, const unsigned int* order, int first, int count)
+{
+	if (!order)
+		return SimdLoadPartial(stream + first, count);
+	alignas(64) float lanes[PARTICLE_SIMD_WIDTH] = {};
+	for (int l = 0; l < count; l++)
+		lanes[l] = stream[order[first + l]];
+	return SimdLoad(lanes);
+}
+
+static void BuildParticleVerticesVariant(const ParticleData& particles, int begin, int end, Float3 cameraRight, Float3 cameraUp,
+	const unsigned int* order, ParticleVertex* vertices)
+{
+	// Camera right and up are fetched once per frame by the caller,
+	// instead of once per corner
+	const SimdFloat rightX = SimdSet1(cameraRight.x), rightY = SimdSet1(cameraRight.y), rightZ = SimdSet1(cameraRight.z);
+	const SimdFloat upX = SimdSet1(cameraUp.x), upY = SimdSet1(cameraUp.y), upZ = SimdSet1(cameraUp.z);
+
+	//a SIMD batch of particles at a time: the corners are spun by Rotation in the camera plane exactly like
+	//ExpandParticleInstance and moved to world space in lanes, then the lanes are scattered into the quads
+	alignas(64) float cornerX[4][PARTICLE_SIMD_WIDTH];
+	alignas(64) float cornerY[4][PARTICLE_SIMD_WIDTH];
+	alignas(64) float cornerZ[4][PARTICLE_SIMD_WIDTH];
+	alignas(64) float colors[4][PARTICLE_SIMD_WIDTH];
+	for (int first = begin; first < end; first += PARTICLE_SIMD_WIDTH)
+	{
+		const int batch = end - first < PARTICLE_SIMD_WIDTH ? end - first : PARTICLE_SIMD_WIDTH;
+		const SimdFloat x = LoadParticleLanes(particles.PositionX, order, first, batch);
+		const SimdFloat y = LoadParticleLanes(particles.PositionY, order, first, batch);
+		const SimdFloat z = LoadParticleLanes(particles.PositionZ, order, first, batch);
+		const SimdFloat size = LoadParticleLanes(particles.Size, order, first, batch);
+		SimdFloat s, c;
+		SimdSinCos(LoadParticleLanes(particles.Rotation, order, first, batch), s, c);
+
+		for (int corner = 0; corner < 4; corner++)
+		{
+			const SimdFloat offsetX = SimdSet1(quadOffsetX[corner]);
+			const SimdFloat offsetY = SimdSet1(quadOffsetY[corner]);
+			const SimdFloat right = SimdMul(SimdSub(SimdMul(offsetX, c), SimdMul(offsetY, s)), size);
+			const SimdFloat up = SimdMul(SimdAdd(SimdMul(offsetX, s), SimdMul(offsetY, c)), size);
+			SimdStore(cornerX[corner], SimdAdd(SimdAdd(x, SimdMul(rightX, right)), SimdMul(upX, up)));
+			SimdStore(cornerY[corner], SimdAdd(SimdAdd(y, SimdMul(rightY, right)), SimdMul(upY, up)));
+			SimdStore(cornerZ[corner], SimdAdd(SimdAdd(z, SimdMul(rightZ, right)), SimdMul(upZ, up)));
+		}
+		SimdStore(colors[0], LoadParticleLanes(particles.ColorR, order, first, batch));
+		SimdStore(colors[1], LoadParticleLanes(particles.ColorG, order, first, batch));
+		SimdStore(colors[2], LoadParticleLanes(particles.ColorB, order, first, batch));
+		SimdStore(colors[3], LoadParticleLanes(particles.ColorA, order, first, batch));
+
+		for (int l = 0; l < batch; l++)
+		{
+			ParticleVertex* quad = &vertices[(first + l) * 4];        //4 vertices per particle
+			const Float4 color = { colors[0][l], colors[1][l], colors[2][l], colors[3][l] };
+			for (int corner = 0; corner < 4; corner++)
+			{
+				quad[corner].Position = { cornerX[corner][l], cornerY[corner][l], cornerZ[corner][l] };
+				quad[corner].Color = color;
+			}
+		}
+	}
+}
+
+static void PackParticleInstancesVariant(const ParticleData& particles, int begin, int end, const unsigned int* order, ParticleInstance* instances)
+{
+	for (int i = begin; i < end; i++)
+	{
+		const int p = order ? (int)order[i] : i;
+		ParticleInstance& instance = instances[i];
+		instance.Center = { particles.PositionX[p], particles.PositionY[p], particles.PositionZ[p] };
+		instance.Size = particles.Size[p];
+		instance.Color = PackColor(particles.ColorR[p], particles.ColorG[p], particles.ColorB[p], particles.ColorA[p]);
+		instance.Rotation = particles.Rotation[p];
+	}
+}
+
+static void BuildDepthKeysVariant(const ParticleData& particles, const unsigned int* slots, int first, int count,
+	Float3 cameraPosition, Float3 cameraForward, uint64_t* items)
+{
+	//the contiguous case is a plain loop over the streams, which the compiler vectorizes at the file's width
+	if (!slots)
+	{
+		const float* x = particles.PositionX + first;
+		const float* y = particles.PositionY + first;
+		const float* z = particles.PositionZ + first;
+		for (int i = 0; i < count; i++)
+		{
+			float depth = (x[i] - cameraPosition.x) * cameraForward.x + (y[i] - cameraPosition.y) * cameraForward.y +
+				(z[i] - cameraPosition.z) * cameraForward.z;
+			items[i] = ((uint64_t)FarFirstKey(depth) << 32) | (uint32_t)(first + i);
+		}
+		return;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		unsigned int slot = slots[i];
+		float depth = (particles.PositionX[slot] - cameraPosition.x) * cameraForward.x +
+			(particles.PositionY[slot] - cameraPosition.y) * cameraForward.y +
+			(particles.PositionZ[slot] - cameraPosition.z) * cameraForward.z;
+		items[i] = ((uint64_t)FarFirstKey(depth) << 32) | slot;
+	}
+}
+
+//lowbias32, lane for lane the scalar Hash in ParticleRandom.cpp
+static inline SimdInt SimdRandomHash(SimdInt x)
+{
+	x = SimdIntXor(x, SimdIntShiftRight<16>(x));
+	x = SimdIntMul(x, SimdIntSet1((int)0x7feb352du));
+	x = SimdIntXor(x, SimdIntShiftRight<15>(x));
+	x = SimdIntMul(x, SimdIntSet1((int)0x846ca68bu));
+	x = SimdIntXor(x, SimdIntShiftRight<16>(x));
+	return x;
+}
+
+//values n of the stream keyed by key as floats in [0, 1), the top 24 bits so the conversion is exact
+static inline SimdFloat SimdRandomUnit(SimdInt n, SimdInt key)
+{
+	SimdInt bits = SimdRandomHash(SimdIntXor(SimdRandomHash(n), key));
+	return SimdMul(SimdIntToFloat(SimdIntShiftRight<8>(bits)), SimdSet1(1.0f / 16777216.0f));
+}
+
+//values counter + i + lane of the batch at i
+static inline SimdInt SimdRandomCounters(unsigned int counter, int i)
+{
+	return SimdIntAdd(SimdIntSet1((int)(counter + (unsigned int)i)), SimdIntLanes());
+}
+
+//The random kernels compute tail lanes like full ones and only store the live lanes, so every width gives the same bits
+
+static void RandomUniformVariant(unsigned int key, unsigned int counter, float* out, int count, float min, float range)
+{
+	const SimdInt vKey = SimdIntSet1((int)key);
+	for (int i = 0; i < count; i += PARTICLE_SIMD_WIDTH)
+	{
+		SimdFloat u = SimdRandomUnit(SimdRandomCounters(counter, i), vKey);
+		SimdStorePartial(out + i, SimdMulAdd(u, SimdSet1(range), SimdSet1(min)), count - i);
+	}
+}
+
+static void RandomNormalVariant(unsigned int key, unsigned int counter, float* out, int count, float mean, float standardDeviation)
+{
+	//Box-Muller on pair p, values counter + 2p and counter + 2p + 1: the cosine goes to out[2p], the sine to out[2p + 1]
+	const SimdInt vKey = SimdIntSet1((int)key);
+	const int pairs = (count + 1) / 2;
+	alignas(64) float cosines[PARTICLE_SIMD_WIDTH];
+	alignas(64) float sines[PARTICLE_SIMD_WIDTH];
+	for (int p = 0; p < pairs; p += PARTICLE_SIMD_WIDTH)
+	{
+		SimdInt n = SimdIntAdd(SimdIntSet1((int)(counter + 2u * (unsigned int)p)), SimdIntAdd(SimdIntLanes(), SimdIntLanes()));
+		SimdFloat u0 = SimdRandomUnit(n, vKey);
+		SimdFloat u1 = SimdRandomUnit(SimdIntAdd(n, SimdIntSet1(1)), vKey);
+
+		//1 - u keeps the log argument in (0, 1]
+		SimdFloat radius = SimdMul(SimdSqrt(SimdMul(SimdSet1(-2.0f), SimdLog(SimdSub(SimdSet1(1.0f), u0)))), SimdSet1(standardDeviation));
+		SimdFloat s, c;
+		SimdSinCos(SimdMul(SimdSet1(6.28318530718f), u1), s, c);
+		SimdStore(cosines, SimdMulAdd(radius, c, SimdSet1(mean)));
+		SimdStore(sines, SimdMulAdd(radius, s, SimdSet1(mean)));
+
+		const int batch = pairs - p < PARTICLE_SIMD_WIDTH ? pairs - p : PARTICLE_SIMD_WIDTH;
+		for (int l = 0; l < batch; l++)
+		{
+			const int i = 2 * (p + l);
+			out[i] = cosines[l];
+			if (i + 1 < count)
+				out[i + 1] = sines[l];
+		}
+	}
+}
+
+static void RandomInSphereVariant(unsigned int key, unsigned int counter, float* x, float* y, float* z, int count, float radius)
+{
+	//point i from values counter + i (radius), + count + i (azimuth) and + 2 count + i (height)
+	const SimdInt vKey = SimdIntSet1((int)key);
+	const SimdInt azimuthOffset = SimdIntSet1((int)(unsigned int)count);
+	const SimdInt heightOffset = SimdIntSet1((int)(2u * (unsigned int)count));
+	for (int i = 0; i < count; i += PARTICLE_SIMD_WIDTH)
+	{
+		SimdInt n = SimdRandomCounters(counter, i);
+		SimdFloat ur = SimdRandomUnit(n, vKey);
+		SimdFloat uPhi = SimdRandomUnit(SimdIntAdd(n, azimuthOffset), vKey);
+		SimdFloat uHeight = SimdRandomUnit(SimdIntAdd(n, heightOffset), vKey);
+
+		//direction from uniform height and azimuth, cube root radius for a uniform volume density
+		SimdFloat cosTheta = SimdSub(SimdMul(SimdSet1(2.0f), uHeight), SimdSet1(1.0f));
+		SimdFloat sinTheta = SimdSqrt(SimdMax(SimdSet1(0.0f), SimdSub(SimdSet1(1.0f), SimdMul(cosTheta, cosTheta))));
+		SimdFloat r = SimdMul(SimdSet1(radius), SimdCbrt(ur));
+		SimdFloat s, c;
+		SimdSinCos(SimdMul(SimdSet1(6.28318530718f), uPhi), s, c);
+
+		SimdFloat rSinTheta = SimdMul(r, sinTheta);
+		SimdStorePartial(x + i, SimdMul(rSinTheta, c), count - i);
+		SimdStorePartial(y + i, SimdMul(rSinTheta, s), count - i);
+		SimdStorePartial(z + i, SimdMul(r, cosTheta), count - i);
+	}
+}
+
+static void RandomInConeVariant(unsigned int key, unsigned int counter, float* x, float* y, float* z, int count, Float3 axis,
+	Float3 tangent, Float3 bitangent, float minCos)
+{
+	//direction i from values counter + i (polar) and counter + count + i (azimuth)
+	const SimdInt vKey = SimdIntSet1((int)key);
+	const SimdInt azimuthOffset = SimdIntSet1((int)(unsigned int)count);
+	for (int i = 0; i < count; i += PARTICLE_SIMD_WIDTH)
+	{
+		SimdInt n = SimdRandomCounters(counter, i);
+		SimdFloat uPolar = SimdRandomUnit(n, vKey);
+		SimdFloat uPhi = SimdRandomUnit(SimdIntAdd(n, azimuthOffset), vKey);
+
+		//uniform over the spherical cap: cos theta uniform in [minCos, 1]
+		SimdFloat cosTheta = SimdSub(SimdSet1(1.0f), SimdMul(uPolar, SimdSet1(1.0f - minCos)));
+		SimdFloat sinTheta = SimdSqrt(SimdMax(SimdSet1(0.0f), SimdSub(SimdSet1(1.0f), SimdMul(cosTheta, cosTheta))));
+		SimdFloat s, c;
+		SimdSinCos(SimdMul(SimdSet1(6.28318530718f), uPhi), s, c);
+		SimdFloat t = SimdMul(sinTheta, c);
+		SimdFloat b = SimdMul(sinTheta, s);
+
+		SimdStorePartial(x + i, SimdMulAdd(SimdSet1(axis.x), cosTheta,
+			SimdMulAdd(SimdSet1(bitangent.x), b, SimdMul(SimdSet1(tangent.x), t))), count - i);
+		SimdStorePartial(y + i, SimdMulAdd(SimdSet1(axis.y), cosTheta,
+			SimdMulAdd(SimdSet1(bitangent.y), b, SimdMul(SimdSet1(tangent.y), t))), count - i);
+		SimdStorePartial(z + i, SimdMulAdd(SimdSet1(axis.z), cosTheta,
+			SimdMulAdd(SimdSet1(bitangent.z), b, SimdMul(SimdSet1(tangent.z), t))), count - i);
+	}
+}
+
+//defined by the variant files that are built, see PARTICLE_KERNEL_DISPATCH in CMakeLists.txt
+const ParticleKernelTable& GetSse41ParticleKernels();
+const ParticleKernelTable& GetAvx2ParticleKernels();
+const ParticleKernelTable& GetAvx512ParticleKernels();
@@ -0,0 +1,127 @@
+#include "ParticleKernels.h"
+#include "ParticleKernelVariant.h"
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	//the instruction set this file, and with it the rest of the library, is compiled for
+#if defined(__AVX512F__)
+	const ParticleIsa baselineIsa = ParticleIsa::Avx512;
+#elif defined(__AVX2__)
+	const ParticleIsa baselineIsa = ParticleIsa::Avx2;
+#elif defined(__AVX__)
+	const ParticleIsa baselineIsa = ParticleIsa::Avx;
+#elif defined(PARTICLE_SIMD_SSE41)
+	const ParticleIsa baselineIsa = ParticleIsa::Sse41;
+#else
+	const ParticleIsa baselineIsa = ParticleIsa::Sse2;
+#endif
+
+	const ParticleKernelTable baselineKernels = { baselineIsa, UpdateParticleDataVariant, AdvanceSpawnedParticlesVariant,
+		BuildParticleVerticesVariant, PackParticleInstancesVariant, BuildDepthKeysVariant,
+		RandomUniformVariant, RandomNormalVariant, RandomInSphereVariant, RandomInConeVariant };
+
+	std::atomic<const ParticleKernelTable*> activeKernels(nullptr);
+
+	const ParticleKernelTable* SelectKernels()
+	{
+		std::vector<const ParticleKernelTable*> variants = GetParticleKernelVariants();
+		const char* requested = std::getenv("PARTICLE_KERNELS");
+		if (requested)
+		{
+			for (const ParticleKernelTable* kernels : variants)
+			{
+				if (!std::strcmp(requested, GetParticleIsaName(kernels->isa)) && IsParticleIsaSupported(kernels->isa))
+					return kernels;
+			}
+		}
+
+		const ParticleKernelTable* best = variants[0];
+		for (const ParticleKernelTable* kernels : variants)
+		{
+			if (IsParticleIsaSupported(kernels->isa))
+				best = kernels;
+		}
+		return best;
+	}
+}
+
+std::vector<const ParticleKernelTable*> GetParticleKernelVariants()
+{
+	std::vector<const ParticleKernelTable*> variants = { &baselineKernels };
+#if !defined(PARTICLE_NO_KERNEL_DISPATCH)
+	//a variant the baseline already covers would only be a slower copy
+	for (const ParticleKernelTable* kernels : { &GetSse41ParticleKernels(), &GetAvx2ParticleKernels(), &GetAvx512ParticleKernels() })
+	{
+		if (kernels->isa > baselineIsa)
+			variants.push_back(kernels);
+	}
+#endif
+	return variants;
+}
+
+const ParticleKernelTable& GetParticleKernels()
+{
+	const ParticleKernelTable* kernels = activeKernels.load(std::memory_order_acquire);
+	if (!kernels)
+	{
+		//threads racing here all pick the same table
+		kernels = SelectKernels();
+		activeKernels.store(kernels, std::memory_order_release);
+	}
+	return *kernels;
+}
+
+void SetParticleKernels(const ParticleKernelTable& kernels)
+{
+	activeKernels.store(&kernels, std::memory_order_release);
+}
+
+void UpdateParticleData(ParticleData& particles, int begin, int end, float dt, const ParticleUpdateParams& params)
+{
+	GetParticleKernels().UpdateParticleData(particles, begin, end, dt, params);
+}
+
+void AdvanceSpawnedParticles(ParticleData& particles, int begin, int end, const float* ages, const ParticleUpdateParams& params)
+{
+	GetParticleKernels().AdvanceSpawnedParticles(particles, begin, end, ages, params);
+}
+
+void BuildParticleVertices(const ParticleData& particles, int begin, int end, Float3 cameraRight, Float3 cameraUp,
+	const unsigned int* order, ParticleVertex* vertices)
+{
+	GetParticleKernels().BuildParticleVertices(particles, begin, end, cameraRight, cameraUp, order, vertices);
+}
+
+void PackParticleInstances(const ParticleData& particles, int begin, int end, const unsigned int* order, ParticleInstance* instances)
+{
+	GetParticleKernels().PackParticleInstances(particles, begin, end, order, instances);
+}
+
+void BuildDepthKeys(const ParticleData& particles, const unsigned int* slots, int first, int count, Float3 cameraPosition,
+	Float3 cameraForward, uint64_t* items)
+{
+	GetParticleKernels().BuildDepthKeys(particles, slots, first, count, cameraPosition, cameraForward, items);
+}
+
+Float3 ExpandParticleInstance(const ParticleInstance& instance, Float3 cameraRight, Float3 cameraUp, int corner)
+{
+	//rotate the corner offset around the view direction, then scale it onto the camera axes
+	float c = cosf(instance.Rotation);
+	float s = sinf(instance.Rotation);
+	float right = (quadOffsetX[corner] * c - quadOffsetY[corner] * s) * instance.Size;
+	float up = (quadOffsetX[corner] * s + quadOffsetY[corner] * c) * instance.Size;
+
+	return Float3{
+		instance.Center.x + cameraRight.x * right + cameraUp.x * up,
+		instance.Center.y + cameraRight.y * right + cameraUp.y * up,
+		instance.Center.z + cameraRight.z * right + cameraUp.z * up };
+}
+
+unsigned int PackParticleColor(float r, float g, float b, float a)
+{
+	return PackColor(r, g, b, a);
+}
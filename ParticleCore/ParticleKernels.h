@@ -0,0 +1,85 @@
+#pragma once
+
+#include"Particle.h"
+#include"ParticleData.h"
+#include"ParticleCurves.h"
+#include"ParticleCpu.h"
+#include<cstdint>
+#include<vector>
+
+//Batch kernels run by ParticleSimulation over the SoA streams
+
+//per emitter constants used by the update kernel
+struct ParticleUpdateParams
+{
+	float lifetime;
+	//size and color over life, sampled by age / lifetime
+	const ParticleLifeTables* tables;
+};
+
+//age particles [begin, end) and look up size and color, motion is the affector pipeline's job
+//runs in SIMD batches from begin, which must be a multiple of PARTICLE_STREAM_ALIGNMENT
+//lanes past end (stream padding) are updated too and ignored
+void UpdateParticleData(ParticleData& particles, int begin, int end, float dt, const ParticleUpdateParams& params);
+
+//newly spawned particles [begin, end): set Age from ages[0, end - begin) and catch position, size and color up
+//to it, the same state UpdateParticleData would have reached, any alignment
+void AdvanceSpawnedParticles(ParticleData& particles, int begin, int end, const float* ages, const ParticleUpdateParams& params);
+
+//build vertex stage - runs once per frame after simulation
+//writes 4 camera facing corners (position + color) per particle, uvs are left untouched
+//corners are spun by Rotation around the view direction, the same as ExpandParticleInstance
+//cameraRight / cameraUp are the world space camera axes (first two columns of the view matrix)
+//quads [begin, end) are written to vertices [begin * 4, end * 4), quad i from particle order[i], or particle i when order is null
+void BuildParticleVertices(const ParticleData& particles, int begin, int end, Float3 cameraRight, Float3 cameraUp,
+	const unsigned int* order, ParticleVertex* vertices);
+
+//instanced path - instances [begin, end), 24 bytes each instead of 4 vertices, instance i from particle order[i] or i
+void PackParticleInstances(const ParticleData& particles, int begin, int end, const unsigned int* order, ParticleInstance* instances);
+
+//CPU mirror of the corner math in VertexShader_ParticlesInstanced.hlsl, corner in [0, 4) in vertex order
+Float3 ExpandParticleInstance(const ParticleInstance& instance, Float3 cameraRight, Float3 cameraUp, int corner);
+
+//RGBA8 pack, channels clamped to [0, 1] and rounded
+unsigned int PackParticleColor(float r, float g, float b, float a);
+
+//depth sort keys along cameraForward for count particles: items[i] holds the key of particle slots[i], or of particle
+//first + i when slots is null, in the high 32 bits (farther particles get smaller keys) and the slot in the low 32
+void BuildDepthKeys(const ParticleData& particles, const unsigned int* slots, int first, int count, Float3 cameraPosition,
+	Float3 cameraForward, uint64_t* items);
+
+//UpdateParticleData, AdvanceSpawnedParticles, BuildParticleVertices, PackParticleInstances, BuildDepthKeys and the
+//ParticleRandom distributions compiled for one instruction set. The functions above and ParticleRandom run the active
+//table, every variant writes the same bits.
+//The affector pipeline is not in the table and always runs at the width the library is built for: it is instantiated
+//from each emitter's affector types in the file that composes them, and affectors call solver code built once at that
+//width (the SIMD Sample of ParticleFluidSolver, ParticleDistanceField and ParticleNoiseVolume)
+struct ParticleKernelTable
+{
+	ParticleIsa isa;
+	void (*UpdateParticleData)(ParticleData& particles, int begin, int end, float dt, const ParticleUpdateParams& params);
+	void (*AdvanceSpawnedParticles)(ParticleData& particles, int begin, int end, const float* ages, const ParticleUpdateParams& params);
+	void (*BuildParticleVertices)(const ParticleData& particles, int begin, int end, Float3 cameraRight, Float3 cameraUp,
+		const unsigned int* order, ParticleVertex* vertices);
+	void (*PackParticleInstances)(const ParticleData& particles, int begin, int end, const unsigned int* order, ParticleInstance* instances);
+	void (*BuildDepthKeys)(const ParticleData& particles, const unsigned int* slots, int first, int count, Float3 cameraPosition,
+		Float3 cameraForward, uint64_t* items);
+
+	//ParticleRandom's streams, from value counter of the stream keyed by key (see ParticleRandom.cpp for which values
+	//each one consumes). out[i] = min + u * range
+	void (*RandomUniform)(unsigned int key, unsigned int counter, float* out, int count, float min, float range);
+	void (*RandomNormal)(unsigned int key, unsigned int counter, float* out, int count, float mean, float standardDeviation);
+	void (*RandomInSphere)(unsigned int key, unsigned int counter, float* x, float* y, float* z, int count, float radius);
+	//tangent and bitangent complete axis to an orthonormal basis, minCos is the cosine of the half angle
+	void (*RandomInCone)(unsigned int key, unsigned int counter, float* x, float* y, float* z, int count, Float3 axis,
+		Float3 tangent, Float3 bitangent, float minCos);
+};
+
+//every table built into this binary, the baseline the library is compiled for first, then the wider ones.
+//Check IsParticleIsaSupported before running one
+std::vector<const ParticleKernelTable*> GetParticleKernelVariants();
+//the active table. Picked on first use: the variant named by the PARTICLE_KERNELS environment variable (sse2, sse4.1,
+//avx, avx2, avx512) when this cpu runs it, the widest one it runs otherwise
+const ParticleKernelTable& GetParticleKernels();
+//run kernels from now on, e.g. to compare variants, only while no kernels run on other threads
+void SetParticleKernels(const ParticleKernelTable& kernels);
@@ -0,0 +1,14 @@
+//AVX2 (8 wide, hardware gathers for the life tables) build of the dispatched kernels, compiled with -mavx2 or /arch:AVX2
+#include "ParticleKernelVariant.h"
+
+#if !defined(__AVX2__)
+#error ParticleKernelsAvx2.cpp must be compiled with AVX2 enabled
+#endif
+
+const ParticleKernelTable& GetAvx2ParticleKernels()
+{
+	static const ParticleKernelTable kernels = { ParticleIsa::Avx2, UpdateParticleDataVariant, AdvanceSpawnedParticlesVariant,
+		BuildParticleVerticesVariant, PackParticleInstancesVariant, BuildDepthKeysVariant,
+		RandomUniformVariant, RandomNormalVariant, RandomInSphereVariant, RandomInConeVariant };
+	return kernels;
+}
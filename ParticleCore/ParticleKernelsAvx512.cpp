@@ -0,0 +1,14 @@
+//AVX-512 (16 wide, a cache line per batch) build of the dispatched kernels, compiled with -mavx512f or /arch:AVX512
+#include "ParticleKernelVariant.h"
+
+#if !defined(__AVX512F__)
+#error ParticleKernelsAvx512.cpp must be compiled with AVX512F enabled
+#endif
+
+const ParticleKernelTable& GetAvx512ParticleKernels()
+{
+	static const ParticleKernelTable kernels = { ParticleIsa::Avx512, UpdateParticleDataVariant, AdvanceSpawnedParticlesVariant,
+		BuildParticleVerticesVariant, PackParticleInstancesVariant, BuildDepthKeysVariant,
+		RandomUniformVariant, RandomNormalVariant, RandomInSphereVariant, RandomInConeVariant };
+	return kernels;
+}
@@ -0,0 +1,15 @@
+//SSE4.1 (4 wide, blendv selects) build of the dispatched kernels, compiled with -msse4.1.
+//MSVC has no SSE4.1 switch, the project defines PARTICLE_SIMD_SSE41 for this file instead
+#include "ParticleKernelVariant.h"
+
+#if !defined(PARTICLE_SIMD_SSE41)
+#error ParticleKernelsSse41.cpp must be compiled with SSE4.1 enabled
+#endif
+
+const ParticleKernelTable& GetSse41ParticleKernels()
+{
+	static const ParticleKernelTable kernels = { ParticleIsa::Sse41, UpdateParticleDataVariant, AdvanceSpawnedParticlesVariant,
+		BuildParticleVerticesVariant, PackParticleInstancesVariant, BuildDepthKeysVariant,
+		RandomUniformVariant, RandomNormalVariant, RandomInSphereVariant, RandomInConeVariant };
+	return kernels;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+//Minimal vector types for the particle core, so it builds without DirectXMath or any Windows header.
+//Layouts match DirectX::XMFLOAT2/3/4, so arrays of them can be handed straight to D3D buffers.
+
+#include <cmath>
+
+struct Float2
+{
+	float x;
+	float y;
+};
+
+struct Float3
+{
+	float x;
+	float y;
+	float z;
+};
+
+struct Float4
+{
+	float x;
+	float y;
+	float z;
+	float w;
+};
+
+//two unit vectors perpendicular to the unit vector axis and to each other
+inline void MakeOrthonormalBasis(Float3 axis, Float3& tangent, Float3& bitangent)
+{
+	//cross with the world axis least aligned with axis
+	Float3 helper = (axis.x < 0.9f && axis.x > -0.9f) ? Float3{ 1.0f, 0.0f, 0.0f } : Float3{ 0.0f, 1.0f, 0.0f };
+	tangent = { axis.y * helper.z - axis.z * helper.y, axis.z * helper.x - axis.x * helper.z, axis.x * helper.y - axis.y * helper.x };
+	float length = std::sqrt(tangent.x * tangent.x + tangent.y * tangent.y + tangent.z * tangent.z);
+	tangent = { tangent.x / length, tangent.y / length, tangent.z / length };
+	bitangent = { axis.y * tangent.z - axis.z * tangent.y, axis.z * tangent.x - axis.x * tangent.z, axis.x * tangent.y - axis.y * tangent.x };
+}
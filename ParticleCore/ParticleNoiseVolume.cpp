@@ -0,0 +1,335 @@
+#include "ParticleNoiseVolume.h"
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+	//cache file header
+	const char cacheMagic[4] = { 'P', 'N', 'V', '1' };
+	//grid cells per noise lattice cell at the base octave
+	const int cellsPerFeature = 8;
+
+	unsigned int HashLattice(int x, int y, int z, unsigned int seed)
+	{
+		unsigned int h = seed ^ ((unsigned int)x * 0x8da6b343u) ^ ((unsigned int)y * 0xd8163841u) ^ ((unsigned int)z * 0xcb1ab31fu);
+		h ^= h >> 16;
+		h *= 0x7feb352du;
+		h ^= h >> 15;
+		h *= 0x846ca68bu;
+		h ^= h >> 16;
+		return h;
+	}
+
+	//one of the 12 cube edge directions, as in improved Perlin noise
+	float GradientDot(unsigned int hash, float x, float y, float z)
+	{
+		switch (hash % 12)
+		{
+		case 0: return x + y;
+		case 1: return -x + y;
+		case 2: return x - y;
+		case 3: return -x - y;
+		case 4: return x + z;
+		case 5: return -x + z;
+		case 6: return x - z;
+		case 7: return -x - z;
+		case 8: return y + z;
+		case 9: return -y + z;
+		case 10: return y - z;
+		default: return -y - z;
+		}
+	}
+
+	float Fade(float t)
+	{
+		return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+	}
+
+	int Wrap(int i, int period)
+	{
+		i %= period;
+		return i < 0 ? i + period : i;
+	}
+
+	//gradient noise on a lattice that repeats every period cells
+	float PeriodicNoise(float x, float y, float z, int period, unsigned int seed)
+	{
+		int ix = (int)std::floor(x);
+		int iy = (int)std::floor(y);
+		int iz = (int)std::floor(z);
+		float fx = x - ix;
+		float fy = y - iy;
+		float fz = z - iz;
+
+		float corners[8];
+		for (int c = 0; c < 8; c++)
+		{
+			int dx = c & 1;
+			int dy = (c >> 1) & 1;
+			int dz = (c >> 2) & 1;
+			unsigned int h = HashLattice(Wrap(ix + dx, period), Wrap(iy + dy, period), Wrap(iz + dz, period), seed);
+			corners[c] = GradientDot(h, fx - dx, fy - dy, fz - dz);
+		}
+
+		float u = Fade(fx);
+		float v = Fade(fy);
+		float w = Fade(fz);
+		float x00 = corners[0] + (corners[1] - corners[0]) * u;
+		float x10 = corners[2] + (corners[3] - corners[2]) * u;
+		float x01 = corners[4] + (corners[5] - corners[4]) * u;
+		float x11 = corners[6] + (corners[7] - corners[6]) * u;
+		float y0 = x00 + (x10 - x00) * v;
+		float y1 = x01 + (x11 - x01) * v;
+		return y0 + (y1 - y0) * w;
+	}
+}
+
+ParticleNoiseVolume::ParticleNoiseVolume()
+	: resolution(0), seed(0)
+{
+}
+
+void ParticleNoiseVolume::Generate(NoiseQuality quality, unsigned int seed)
+{
+	const int n = (int)quality;
+	const int period = n / cellsPerFeature;
+	this->seed = seed;
+
+	//vector potential: 3 independent 2 octave noise fields on the grid
+	std::vector<float> potential[3];
+	for (int c = 0; c < 3; c++)
+	{
+		potential[c].resize((size_t)n * n * n);
+		unsigned int channelSeed = seed * 3u + (unsigned int)c;
+		for (int z = 0; z < n; z++)
+		{
+			for (int y = 0; y < n; y++)
+			{
+				for (int x = 0; x < n; x++)
+				{
+					float fx = (float)x / cellsPerFeature;
+					float fy = (float)y / cellsPerFeature;
+					float fz = (float)z / cellsPerFeature;
+					float value = PeriodicNoise(fx, fy, fz, period, channelSeed) +
+						0.5f * PeriodicNoise(fx * 2.0f, fy * 2.0f, fz * 2.0f, period * 2, channelSeed + 0x9e3779b9u);
+					potential[c][((size_t)z * n + y) * n + x] = value;
+				}
+			}
+		}
+	}
+
+	//curl by periodic central differences, divergence free up to the discretization
+	auto at = [&](int c, int x, int y, int z) {
+		return potential[c][((size_t)Wrap(z, n) * n + Wrap(y, n)) * n + Wrap(x, n)];
+	};
+	std::vector<float> curl[3];
+	for (int c = 0; c < 3; c++)
+	{
+		curl[c].resize((size_t)n * n * n);
+	}
+	double sumSq = 0.0;
+	for (int z = 0; z < n; z++)
+	{
+		for (int y = 0; y < n; y++)
+		{
+			for (int x = 0; x < n; x++)
+			{
+				float dPzdy = at(2, x, y + 1, z) - at(2, x, y - 1, z);
+				float dPydz = at(1, x, y, z + 1) - at(1, x, y, z - 1);
+				float dPxdz = at(0, x, y, z + 1) - at(0, x, y, z - 1);
+				float dPzdx = at(2, x + 1, y, z) - at(2, x - 1, y, z);
+				float dPydx = at(1, x + 1, y, z) - at(1, x - 1, y, z);
+				float dPxdy = at(0, x, y + 1, z) - at(0, x, y - 1, z);
+
+				size_t i = ((size_t)z * n + y) * n + x;
+				curl[0][i] = dPzdy - dPydz;
+				curl[1][i] = dPxdz - dPzdx;
+				curl[2][i] = dPydx - dPxdy;
+				sumSq += (double)curl[0][i] * curl[0][i] + (double)curl[1][i] * curl[1][i] + (double)curl[2][i] * curl[2][i];
+			}
+		}
+	}
+
+	//scale to an RMS length of 1 so strength means the same at every quality
+	float scale = sumSq > 0.0 ? (float)(1.0 / std::sqrt(sumSq / ((double)n * n * n))) : 0.0f;
+	for (int c = 0; c < 3; c++)
+	{
+		for (float& v : curl[c])
+		{
+			v *= scale;
+		}
+	}
+
+	resolution = n;
+	Pad(curl[0], curl[1], curl[2]);
+}
+
+void ParticleNoiseVolume::Pad(const std::vector<float>& x, const std::vector<float>& y, const std::vector<float>& z)
+{
+	const int n = resolution;
+	const int p = n + 1;
+	fieldX.resize((size_t)p * p * p);
+	fieldY.resize((size_t)p * p * p);
+	fieldZ.resize((size_t)p * p * p);
+	for (int k = 0; k < p; k++)
+	{
+		for (int j = 0; j < p; j++)
+		{
+			for (int i = 0; i < p; i++)
+			{
+				size_t from = ((size_t)(k % n) * n + (j % n)) * n + (i % n);
+				size_t to = ((size_t)k * p + j) * p + i;
+				fieldX[to] = x[from];
+				fieldY[to] = y[from];
+				fieldZ[to] = z[from];
+			}
+		}
+	}
+}
+
+bool ParticleNoiseVolume::Load(const char* path, NoiseQuality quality, unsigned int seed)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return false;
+
+	char magic[4] = {};
+	int fileResolution = 0;
+	unsigned int fileSeed = 0;
+	bool ok = fread(magic, 1, 4, file) == 4 && fread(&fileResolution, sizeof(int), 1, file) == 1 &&
+		fread(&fileSeed, sizeof(unsigned int), 1, file) == 1;
+	ok = ok && magic[0] == cacheMagic[0] && magic[1] == cacheMagic[1] && magic[2] == cacheMagic[2] && magic[3] == cacheMagic[3];
+	ok = ok && fileResolution == (int)quality && fileSeed == seed;
+
+	//the file holds the unpadded grid
+	size_t cells = (size_t)fileResolution * fileResolution * fileResolution;
+	std::vector<float> x, y, z;
+	if (ok)
+	{
+		x.resize(cells);
+		y.resize(cells);
+		z.resize(cells);
+		ok = fread(x.data(), sizeof(float), cells, file) == cells && fread(y.data(), sizeof(float), cells, file) == cells &&
+			fread(z.data(), sizeof(float), cells, file) == cells;
+	}
+	fclose(file);
+	if (!ok)
+		return false;
+
+	resolution = fileResolution;
+	this->seed = seed;
+	Pad(x, y, z);
+	return true;
+}
+
+bool ParticleNoiseVolume::Save(const char* path) const
+{
+	if (resolution == 0)
+		return false;
+
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		return false;
+
+	const int n = resolution;
+	const int p = n + 1;
+	std::vector<float> x((size_t)n * n * n), y((size_t)n * n * n), z((size_t)n * n * n);
+	for (int k = 0; k < n; k++)
+	{
+		for (int j = 0; j < n; j++)
+		{
+			for (int i = 0; i < n; i++)
+			{
+				size_t from = ((size_t)k * p + j) * p + i;
+				size_t to = ((size_t)k * n + j) * n + i;
+				x[to] = fieldX[from];
+				y[to] = fieldY[from];
+				z[to] = fieldZ[from];
+			}
+		}
+	}
+
+	bool ok = fwrite(cacheMagic, 1, 4, file) == 4 && fwrite(&resolution, sizeof(int), 1, file) == 1 &&
+		fwrite(&seed, sizeof(unsigned int), 1, file) == 1 && fwrite(x.data(), sizeof(float), x.size(), file) == x.size() &&
+		fwrite(y.data(), sizeof(float), y.size(), file) == y.size() && fwrite(z.data(), sizeof(float), z.size(), file) == z.size();
+	fclose(file);
+	return ok;
+}
+
+void ParticleNoiseVolume::LoadOrGenerate(const char* path, NoiseQuality quality, unsigned int seed)
+{
+	if (Load(path, quality, seed))
+		return;
+
+	Generate(quality, seed);
+	//a failed write only means the next start generates again
+	Save(path);
+}
+
+Float3 ParticleNoiseVolume::Sample(Float3 p) const
+{
+	const float n = (float)resolution;
+	const int stride = resolution + 1;
+	float coords[3] = { p.x, p.y, p.z };
+	int cell[3];
+	float frac[3];
+	for (int a = 0; a < 3; a++)
+	{
+		//wrap into [0, n), the min guards rounding up to n
+		float c = coords[a] - std::floor(coords[a] * (1.0f / n)) * n;
+		float i = std::floor(c);
+		i = i < n - 1.0f ? i : n - 1.0f;
+		cell[a] = (int)i;
+		frac[a] = c - i;
+	}
+
+	const std::vector<float>* fields[3] = { &fieldX, &fieldY, &fieldZ };
+	float result[3];
+	size_t base = ((size_t)cell[2] * stride + cell[1]) * stride + cell[0];
+	for (int f = 0; f < 3; f++)
+	{
+		const float* v = fields[f]->data();
+		//x pairs along the 4 yz corners, then y, then z, same order as the SIMD path
+		float c00 = (v[base + 1] - v[base]) * frac[0] + v[base];
+		float c10 = (v[base + stride + 1] - v[base + stride]) * frac[0] + v[base + stride];
+		float c01 = (v[base + stride * stride + 1] - v[base + stride * stride]) * frac[0] + v[base + stride * stride];
+		float c11 = (v[base + stride * stride + stride + 1] - v[base + stride * stride + stride]) * frac[0] + v[base + stride * stride + stride];
+		float c0 = (c10 - c00) * frac[1] + c00;
+		float c1 = (c11 - c01) * frac[1] + c01;
+		result[f] = (c1 - c0) * frac[2] + c0;
+	}
+	return Float3{ result[0], result[1], result[2] };
+}
+
+void ParticleNoiseVolume::Sample(SimdFloat px, SimdFloat py, SimdFloat pz, SimdFloat& vx, SimdFloat& vy, SimdFloat& vz) const
+{
+	const SimdFloat n = SimdSet1((float)resolution);
+	const SimdFloat invN = SimdSet1(1.0f / resolution);
+	const SimdFloat maxCell = SimdSet1((float)resolution - 1.0f);
+	const SimdFloat stride = SimdSet1((float)(resolution + 1));
+
+	SimdFloat coords[3] = { px, py, pz };
+	SimdFloat cell[3];
+	SimdFloat frac[3];
+	for (int a = 0; a < 3; a++)
+	{
+		SimdFloat c = SimdSub(coords[a], SimdMul(SimdFloor(SimdMul(coords[a], invN)), n));
+		SimdFloat i = SimdMin(SimdFloor(c), maxCell);
+		cell[a] = i;
+		frac[a] = SimdSub(c, i);
+	}
+
+	//flat index as a float, exact since the padded grid has fewer than 2^24 cells
+	SimdFloat base = SimdAdd(SimdMul(SimdAdd(SimdMul(cell[2], stride), cell[1]), stride), cell[0]);
+	SimdFloat strideZ = SimdMul(stride, stride);
+
+	const float* fields[3] = { fieldX.data(), fieldY.data(), fieldZ.data() };
+	SimdFloat result[3];
+	for (int f = 0; f < 3; f++)
+	{
+		result[f] = SimdSampleTrilinear(fields[f], base, stride, strideZ, frac[0], frac[1], frac[2]);
+	}
+	vx = result[0];
+	vy = result[1];
+	vz = result[2];
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include"ParticleMath.h"
+#include"ParticleSimd.h"
+#include<vector>
+
+//volume resolution per axis, memory is 3 floats per cell: 16^3 ~59 KB, 32^3 ~431 KB, 64^3 ~3.3 MB
+enum class NoiseQuality
+{
+	Low = 16,
+	Medium = 32,
+	High = 64
+};
+
+//Tileable, divergence free (curl of a periodic noise potential) velocity field on a cubic grid.
+//Generated once, or loaded from a cache file, then sampled with trilinear interpolation that wraps every
+//GetResolution() cells. The grid is stored with one extra wrapped layer per axis so a sample never wraps mid lookup.
+class ParticleNoiseVolume
+{
+public:
+	ParticleNoiseVolume();
+
+	//build the field, about one noise feature per 8 cells, the same seed and quality always give the same field
+	void Generate(NoiseQuality quality, unsigned int seed);
+	//binary cache, false when the file is missing or was made for a different quality / seed
+	bool Load(const char* path, NoiseQuality quality, unsigned int seed);
+	bool Save(const char* path) const;
+	//load the cache, or generate and write it when it is missing or stale
+	void LoadOrGenerate(const char* path, NoiseQuality quality, unsigned int seed);
+
+	int GetResolution() const { return resolution; }
+	size_t GetMemoryBytes() const { return (fieldX.size() + fieldY.size() + fieldZ.size()) * sizeof(float); }
+
+	//field at p in cell units, wraps in every direction, roughly unit length on average
+	Float3 Sample(Float3 p) const;
+	//same as Sample per lane, bit for bit
+	void Sample(SimdFloat px, SimdFloat py, SimdFloat pz, SimdFloat& vx, SimdFloat& vy, SimdFloat& vz) const;
+
+private:
+	int resolution;
+	unsigned int seed;
+	//(resolution + 1)^3 padded grid, x fastest
+	std::vector<float> fieldX;
+	std::vector<float> fieldY;
+	std::vector<float> fieldZ;
+
+	void Pad(const std::vector<float>& x, const std::vector<float>& y, const std::vector<float>& z);
+};
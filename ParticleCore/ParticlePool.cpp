@@ -0,0 +1,122 @@
+#include "ParticlePool.h"
+
+ParticlePool::ParticlePool(int maxParticleCount)
+	: data(maxParticleCount), maxCount(maxParticleCount), aliveCount(0), storage(ParticleStorage::Compact), tail(0)
+{
+}
+
+void ParticlePool::SetStorage(ParticleStorage storage)
+{
+	//analytic storage keeps only the records, the others only the streams
+	bool analytic = storage == ParticleStorage::Analytic;
+	if (analytic != (this->storage == ParticleStorage::Analytic))
+	{
+		data.Reallocate(analytic ? 0 : maxCount);
+		std::vector<float>(analytic ? maxCount : 0).swap(spawnTimes);
+		std::vector<unsigned int>(analytic ? maxCount : 0).swap(seeds);
+	}
+	this->storage = storage;
+	Clear();
+}
+
+size_t ParticlePool::GetMemoryBytes() const
+{
+	return (size_t)data.GetCapacity() * ParticleData::StreamCount * sizeof(float) + spawnTimes.capacity() * sizeof(float) +
+		seeds.capacity() * sizeof(unsigned int);
+}
+
+void ParticlePool::Clear()
+{
+	aliveCount = 0;
+	tail = 0;
+}
+
+int ParticlePool::GetSpans(ParticleSpan spans[2]) const
+{
+	if (aliveCount == 0)
+		return 0;
+
+	int end = tail + aliveCount;
+	if (end <= maxCount)
+	{
+		spans[0] = { tail, aliveCount };
+		return 1;
+	}
+	spans[0] = { tail, maxCount - tail };
+	spans[1] = { 0, end - maxCount };
+	return 2;
+}
+
+int ParticlePool::Spawn(int count, int& first)
+{
+	first = tail + aliveCount;
+	if (first >= maxCount)
+		first -= maxCount;
+
+	int spawned = count < GetDeadCount() ? count : GetDeadCount();
+	//a ring hands out slots up to its end, the rest come from its start on the next call
+	if (storage != ParticleStorage::Compact && spawned > maxCount - first)
+		spawned = maxCount - first;
+	if (spawned < 0)
+		spawned = 0;
+
+	aliveCount += spawned;
+	return spawned;
+}
+
+void ParticlePool::Kill(int index)
+{
+	aliveCount--;
+	if (index != aliveCount)
+		data.MoveParticle(aliveCount, index);
+}
+
+int ParticlePool::KillExpired(float lifetime)
+{
+	int killed = 0;
+	if (storage == ParticleStorage::Ring)
+	{
+		//ages fall from tail to head, so the expired particles are a run at the tail
+		while (aliveCount > 0 && data.Age[tail] >= lifetime)
+		{
+			tail = tail + 1 < maxCount ? tail + 1 : 0;
+			aliveCount--;
+			killed++;
+		}
+		//start over at slot 0 once empty, so a burst gets a single span
+		if (aliveCount == 0)
+			tail = 0;
+		return killed;
+	}
+
+	//the compact pool checks every particle
+	int i = 0;
+	while (i < aliveCount)
+	{
+		if (data.Age[i] >= lifetime)
+		{
+			//index i now holds the old last particle, check it again
+			Kill(i);
+			killed++;
+		}
+		else
+		{
+			i++;
+		}
+	}
+	return killed;
+}
+
+int ParticlePool::KillExpiredAt(float lifetime, float now)
+{
+	int killed = 0;
+	while (aliveCount > 0 && now - spawnTimes[tail] >= lifetime)
+	{
+		tail = tail + 1 < maxCount ? tail + 1 : 0;
+		aliveCount--;
+		killed++;
+	}
+	if (aliveCount == 0)
+		tail = 0;
+	return killed;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include"ParticleData.h"
+#include<cstddef>
+#include<vector>
+
+//how the pool lays out the live particles in the streams
+enum class ParticleStorage
+{
+	//packed into [0, aliveCount), works for any mix of lifetimes
+	Compact,
+	//FIFO ring in spawn order, only valid when every particle has the same lifetime so they die in the order they were born
+	Ring,
+	//ring order with only a spawn time and a seed per particle (8 bytes instead of a slot in every stream), the
+	//particle streams are freed. For force free emitters, see ParticleSimulation::SetStorage
+	Analytic
+};
+
+//Alive/dead bookkeeping over the SoA streams
+//Compact: live particles are always packed into [0, aliveCount), so kernels and draws only ever touch live ones.
+//The dead index stack is the tail [aliveCount, maxCount): spawning pops from it by growing aliveCount,
+//and a death swaps the last live particle into the hole, so both are O(1).
+//Ring: live particles are [tail, tail + aliveCount) modulo maxCount, oldest first. A death advances the tail, a birth the
+//head, nothing moves and only the oldest particles are ever checked. The live range is one span, or two once it wraps.
+//Analytic: the ring over spawn time and seed records instead of the streams.
+class ParticlePool
+{
+public:
+	ParticlePool(int maxParticleCount);
+
+	ParticleData& GetData() { return data; }
+	const ParticleData& GetData() const { return data; }
+
+	int GetMaxCount() const { return maxCount; }
+	int GetAliveCount() const { return aliveCount; }
+	int GetDeadCount() const { return maxCount - aliveCount; }
+
+	//switching kills every particle
+	void SetStorage(ParticleStorage storage);
+	ParticleStorage GetStorage() const { return storage; }
+	//slot ranges of the live particles, oldest first for ring storage, returns how many of the 2 are used
+	int GetSpans(ParticleSpan spans[2]) const;
+
+	//claim up to count dead slots, the new particles are [first, first + returned count).
+	//A ring returns fewer than are dead when the head wraps, spawn again for the rest
+	int Spawn(int count, int& first);
+	//swap remove, the last live particle moves into index. Compact storage only
+	void Kill(int index);
+	//kill every particle with age >= lifetime, returns how many died. Compact and ring storage, they keep ages
+	int KillExpired(float lifetime);
+	//analytic storage: kill every particle with now - spawn time >= lifetime, returns how many died
+	int KillExpiredAt(float lifetime, float now);
+	//kill every particle
+	void Clear();
+
+	//analytic storage records, indexed by slot like the streams
+	float* GetSpawnTimes() { return spawnTimes.data(); }
+	const float* GetSpawnTimes() const { return spawnTimes.data(); }
+	unsigned int* GetSeeds() { return seeds.data(); }
+	const unsigned int* GetSeeds() const { return seeds.data(); }
+
+	//bytes held for particle state, streams and records
+	size_t GetMemoryBytes() const;
+
+private:
+	ParticleData data;
+	int maxCount;
+	int aliveCount;
+	ParticleStorage storage;
+	//slot of the oldest particle, always 0 for compact storage
+	int tail;
+	std::vector<float> spawnTimes;
+	std::vector<unsigned int> seeds;
+};
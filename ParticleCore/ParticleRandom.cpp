@@ -0,0 +1,71 @@
+#include "ParticleRandom.h"
+#include "ParticleKernels.h"
+#include <cmath>
+
+//The streams are filled by the dispatched kernels (ParticleKernelVariant.h), SIMD at the width the cpu runs.
+//Values each call consumes from the counter:
+//  Uniform   count, value counter + i for out[i]
+//  Normal    count rounded up to even, pair p from counter + 2p and counter + 2p + 1
+//  InSphere  3 count, radius from counter + i, azimuth from counter + count + i, height from counter + 2 count + i
+//  InCone    2 count, polar angle from counter + i, azimuth from counter + count + i
+
+namespace
+{
+	//lowbias32 integer hash (Wellons), fixed shifts so it vectorizes without variable shift instructions.
+	//Value n of a stream is Hash(Hash(n) ^ key), see SimdRandomUnit
+	inline unsigned int Hash(unsigned int x)
+	{
+		x ^= x >> 16;
+		x *= 0x7feb352du;
+		x ^= x >> 15;
+		x *= 0x846ca68bu;
+		x ^= x >> 16;
+		return x;
+	}
+}
+
+ParticleRandom::ParticleRandom(unsigned int seed)
+{
+	SetSeed(seed);
+}
+
+void ParticleRandom::SetSeed(unsigned int seed)
+{
+	this->seed = seed;
+	key = Hash(seed ^ 0x9e3779b9u);
+	counter = 0;
+}
+
+void ParticleRandom::Uniform(float* out, int count)
+{
+	GetParticleKernels().RandomUniform(key, counter, out, count, 0.0f, 1.0f);
+	counter += (unsigned int)count;
+}
+
+void ParticleRandom::Uniform(float* out, int count, float min, float max)
+{
+	GetParticleKernels().RandomUniform(key, counter, out, count, min, max - min);
+	counter += (unsigned int)count;
+}
+
+void ParticleRandom::Normal(float* out, int count, float mean, float standardDeviation)
+{
+	//an odd count draws one extra pair and drops its second gaussian
+	GetParticleKernels().RandomNormal(key, counter, out, count, mean, standardDeviation);
+	counter += (unsigned int)((count + 1) & ~1);
+}
+
+void ParticleRandom::InSphere(float* x, float* y, float* z, int count, float radius)
+{
+	GetParticleKernels().RandomInSphere(key, counter, x, y, z, count, radius);
+	counter += 3u * (unsigned int)count;
+}
+
+void ParticleRandom::InCone(float* x, float* y, float* z, int count, Float3 axis, float halfAngle)
+{
+	Float3 tangent, bitangent;
+	MakeOrthonormalBasis(axis, tangent, bitangent);
+
+	GetParticleKernels().RandomInCone(key, counter, x, y, z, count, axis, tangent, bitangent, std::cos(halfAngle));
+	counter += 2u * (unsigned int)count;
+}
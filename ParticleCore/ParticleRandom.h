@@ -0,0 +1,35 @@
+#pragma once
+
+#include"ParticleMath.h"
+
+//Counter based random numbers for emission and per particle variation.
+//Value n of a generator is a pure function of (seed, n), so streams and the distributions built on them are filled in
+//SIMD batches by the dispatched kernels (see ParticleKernels.h), and every instruction set produces the same bits.
+//Each call consumes its values from the counter, so the same calls in the same order replay exactly.
+class ParticleRandom
+{
+public:
+	ParticleRandom(unsigned int seed = 0);
+
+	//restart the sequence of a new seed
+	void SetSeed(unsigned int seed);
+	unsigned int GetSeed() const { return seed; }
+	//values consumed so far, wraps after 2^32
+	unsigned int GetCounter() const { return counter; }
+
+	//count floats in [0, 1), 24 bits of precision
+	void Uniform(float* out, int count);
+	//count floats in [min, max)
+	void Uniform(float* out, int count, float min, float max);
+	//count gaussian floats (Box-Muller)
+	void Normal(float* out, int count, float mean, float standardDeviation);
+	//count points uniformly distributed inside a sphere of radius around the origin, written as SoA
+	void InSphere(float* x, float* y, float* z, int count, float radius);
+	//count unit directions uniformly distributed inside a cone of halfAngle radians around axis (unit length)
+	void InCone(float* x, float* y, float* z, int count, Float3 axis, float halfAngle);
+
+private:
+	unsigned int seed;
+	unsigned int key;
+	unsigned int counter;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include"ParticleAffectors.h"
+#include"ParticleBvh.h"
+#include<memory>
+
+//collision with static scene triangles: the step from p - v * dt to p is tested against the BVH, particles that
+//crossed a surface are put back just in front of it and bounce like GroundBounceAffector
+struct SceneCollisionAffector : ParticleAffector
+{
+	std::shared_ptr<const ParticleBvh> bvh;
+	float restitution;
+	float friction;
+
+	SceneCollisionAffector(std::shared_ptr<const ParticleBvh> bvh, float restitution, float friction)
+		: bvh(bvh), restitution(restitution), friction(friction) {}
+
+	void Constrain(ParticleLanes& lanes, SimdFloat dt) const
+	{
+		//distance kept from the surface, so the next step does not start on it
+		const float skin = 0.002f;
+
+		alignas(64) float lane[9][PARTICLE_SIMD_WIDTH];
+		SimdStore(lane[0], SimdSub(lanes.positionX, SimdMul(lanes.velocityX, dt)));
+		SimdStore(lane[1], SimdSub(lanes.positionY, SimdMul(lanes.velocityY, dt)));
+		SimdStore(lane[2], SimdSub(lanes.positionZ, SimdMul(lanes.velocityZ, dt)));
+		SimdStore(lane[3], lanes.positionX);
+		SimdStore(lane[4], lanes.positionY);
+		SimdStore(lane[5], lanes.positionZ);
+
+		ParticleBvhHit hits[PARTICLE_SIMD_WIDTH];
+		bvh->IntersectSegments(lane[0], lane[1], lane[2], lane[3], lane[4], lane[5], PARTICLE_SIMD_WIDTH, hits);
+		bool anyHit = false;
+		for (int l = 0; l < PARTICLE_SIMD_WIDTH; l++)
+		{
+			anyHit = anyHit || hits[l].hit;
+		}
+		if (!anyHit)
+			return;
+
+		SimdStore(lane[6], lanes.velocityX);
+		SimdStore(lane[7], lanes.velocityY);
+		SimdStore(lane[8], lanes.velocityZ);
+		for (int l = 0; l < PARTICLE_SIMD_WIDTH; l++)
+		{
+			if (!hits[l].hit)
+				continue;
+
+			Float3 n = hits[l].normal;
+			lane[3][l] = hits[l].point.x + n.x * skin;
+			lane[4][l] = hits[l].point.y + n.y * skin;
+			lane[5][l] = hits[l].point.z + n.z * skin;
+
+			//the normal faces the side the particle came from, so vn < 0 is moving into the surface
+			float vn = lane[6][l] * n.x + lane[7][l] * n.y + lane[8][l] * n.z;
+			if (vn < 0.0f)
+			{
+				float slide = 1.0f - friction;
+				lane[6][l] = (lane[6][l] - vn * n.x) * slide - restitution * vn * n.x;
+				lane[7][l] = (lane[7][l] - vn * n.y) * slide - restitution * vn * n.y;
+				lane[8][l] = (lane[8][l] - vn * n.z) * slide - restitution * vn * n.z;
+			}
+		}
+		lanes.positionX = SimdLoad(lane[3]);
+		lanes.positionY = SimdLoad(lane[4]);
+		lanes.positionZ = SimdLoad(lane[5]);
+		lanes.velocityX = SimdLoad(lane[6]);
+		lanes.velocityY = SimdLoad(lane[7]);
+		lanes.velocityZ = SimdLoad(lane[8]);
+	}
+};
@@ -0,0 +1,401 @@
+#pragma once
+
+//Thin wrapper over the widest float SIMD the compiler targets,
+//AVX-512 (16 wide) with /arch:AVX512 or -mavx512f, AVX (8 wide) with /arch:AVX or -mavx, SSE (4 wide) otherwise.
+//Multiply and add are kept as separate ops (no FMA) so every width gives the same bits.
+//Everything has internal linkage: the dispatched kernels compile this header at several widths into one binary
+//(see ParticleKernelVariant.h), and one shared inline definition would let the linker pick a single width for all.
+
+#if defined(__SSE4_1__) && !defined(PARTICLE_SIMD_SSE41)
+//MSVC has no SSE4.1 switch, the SSE4.1 kernel file defines this itself
+#define PARTICLE_SIMD_SSE41
+#endif
+
+#if defined(__AVX512F__)
+
+#include <immintrin.h>
+
+#define PARTICLE_SIMD_WIDTH 16
+
+typedef __m512 SimdFloat;
+
+//lanes whose sign bit is set, the compares below write all bits, like the narrower widths
+static inline __mmask16 SimdSignBits(SimdFloat a) { return _mm512_cmplt_epi32_mask(_mm512_castps_si512(a), _mm512_setzero_si512()); }
+
+static inline SimdFloat SimdLoad(const float* p) { return _mm512_load_ps(p); }
+static inline SimdFloat SimdLoadUnaligned(const float* p) { return _mm512_loadu_ps(p); }
+static inline void SimdStore(float* p, SimdFloat v) { _mm512_store_ps(p, v); }
+static inline void SimdStoreUnaligned(float* p, SimdFloat v) { _mm512_storeu_ps(p, v); }
+static inline SimdFloat SimdSet1(float f) { return _mm512_set1_ps(f); }
+static inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b) { return _mm512_add_ps(a, b); }
+static inline SimdFloat SimdSub(SimdFloat a, SimdFloat b) { return _mm512_sub_ps(a, b); }
+static inline SimdFloat SimdMul(SimdFloat a, SimdFloat b) { return _mm512_mul_ps(a, b); }
+static inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b) { return _mm512_div_ps(a, b); }
+static inline SimdFloat SimdSqrt(SimdFloat a) { return _mm512_sqrt_ps(a); }
+static inline SimdFloat SimdMin(SimdFloat a, SimdFloat b) { return _mm512_min_ps(a, b); }
+static inline SimdFloat SimdMax(SimdFloat a, SimdFloat b) { return _mm512_max_ps(a, b); }
+//all bits set in lanes where a < b
+static inline SimdFloat SimdLess(SimdFloat a, SimdFloat b)
+{
+	return _mm512_castsi512_ps(_mm512_maskz_set1_epi32(_mm512_cmp_ps_mask(a, b, _CMP_LT_OQ), -1));
+}
+//a in lanes where mask is set, b elsewhere
+static inline SimdFloat SimdSelect(SimdFloat mask, SimdFloat a, SimdFloat b) { return _mm512_mask_blend_ps(SimdSignBits(mask), b, a); }
+//bit l set when lane l of mask is set
+static inline int SimdMoveMask(SimdFloat mask) { return (int)SimdSignBits(mask); }
+//lanes truncated towards zero, as floats
+static inline SimdFloat SimdTruncate(SimdFloat a) { return _mm512_cvtepi32_ps(_mm512_cvttps_epi32(a)); }
+
+//table[index] and table[index + 1] per lane, index holds whole numbers
+static inline void SimdGatherPair(const float* table, SimdFloat index, SimdFloat& a, SimdFloat& b)
+{
+	__m512i i = _mm512_cvttps_epi32(index);
+	a = _mm512_i32gather_ps(i, table, 4);
+	b = _mm512_i32gather_ps(i, table + 1, 4);
+}
+
+//32 bit integer lanes, for bit patterns and counters. Add and Mul wrap, shifts are logical
+typedef __m512i SimdInt;
+
+static inline SimdInt SimdIntSet1(int i) { return _mm512_set1_epi32(i); }
+//0, 1, 2, ... in lane order
+static inline SimdInt SimdIntLanes() { return _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15); }
+static inline SimdInt SimdIntAdd(SimdInt a, SimdInt b) { return _mm512_add_epi32(a, b); }
+static inline SimdInt SimdIntMul(SimdInt a, SimdInt b) { return _mm512_mullo_epi32(a, b); }
+static inline SimdInt SimdIntAnd(SimdInt a, SimdInt b) { return _mm512_and_si512(a, b); }
+static inline SimdInt SimdIntOr(SimdInt a, SimdInt b) { return _mm512_or_si512(a, b); }
+static inline SimdInt SimdIntXor(SimdInt a, SimdInt b) { return _mm512_xor_si512(a, b); }
+template<int bits> static inline SimdInt SimdIntShiftRight(SimdInt a) { return _mm512_srli_epi32(a, bits); }
+template<int bits> static inline SimdInt SimdIntShiftLeft(SimdInt a) { return _mm512_slli_epi32(a, bits); }
+static inline SimdFloat SimdIntToFloat(SimdInt a) { return _mm512_cvtepi32_ps(a); }
+//truncated towards zero
+static inline SimdInt SimdFloatToInt(SimdFloat a) { return _mm512_cvttps_epi32(a); }
+//the same bits reinterpreted
+static inline SimdFloat SimdIntAsFloat(SimdInt a) { return _mm512_castsi512_ps(a); }
+static inline SimdInt SimdFloatAsInt(SimdFloat a) { return _mm512_castps_si512(a); }
+
+#elif defined(__AVX__)
+
+#include <immintrin.h>
+
+#define PARTICLE_SIMD_WIDTH 8
+
+typedef __m256 SimdFloat;
+
+static inline SimdFloat SimdLoad(const float* p) { return _mm256_load_ps(p); }
+static inline SimdFloat SimdLoadUnaligned(const float* p) { return _mm256_loadu_ps(p); }
+static inline void SimdStore(float* p, SimdFloat v) { _mm256_store_ps(p, v); }
+static inline void SimdStoreUnaligned(float* p, SimdFloat v) { _mm256_storeu_ps(p, v); }
+static inline SimdFloat SimdSet1(float f) { return _mm256_set1_ps(f); }
+static inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b) { return _mm256_add_ps(a, b); }
+static inline SimdFloat SimdSub(SimdFloat a, SimdFloat b) { return _mm256_sub_ps(a, b); }
+static inline SimdFloat SimdMul(SimdFloat a, SimdFloat b) { return _mm256_mul_ps(a, b); }
+static inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b) { return _mm256_div_ps(a, b); }
+static inline SimdFloat SimdSqrt(SimdFloat a) { return _mm256_sqrt_ps(a); }
+static inline SimdFloat SimdMin(SimdFloat a, SimdFloat b) { return _mm256_min_ps(a, b); }
+static inline SimdFloat SimdMax(SimdFloat a, SimdFloat b) { return _mm256_max_ps(a, b); }
+//all bits set in lanes where a < b
+static inline SimdFloat SimdLess(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+//a in lanes where mask is set, b elsewhere
+static inline SimdFloat SimdSelect(SimdFloat mask, SimdFloat a, SimdFloat b) { return _mm256_blendv_ps(b, a, mask); }
+//bit l set when lane l of mask is set
+static inline int SimdMoveMask(SimdFloat mask) { return _mm256_movemask_ps(mask); }
+//lanes truncated towards zero, as floats
+static inline SimdFloat SimdTruncate(SimdFloat a) { return _mm256_cvtepi32_ps(_mm256_cvttps_epi32(a)); }
+
+//table[index] and table[index + 1] per lane, index holds whole numbers
+static inline void SimdGatherPair(const float* table, SimdFloat index, SimdFloat& a, SimdFloat& b)
+{
+	__m256i i = _mm256_cvttps_epi32(index);
+#if defined(__AVX2__)
+	a = _mm256_i32gather_ps(table, i, 4);
+	b = _mm256_i32gather_ps(table + 1, i, 4);
+#else
+	alignas(32) int lanes[8];
+	alignas(32) float va[8];
+	alignas(32) float vb[8];
+	_mm256_store_si256((__m256i*)lanes, i);
+	for (int l = 0; l < 8; l++)
+	{
+		va[l] = table[lanes[l]];
+		vb[l] = table[lanes[l] + 1];
+	}
+	a = _mm256_load_ps(va);
+	b = _mm256_load_ps(vb);
+#endif
+}
+
+//32 bit integer lanes, for bit patterns and counters. Add and Mul wrap, shifts are logical
+typedef __m256i SimdInt;
+
+static inline SimdInt SimdIntSet1(int i) { return _mm256_set1_epi32(i); }
+//0, 1, 2, ... in lane order
+static inline SimdInt SimdIntLanes() { return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7); }
+#if defined(__AVX2__)
+static inline SimdInt SimdIntAdd(SimdInt a, SimdInt b) { return _mm256_add_epi32(a, b); }
+static inline SimdInt SimdIntMul(SimdInt a, SimdInt b) { return _mm256_mullo_epi32(a, b); }
+static inline SimdInt SimdIntAnd(SimdInt a, SimdInt b) { return _mm256_and_si256(a, b); }
+static inline SimdInt SimdIntOr(SimdInt a, SimdInt b) { return _mm256_or_si256(a, b); }
+static inline SimdInt SimdIntXor(SimdInt a, SimdInt b) { return _mm256_xor_si256(a, b); }
+template<int bits> static inline SimdInt SimdIntShiftRight(SimdInt a) { return _mm256_srli_epi32(a, bits); }
+template<int bits> static inline SimdInt SimdIntShiftLeft(SimdInt a) { return _mm256_slli_epi32(a, bits); }
+#else
+//AVX has no 256 bit integer ops, each half goes through SSE4.1
+static inline __m128i SimdIntLow(SimdInt a) { return _mm256_castsi256_si128(a); }
+static inline __m128i SimdIntHigh(SimdInt a) { return _mm256_extractf128_si256(a, 1); }
+static inline SimdInt SimdIntJoin(__m128i low, __m128i high) { return _mm256_insertf128_si256(_mm256_castsi128_si256(low), high, 1); }
+static inline SimdInt SimdIntAdd(SimdInt a, SimdInt b)
+{
+	return SimdIntJoin(_mm_add_epi32(SimdIntLow(a), SimdIntLow(b)), _mm_add_epi32(SimdIntHigh(a), SimdIntHigh(b)));
+}
+static inline SimdInt SimdIntMul(SimdInt a, SimdInt b)
+{
+	return SimdIntJoin(_mm_mullo_epi32(SimdIntLow(a), SimdIntLow(b)), _mm_mullo_epi32(SimdIntHigh(a), SimdIntHigh(b)));
+}
+static inline SimdInt SimdIntAnd(SimdInt a, SimdInt b) { return _mm256_castps_si256(_mm256_and_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b))); }
+static inline SimdInt SimdIntOr(SimdInt a, SimdInt b) { return _mm256_castps_si256(_mm256_or_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b))); }
+static inline SimdInt SimdIntXor(SimdInt a, SimdInt b) { return _mm256_castps_si256(_mm256_xor_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b))); }
+template<int bits> static inline SimdInt SimdIntShiftRight(SimdInt a)
+{
+	return SimdIntJoin(_mm_srli_epi32(SimdIntLow(a), bits), _mm_srli_epi32(SimdIntHigh(a), bits));
+}
+template<int bits> static inline SimdInt SimdIntShiftLeft(SimdInt a)
+{
+	return SimdIntJoin(_mm_slli_epi32(SimdIntLow(a), bits), _mm_slli_epi32(SimdIntHigh(a), bits));
+}
+#endif
+static inline SimdFloat SimdIntToFloat(SimdInt a) { return _mm256_cvtepi32_ps(a); }
+//truncated towards zero
+static inline SimdInt SimdFloatToInt(SimdFloat a) { return _mm256_cvttps_epi32(a); }
+//the same bits reinterpreted
+static inline SimdFloat SimdIntAsFloat(SimdInt a) { return _mm256_castsi256_ps(a); }
+static inline SimdInt SimdFloatAsInt(SimdFloat a) { return _mm256_castps_si256(a); }
+
+#else
+
+#if defined(PARTICLE_SIMD_SSE41)
+#include <smmintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+#define PARTICLE_SIMD_WIDTH 4
+
+typedef __m128 SimdFloat;
+
+static inline SimdFloat SimdLoad(const float* p) { return _mm_load_ps(p); }
+static inline SimdFloat SimdLoadUnaligned(const float* p) { return _mm_loadu_ps(p); }
+static inline void SimdStore(float* p, SimdFloat v) { _mm_store_ps(p, v); }
+static inline void SimdStoreUnaligned(float* p, SimdFloat v) { _mm_storeu_ps(p, v); }
+static inline SimdFloat SimdSet1(float f) { return _mm_set1_ps(f); }
+static inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b) { return _mm_add_ps(a, b); }
+static inline SimdFloat SimdSub(SimdFloat a, SimdFloat b) { return _mm_sub_ps(a, b); }
+static inline SimdFloat SimdMul(SimdFloat a, SimdFloat b) { return _mm_mul_ps(a, b); }
+static inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b) { return _mm_div_ps(a, b); }
+static inline SimdFloat SimdSqrt(SimdFloat a) { return _mm_sqrt_ps(a); }
+static inline SimdFloat SimdMin(SimdFloat a, SimdFloat b) { return _mm_min_ps(a, b); }
+static inline SimdFloat SimdMax(SimdFloat a, SimdFloat b) { return _mm_max_ps(a, b); }
+//all bits set in lanes where a < b
+static inline SimdFloat SimdLess(SimdFloat a, SimdFloat b) { return _mm_cmplt_ps(a, b); }
+//a in lanes where mask is set, b elsewhere (SSE2 has no blendv)
+#if defined(PARTICLE_SIMD_SSE41)
+static inline SimdFloat SimdSelect(SimdFloat mask, SimdFloat a, SimdFloat b) { return _mm_blendv_ps(b, a, mask); }
+#else
+static inline SimdFloat SimdSelect(SimdFloat mask, SimdFloat a, SimdFloat b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+#endif
+//bit l set when lane l of mask is set
+static inline int SimdMoveMask(SimdFloat mask) { return _mm_movemask_ps(mask); }
+//lanes truncated towards zero, as floats
+static inline SimdFloat SimdTruncate(SimdFloat a) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(a)); }
+
+//table[index] and table[index + 1] per lane, index holds whole numbers (no gather before AVX2)
+static inline void SimdGatherPair(const float* table, SimdFloat index, SimdFloat& a, SimdFloat& b)
+{
+	alignas(16) int lanes[4];
+	_mm_store_si128((__m128i*)lanes, _mm_cvttps_epi32(index));
+	a = _mm_setr_ps(table[lanes[0]], table[lanes[1]], table[lanes[2]], table[lanes[3]]);
+	b = _mm_setr_ps(table[lanes[0] + 1], table[lanes[1] + 1], table[lanes[2] + 1], table[lanes[3] + 1]);
+}
+
+//32 bit integer lanes, for bit patterns and counters. Add and Mul wrap, shifts are logical
+typedef __m128i SimdInt;
+
+static inline SimdInt SimdIntSet1(int i) { return _mm_set1_epi32(i); }
+//0, 1, 2, ... in lane order
+static inline SimdInt SimdIntLanes() { return _mm_setr_epi32(0, 1, 2, 3); }
+static inline SimdInt SimdIntAdd(SimdInt a, SimdInt b) { return _mm_add_epi32(a, b); }
+//low 32 bits of the products (SSE2 multiplies even and odd lanes to 64 bits and interleaves the low halves)
+#if defined(PARTICLE_SIMD_SSE41)
+static inline SimdInt SimdIntMul(SimdInt a, SimdInt b) { return _mm_mullo_epi32(a, b); }
+#else
+static inline SimdInt SimdIntMul(SimdInt a, SimdInt b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#endif
+static inline SimdInt SimdIntAnd(SimdInt a, SimdInt b) { return _mm_and_si128(a, b); }
+static inline SimdInt SimdIntOr(SimdInt a, SimdInt b) { return _mm_or_si128(a, b); }
+static inline SimdInt SimdIntXor(SimdInt a, SimdInt b) { return _mm_xor_si128(a, b); }
+template<int bits> static inline SimdInt SimdIntShiftRight(SimdInt a) { return _mm_srli_epi32(a, bits); }
+template<int bits> static inline SimdInt SimdIntShiftLeft(SimdInt a) { return _mm_slli_epi32(a, bits); }
+static inline SimdFloat SimdIntToFloat(SimdInt a) { return _mm_cvtepi32_ps(a); }
+//truncated towards zero
+static inline SimdInt SimdFloatToInt(SimdFloat a) { return _mm_cvttps_epi32(a); }
+//the same bits reinterpreted
+static inline SimdFloat SimdIntAsFloat(SimdInt a) { return _mm_castsi128_ps(a); }
+static inline SimdInt SimdFloatAsInt(SimdFloat a) { return _mm_castps_si128(a); }
+
+#endif
+
+//lanes [0, count) from p and zero past them, for the tail of a run that is not a whole number of batches
+static inline SimdFloat SimdLoadPartial(const float* p, int count)
+{
+	if (count >= PARTICLE_SIMD_WIDTH)
+		return SimdLoadUnaligned(p);
+	alignas(64) float lanes[PARTICLE_SIMD_WIDTH] = {};
+	for (int l = 0; l < count; l++)
+		lanes[l] = p[l];
+	return SimdLoad(lanes);
+}
+//lanes [0, count) of v to p, nothing past them
+static inline void SimdStorePartial(float* p, SimdFloat v, int count)
+{
+	if (count >= PARTICLE_SIMD_WIDTH)
+	{
+		SimdStoreUnaligned(p, v);
+		return;
+	}
+	alignas(64) float lanes[PARTICLE_SIMD_WIDTH];
+	SimdStore(lanes, v);
+	for (int l = 0; l < count; l++)
+		p[l] = lanes[l];
+}
+
+//a * b + c
+static inline SimdFloat SimdMulAdd(SimdFloat a, SimdFloat b, SimdFloat c) { return SimdAdd(SimdMul(a, b), c); }
+//lanes rounded down, as floats (within int range)
+static inline SimdFloat SimdFloor(SimdFloat a)
+{
+	SimdFloat t = SimdTruncate(a);
+	return SimdSelect(SimdLess(a, t), SimdSub(t, SimdSet1(1.0f)), t);
+}
+
+//sine and cosine of each lane, within a few ulp of sinf / cosf for |x| up to a few thousand radians
+//(quarter turn reduction, Cephes polynomials on [-pi / 4, pi / 4]). sin(0) is 0 and cos(0) is 1 exactly
+static inline void SimdSinCos(SimdFloat x, SimdFloat& s, SimdFloat& c)
+{
+	//x = q * pi / 2 + r, pi / 2 split in three parts so r loses no bits
+	SimdFloat q = SimdFloor(SimdMulAdd(x, SimdSet1(0.636619772f), SimdSet1(0.5f)));
+	SimdFloat r = SimdSub(x, SimdMul(q, SimdSet1(1.5703125f)));
+	r = SimdSub(r, SimdMul(q, SimdSet1(4.837512969970703125e-4f)));
+	r = SimdSub(r, SimdMul(q, SimdSet1(7.54978995489188216e-8f)));
+
+	SimdFloat z = SimdMul(r, r);
+	SimdFloat sr = SimdMulAdd(SimdMulAdd(SimdMulAdd(SimdSet1(-1.9515295891e-4f), z, SimdSet1(8.3321608736e-3f)), z,
+		SimdSet1(-1.6666654611e-1f)), SimdMul(z, r), r);
+	SimdFloat cr = SimdMulAdd(SimdMulAdd(SimdMulAdd(SimdSet1(2.443315711809948e-5f), z, SimdSet1(-1.388731625493765e-3f)), z,
+		SimdSet1(4.166664568298827e-2f)), SimdMul(z, z), SimdSub(SimdSet1(1.0f), SimdMul(SimdSet1(0.5f), z)));
+
+	//quadrant q mod 4 picks the polynomial and the sign, cosine is the sine one quadrant on
+	SimdFloat sinQuadrant = SimdSub(q, SimdMul(SimdFloor(SimdMul(q, SimdSet1(0.25f))), SimdSet1(4.0f)));
+	SimdFloat odd = SimdLess(SimdSet1(0.5f), SimdSub(sinQuadrant, SimdMul(SimdFloor(SimdMul(sinQuadrant, SimdSet1(0.5f))), SimdSet1(2.0f))));
+	SimdFloat cosQuadrant = SimdAdd(sinQuadrant, SimdSet1(1.0f));
+	cosQuadrant = SimdSelect(SimdLess(SimdSet1(3.5f), cosQuadrant), SimdSet1(0.0f), cosQuadrant);
+
+	SimdFloat zero = SimdSet1(0.0f);
+	s = SimdSelect(odd, cr, sr);
+	c = SimdSelect(odd, sr, cr);
+	s = SimdSelect(SimdLess(SimdSet1(1.5f), sinQuadrant), SimdSub(zero, s), s);
+	c = SimdSelect(SimdLess(SimdSet1(1.5f), cosQuadrant), SimdSub(zero, c), c);
+}
+
+//natural log of each lane for x > 0, within a couple of ulp of logf (Cephes). Lanes below the smallest normal float
+//are read as it, so log(0) is about -87.3 rather than -inf
+static inline SimdFloat SimdLog(SimdFloat x)
+{
+	//x = m * 2^e with m in [0.5, 1), m moved to [sqrt(0.5), sqrt(2)) so the polynomial runs around 1
+	SimdInt bits = SimdFloatAsInt(SimdMax(x, SimdSet1(1.17549435e-38f)));
+	SimdFloat e = SimdIntToFloat(SimdIntAdd(SimdIntShiftRight<23>(bits), SimdIntSet1(-126)));
+	SimdFloat m = SimdIntAsFloat(SimdIntOr(SimdIntAnd(bits, SimdIntSet1(0x007fffff)), SimdIntSet1(0x3f000000)));
+	SimdFloat small = SimdLess(m, SimdSet1(0.707106781f));
+	e = SimdSub(e, SimdSelect(small, SimdSet1(1.0f), SimdSet1(0.0f)));
+	SimdFloat f = SimdSub(SimdAdd(m, SimdSelect(small, m, SimdSet1(0.0f))), SimdSet1(1.0f));
+
+	SimdFloat z = SimdMul(f, f);
+	SimdFloat p = SimdSet1(7.0376836292e-2f);
+	p = SimdMulAdd(p, f, SimdSet1(-1.1514610310e-1f));
+	p = SimdMulAdd(p, f, SimdSet1(1.1676998740e-1f));
+	p = SimdMulAdd(p, f, SimdSet1(-1.2420140846e-1f));
+	p = SimdMulAdd(p, f, SimdSet1(1.4249322787e-1f));
+	p = SimdMulAdd(p, f, SimdSet1(-1.6668057665e-1f));
+	p = SimdMulAdd(p, f, SimdSet1(2.0000714765e-1f));
+	p = SimdMulAdd(p, f, SimdSet1(-2.4999993993e-1f));
+	p = SimdMulAdd(p, f, SimdSet1(3.3333331174e-1f));
+	SimdFloat y = SimdMul(SimdMul(p, f), z);
+	y = SimdMulAdd(e, SimdSet1(-2.12194440e-4f), y);
+	y = SimdSub(y, SimdMul(SimdSet1(0.5f), z));
+	return SimdMulAdd(e, SimdSet1(0.693359375f), SimdAdd(f, y));
+}
+
+//2^x of each lane, within a couple of ulp of exp2f (Cephes), x clamped to [-126, 126]
+static inline SimdFloat SimdExp2(SimdFloat x)
+{
+	x = SimdMin(SimdMax(x, SimdSet1(-126.0f)), SimdSet1(126.0f));
+	SimdFloat n = SimdFloor(SimdAdd(x, SimdSet1(0.5f)));
+	SimdFloat f = SimdSub(x, n);
+
+	SimdFloat p = SimdSet1(1.535336188319500e-4f);
+	p = SimdMulAdd(p, f, SimdSet1(1.339887440266574e-3f));
+	p = SimdMulAdd(p, f, SimdSet1(9.618437357674640e-3f));
+	p = SimdMulAdd(p, f, SimdSet1(5.550332471162809e-2f));
+	p = SimdMulAdd(p, f, SimdSet1(2.402264791363012e-1f));
+	p = SimdMulAdd(p, f, SimdSet1(6.931472028550421e-1f));
+	p = SimdMulAdd(p, f, SimdSet1(1.0f));
+	//2^n built straight in the exponent field
+	SimdFloat scale = SimdIntAsFloat(SimdIntShiftLeft<23>(SimdIntAdd(SimdFloatToInt(n), SimdIntSet1(127))));
+	return SimdMul(p, scale);
+}
+
+//cube root of each lane for x >= 0, exp2(log2(x) / 3) polished by one Newton step
+static inline SimdFloat SimdCbrt(SimdFloat x)
+{
+	SimdFloat y = SimdExp2(SimdMul(SimdLog(x), SimdSet1(1.44269504f / 3.0f)));
+	return SimdMul(SimdAdd(SimdAdd(y, y), SimdDiv(x, SimdMul(y, y))), SimdSet1(1.0f / 3.0f));
+}
+
+//trilinear filter of a grid with x fastest, base is the flat index of the low corner, whole numbers as floats,
+//the +1 neighbours along each axis must be in the table. Lerps x then y then z like the scalar samplers do
+static inline SimdFloat SimdSampleTrilinear(const float* table, SimdFloat base, SimdFloat strideY, SimdFloat strideZ,
+	SimdFloat fx, SimdFloat fy, SimdFloat fz)
+{
+	SimdFloat a, b;
+	SimdGatherPair(table, base, a, b);
+	SimdFloat c00 = SimdMulAdd(SimdSub(b, a), fx, a);
+	SimdGatherPair(table, SimdAdd(base, strideY), a, b);
+	SimdFloat c10 = SimdMulAdd(SimdSub(b, a), fx, a);
+	SimdGatherPair(table, SimdAdd(base, strideZ), a, b);
+	SimdFloat c01 = SimdMulAdd(SimdSub(b, a), fx, a);
+	SimdGatherPair(table, SimdAdd(SimdAdd(base, strideZ), strideY), a, b);
+	SimdFloat c11 = SimdMulAdd(SimdSub(b, a), fx, a);
+
+	SimdFloat c0 = SimdMulAdd(SimdSub(c10, c00), fy, c00);
+	SimdFloat c1 = SimdMulAdd(SimdSub(c11, c01), fy, c01);
+	return SimdMulAdd(SimdSub(c1, c0), fz, c0);
+}
+
+//flush denormals to zero (FTZ and DAZ) on this thread for the scope, for loops over values decaying towards 0
+//where every denormal operand costs around a hundred cycles. Results only differ from IEEE below ~1e-38
+class SimdFlushDenormals
+{
+public:
+	SimdFlushDenormals() : saved(_mm_getcsr()) { _mm_setcsr(saved | 0x8040); }
+	~SimdFlushDenormals() { _mm_setcsr(saved); }
+
+	SimdFlushDenormals(const SimdFlushDenormals&) = delete;
+	SimdFlushDenormals& operator=(const SimdFlushDenormals&) = delete;
+
+private:
+	unsigned int saved;
+};
@@ -0,0 +1,472 @@
+#include "ParticleSimulation.h"
+#include "ParticleKernels.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	//particles evaluated per step of an analytic build, small enough for the scratch streams to stay in L1
+	const int analyticBatchSize = 256;
+	//seconds of local time after which the analytic clock is rebased, float spawn times stay within a ms up to there
+	const double clockRebaseInterval = 1024.0;
+}
+
+ParticleSimulation::ParticleSimulation(Float3 position, Float3 startVelocity, int maxParticleCount, float lifetime,
+	float emissionTime, float startSize, float endSize, Float4 startColor, Float4 endColor)
+	: pool(maxParticleCount), position(position), lifetime(lifetime),
+	scheduler(1.0f / emissionTime), startVelocity(startVelocity),
+	sizeOverLife(ParticleCurve::Linear(startSize, endSize)), colorOverLife(ParticleGradient::Linear(startColor, endColor)), random(1), emissionShape(ParticleEmissionShape::Sphere(0.15f)), spawnConeAngle(0.5f),
+	spawnSpeedDeviation(0.2f), depthSorted(false), clock(0.0), clockBase(0.0), emittedCount(0), evaluated(false),
+	parallelChunkSize(16384)
+{
+	particleVertices = nullptr;
+	particleInstances = nullptr;
+
+	SetAffectors();
+	lifeTables.Bake(sizeOverLife, colorOverLife);
+}
+
+ParticleSimulation::~ParticleSimulation()
+{
+	delete[] particleVertices;
+	delete[] particleInstances;
+}
+
+void ParticleSimulation::SetPosition(Float3 position)
+{
+	this->position = position;
+}
+
+void ParticleSimulation::SetJobSystem(std::shared_ptr<JobSystem> jobSystem)
+{
+	this->jobSystem = jobSystem;
+	depthSorter.SetJobSystem(jobSystem);
+}
+
+void ParticleSimulation::SetStorage(ParticleStorage storage)
+{
+	pool.SetStorage(storage);
+	depthSorter.Reset();
+	depthSorted = false;
+	evaluated = false;
+	if (storage != ParticleStorage::Analytic)
+		evaluatedParticles.reset();
+}
+
+size_t ParticleSimulation::GetParticleMemoryBytes() const
+{
+	size_t bytes = pool.GetMemoryBytes();
+	if (evaluatedParticles)
+		bytes += (size_t)evaluatedParticles->GetCapacity() * ParticleData::StreamCount * sizeof(float);
+	return bytes;
+}
+
+void ParticleSimulation::SetParallelChunkSize(int chunkSize)
+{
+	//chunks must start on a SIMD batch, so threaded runs match single threaded ones bit for bit
+	parallelChunkSize = (chunkSize + PARTICLE_STREAM_ALIGNMENT - 1) / PARTICLE_STREAM_ALIGNMENT * PARTICLE_STREAM_ALIGNMENT;
+	if (parallelChunkSize < PARTICLE_STREAM_ALIGNMENT)
+		parallelChunkSize = PARTICLE_STREAM_ALIGNMENT;
+}
+
+void ParticleSimulation::SetSizeOverLife(const ParticleCurve& size)
+{
+	sizeOverLife = size;
+	lifeTables.Bake(sizeOverLife, colorOverLife);
+}
+
+void ParticleSimulation::SetColorOverLife(const ParticleGradient& color)
+{
+	colorOverLife = color;
+	lifeTables.Bake(sizeOverLife, colorOverLife);
+}
+
+void ParticleSimulation::SetSeed(unsigned int seed)
+{
+	random.SetSeed(seed);
+	emittedCount = 0;
+}
+
+void ParticleSimulation::SetEmissionShape(const ParticleEmissionShape& shape)
+{
+	emissionShape = shape;
+}
+
+void ParticleSimulation::SetVelocityVariation(float coneAngle, float speedDeviation)
+{
+	spawnConeAngle = coneAngle;
+	spawnSpeedDeviation = speedDeviation;
+}
+
+void ParticleSimulation::ParallelFor(int count, const std::function<void(int, int)>& body) const
+{
+	if (jobSystem)
+		jobSystem->ParallelFor(count, parallelChunkSize, body);
+	else if (count > 0)
+		body(0, count);
+}
+
+void ParticleSimulation::ParallelForLiveBatches(const std::function<void(int, int)>& body)
+{
+	ParticleSpan spans[2];
+	int spanCount = pool.GetSpans(spans);
+	int ranges[2][2];
+	int rangeCount = 0;
+	if (spanCount == 1)
+	{
+		ranges[rangeCount][0] = spans[0].first / PARTICLE_STREAM_ALIGNMENT * PARTICLE_STREAM_ALIGNMENT;
+		ranges[rangeCount++][1] = spans[0].first + spans[0].count;
+	}
+	else if (spanCount == 2)
+	{
+		//the wrapped ring is [0, head) and [tail, max count), a single sweep when head and tail share a batch
+		int tailBatch = spans[0].first / PARTICLE_STREAM_ALIGNMENT * PARTICLE_STREAM_ALIGNMENT;
+		if (spans[1].count > tailBatch)
+		{
+			ranges[rangeCount][0] = 0;
+			ranges[rangeCount++][1] = spans[0].first + spans[0].count;
+		}
+		else
+		{
+			ranges[rangeCount][0] = tailBatch;
+			ranges[rangeCount++][1] = spans[0].first + spans[0].count;
+			ranges[rangeCount][0] = 0;
+			ranges[rangeCount++][1] = spans[1].count;
+		}
+	}
+
+	for (int r = 0; r < rangeCount; r++)
+	{
+		int rangeBegin = ranges[r][0];
+		ParallelFor(ranges[r][1] - rangeBegin, [&](int begin, int end) {
+			body(rangeBegin + begin, rangeBegin + end);
+		});
+	}
+}
+
+void ParticleSimulation::ParallelForSpans(const std::function<void(int, int)>& body) const
+{
+	ParticleSpan spans[2];
+	int spanCount = pool.GetSpans(spans);
+	for (int s = 0; s < spanCount; s++)
+	{
+		int spanBegin = spans[s].first;
+		ParallelFor(spans[s].count, [&](int begin, int end) {
+			body(spanBegin + begin, spanBegin + end);
+		});
+	}
+}
+
+int ParticleSimulation::GetDrawSpans(ParticleSpan spans[2]) const
+{
+	if (depthSorted)
+	{
+		spans[0] = { 0, pool.GetAliveCount() };
+		return pool.GetAliveCount() > 0 ? 1 : 0;
+	}
+	return pool.GetSpans(spans);
+}
+
+void ParticleSimulation::Simulate(float dt)
+{
+	depthSorted = false;
+	evaluated = false;
+	clock += dt;
+	if (pool.GetStorage() == ParticleStorage::Analytic)
+	{
+		//nothing to integrate, the particles are evaluated from their spawn times when built
+		if (clock - clockBase > clockRebaseInterval)
+		{
+			//whole seconds, so the live spawn times shift exactly
+			float shift = (float)std::floor(clock - clockBase);
+			clockBase += shift;
+			ParallelForSpans([&](int begin, int end) {
+				float* spawnTimes = pool.GetSpawnTimes();
+				for (int i = begin; i < end; i++)
+				{
+					spawnTimes[i] -= shift;
+				}
+			});
+		}
+		pool.KillExpiredAt(lifetime, GetLocalTime());
+	}
+	else
+	{
+		UpdateParticles(dt);
+
+		//compact the survivors to the front, cost scales with the live count. A ring only advances past the expired ones
+		pool.KillExpired(lifetime);
+	}
+
+	//whole frame's births in one step, each aged by the part of the frame it already lived
+	spawnAges.clear();
+	scheduler.Advance(dt, lifetime, spawnAges);
+	EmitParticles();
+}
+
+void ParticleSimulation::FastForward(float seconds, int maxSteps)
+{
+	if (seconds <= 0.0f)
+		return;
+	if (seconds > lifetime)
+	{
+		Skip(seconds - lifetime);
+		seconds = lifetime;
+	}
+
+	//births are placed exactly within a step of any length, only forces need smaller steps
+	int steps = 1;
+	if (pool.GetStorage() != ParticleStorage::Analytic)
+		steps = std::max(1, std::min(maxSteps, (int)std::ceil(seconds / lifetime * maxSteps)));
+	for (int s = 0; s < steps; s++)
+	{
+		Simulate(seconds / steps);
+	}
+}
+
+void ParticleSimulation::Prewarm(float time, int maxSteps)
+{
+	pool.Clear();
+	scheduler.Reset();
+	depthSorter.Reset();
+	depthSorted = false;
+	FastForward(time, maxSteps);
+}
+
+void ParticleSimulation::Skip(float seconds)
+{
+	pool.Clear();
+	depthSorter.Reset();
+	depthSorted = false;
+	evaluated = false;
+	spawnAges.clear();
+	scheduler.Advance(seconds, 0.0f, spawnAges);
+	affectors->Advance(seconds);
+	clock += seconds;
+	//no spawn time left to keep
+	clockBase = clock;
+}
+
+void ParticleSimulation::BuildVertices(Float3 cameraRight, Float3 cameraUp)
+{
+	if (!particleVertices)
+	{
+		int maxParticleCount = pool.GetMaxCount();
+		particleVertices = new ParticleVertex[4 * maxParticleCount];      //4 vertices per particle
+
+		//clockwise default uv, corner positions and colors are rewritten every frame
+		const Float2 particleUV[4] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+		for (int i = 0; i < maxParticleCount * 4; i++)
+		{
+			particleVertices[i].UV = particleUV[i % 4];
+		}
+	}
+
+	//unsorted particles keep their slots in the vertex array, so ring spans draw straight from it
+	bool analytic = pool.GetStorage() == ParticleStorage::Analytic;
+	const ParticleData& particles = analytic && depthSorted ? *evaluatedParticles : pool.GetData();
+	auto build = [&](int begin, int end) {
+		BuildParticleVertices(particles, begin, end, cameraRight, cameraUp, depthSorted ? depthSorter.GetOrder() : nullptr, particleVertices);
+	};
+	if (depthSorted)
+		ParallelFor(pool.GetAliveCount(), build);
+	else if (analytic)
+	{
+		//evaluated a batch at a time into scratch streams, built from there into the particles' slots
+		ParallelForSpans([&](int begin, int end) {
+			ParticleData batch(analyticBatchSize);
+			for (int first = begin; first < end; first += analyticBatchSize)
+			{
+				int count = std::min(analyticBatchSize, end - first);
+				EvaluateParticles(first, count, batch, 0);
+				BuildParticleVertices(batch, 0, count, cameraRight, cameraUp, nullptr, particleVertices + 4 * first);
+			}
+		});
+	}
+	else
+		ParallelForSpans(build);
+}
+
+void ParticleSimulation::BuildInstances()
+{
+	if (!particleInstances)
+		particleInstances = new ParticleInstance[pool.GetMaxCount()];
+
+	bool analytic = pool.GetStorage() == ParticleStorage::Analytic;
+	const ParticleData& particles = analytic && depthSorted ? *evaluatedParticles : pool.GetData();
+	auto pack = [&](int begin, int end) {
+		PackParticleInstances(particles, begin, end, depthSorted ? depthSorter.GetOrder() : nullptr, particleInstances);
+	};
+	if (depthSorted)
+		ParallelFor(pool.GetAliveCount(), pack);
+	else if (analytic)
+	{
+		ParallelForSpans([&](int begin, int end) {
+			ParticleData batch(analyticBatchSize);
+			for (int first = begin; first < end; first += analyticBatchSize)
+			{
+				int count = std::min(analyticBatchSize, end - first);
+				EvaluateParticles(first, count, batch, 0);
+				PackParticleInstances(batch, 0, count, nullptr, particleInstances + first);
+			}
+		});
+	}
+	else
+		ParallelForSpans(pack);
+}
+
+void ParticleSimulation::SortBackToFront(Float3 cameraPosition, Float3 cameraForward)
+{
+	ParticleSpan spans[2];
+	int spanCount = pool.GetSpans(spans);
+	const ParticleData& particles = pool.GetStorage() == ParticleStorage::Analytic ? EvaluateAll() : pool.GetData();
+	depthSorter.Sort(particles, spans, spanCount, cameraPosition, cameraForward);
+	depthSorted = true;
+}
+
+void ParticleSimulation::SplatDensity(ParticleDensityVolume& volume) const
+{
+	ParticleSpan spans[2];
+	int spanCount = pool.GetSpans(spans);
+	volume.Splat(pool.GetStorage() == ParticleStorage::Analytic ? EvaluateAll() : pool.GetData(), spans, spanCount);
+}
+
+void ParticleSimulation::UpdateParticles(float dt)
+{
+	ParticleUpdateParams params = { lifetime, &lifeTables };
+
+	//per frame affector state (e.g. noise scrolling) moves before the chunks read it
+	affectors->Advance(dt);
+
+	//every particle only touches its own slot, so chunks are independent
+	ParallelForLiveBatches([&](int begin, int end) {
+		//update age, size and color of every particle in SIMD batches
+		UpdateParticleData(pool.GetData(), begin, end, dt, params);
+		//then forces and position, while the chunk is still in cache
+		affectors->Run(pool.GetData(), begin, end, dt);
+	});
+}
+
+void ParticleSimulation::EmitParticles()
+{
+	//particles that do not fit in the dead slots are dropped, oldest first since they have the least life left
+	int count = (int)spawnAges.size();
+	int remaining = count < pool.GetDeadCount() ? count : pool.GetDeadCount();
+	const float* ages = spawnAges.data() + (count - remaining);
+	//one range, or two when a ring's head wraps
+	while (remaining > 0)
+	{
+		int first = 0;
+		int spawned = pool.Spawn(remaining, first);
+		if (pool.GetStorage() == ParticleStorage::Analytic)
+			SpawnRecords(first, spawned, ages);
+		else
+			SpawnParticles(first, spawned, ages);
+		ages += spawned;
+		remaining -= spawned;
+	}
+}
+
+void ParticleSimulation::SpawnParticles(int first, int count, const float* ages)
+{
+	ParticleData& particles = pool.GetData();
+	const int last = first + count;
+
+	//set per particle position, shape offsets written straight into the streams then moved to the emitter
+	emissionShape.Sample(random, particles.PositionX + first, particles.PositionY + first, particles.PositionZ + first, count);
+	for (int i = first; i < last; i++)
+	{
+		particles.PositionX[i] += position.x;
+		particles.PositionY[i] += position.y;
+		particles.PositionZ[i] += position.z;
+	}
+
+	//set per particle velocity, a direction in the cone around startVelocity times a jittered speed
+	float speed = std::sqrt(startVelocity.x * startVelocity.x + startVelocity.y * startVelocity.y + startVelocity.z * startVelocity.z);
+	Float3 axis = speed > 0.0f ? Float3{ startVelocity.x / speed, startVelocity.y / speed, startVelocity.z / speed } : Float3{ 0.0f, 1.0f, 0.0f };
+	random.InCone(particles.VelocityX + first, particles.VelocityY + first, particles.VelocityZ + first, count, axis, spawnConeAngle);
+
+	spawnScratch.resize(count);
+	random.Normal(spawnScratch.data(), count, speed, speed * spawnSpeedDeviation);
+	for (int i = first; i < last; i++)
+	{
+		float particleSpeed = spawnScratch[i - first];
+		particles.VelocityX[i] *= particleSpeed;
+		particles.VelocityY[i] *= particleSpeed;
+		particles.VelocityZ[i] *= particleSpeed;
+	}
+
+	//set start rotation, the quad and instanced paths both spin the billboard by it
+	random.Uniform(particles.Rotation + first, count, 0.0f, 6.28318530718f);
+
+	//set start age from the sub frame birth time, with position, size and color caught up to it
+	ParticleUpdateParams params = { lifetime, &lifeTables };
+	AdvanceSpawnedParticles(particles, first, last, ages, params);
+}
+
+void ParticleSimulation::SpawnRecords(int first, int count, const float* ages)
+{
+	float* spawnTimes = pool.GetSpawnTimes();
+	unsigned int* seeds = pool.GetSeeds();
+	float now = GetLocalTime();
+	unsigned int seedBase = random.GetSeed() * 0x9E3779B1u;
+	for (int i = 0; i < count; i++)
+	{
+		spawnTimes[first + i] = now - ages[i];
+		seeds[first + i] = seedBase + emittedCount++;
+	}
+}
+
+void ParticleSimulation::EvaluateParticles(int first, int count, ParticleData& out, int outFirst) const
+{
+	const float* spawnTimes = pool.GetSpawnTimes();
+	const unsigned int* seeds = pool.GetSeeds();
+	float now = GetLocalTime();
+	float speed = std::sqrt(startVelocity.x * startVelocity.x + startVelocity.y * startVelocity.y + startVelocity.z * startVelocity.z);
+	Float3 axis = speed > 0.0f ? Float3{ startVelocity.x / speed, startVelocity.y / speed, startVelocity.z / speed } : Float3{ 0.0f, 1.0f, 0.0f };
+
+	//the same draws SpawnParticles makes, from a generator of the particle's own
+	float ages[analyticBatchSize];
+	for (int batchFirst = 0; batchFirst < count; batchFirst += analyticBatchSize)
+	{
+		int batchCount = std::min(analyticBatchSize, count - batchFirst);
+		for (int b = 0; b < batchCount; b++)
+		{
+			int slot = first + batchFirst + b;
+			int o = outFirst + batchFirst + b;
+			ParticleRandom particleRandom(seeds[slot]);
+			emissionShape.Sample(particleRandom, out.PositionX + o, out.PositionY + o, out.PositionZ + o, 1);
+			out.PositionX[o] += position.x;
+			out.PositionY[o] += position.y;
+			out.PositionZ[o] += position.z;
+
+			float particleSpeed;
+			particleRandom.InCone(out.VelocityX + o, out.VelocityY + o, out.VelocityZ + o, 1, axis, spawnConeAngle);
+			particleRandom.Normal(&particleSpeed, 1, speed, speed * spawnSpeedDeviation);
+			out.VelocityX[o] *= particleSpeed;
+			out.VelocityY[o] *= particleSpeed;
+			out.VelocityZ[o] *= particleSpeed;
+
+			particleRandom.Uniform(out.Rotation + o, 1, 0.0f, 6.28318530718f);
+			ages[b] = now - spawnTimes[slot];
+		}
+
+		//position, size and color at the particle's age
+		ParticleUpdateParams params = { lifetime, &lifeTables };
+		AdvanceSpawnedParticles(out, outFirst + batchFirst, outFirst + batchFirst + batchCount, ages, params);
+	}
+}
+
+const ParticleData& ParticleSimulation::EvaluateAll() const
+{
+	if (!evaluatedParticles)
+		evaluatedParticles = std::make_unique<ParticleData>(pool.GetMaxCount());
+	if (!evaluated)
+	{
+		ParallelForSpans([&](int begin, int end) {
+			EvaluateParticles(begin, end - begin, *evaluatedParticles, begin);
+		});
+		evaluated = true;
+	}
+	return *evaluatedParticles;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include"Particle.h"
+#include"ParticlePool.h"
+#include"ParticleMath.h"
+#include"ParticleAffectors.h"
+#include"ParticleCurves.h"
+#include"ParticleDensityVolume.h"
+#include"ParticleDepthSorter.h"
+#include"ParticleRandom.h"
+#include"ParticleEmissionScheduler.h"
+#include"ParticleEmissionShape.h"
+#include"JobSystem.h"
+#include<memory>
+#include<vector>
+
+//Platform neutral simulation core of one emitter: emission, aging, integration and vertex building.
+//Owns the particle streams and the CPU vertex array, ParticleEmitter only uploads and draws them.
+//With analytic storage a particle is only its spawn time and seed: the spawn state is drawn again from the seed and moved
+//along its constant velocity for its age each time it is built, so simulating is only retiring and emitting.
+class ParticleSimulation
+{
+public:
+	ParticleSimulation(Float3 position, Float3 startVelocity, int maxParticleCount, float lifetime, float emissionTime,
+		float startSize, float endSize, Float4 startColor, Float4 endColor);
+	~ParticleSimulation();
+
+	ParticleSimulation(const ParticleSimulation&) = delete;
+	ParticleSimulation& operator=(const ParticleSimulation&) = delete;
+
+	//age particles, remove the expired ones and emit new ones
+	void Simulate(float dt);
+	//simulate the next seconds in at most maxSteps steps, whatever seconds is: only the last lifetime can leave live
+	//particles, so anything before it is skipped without emitting. Analytic storage takes a single exact step, forces
+	//are integrated over steps of up to lifetime / maxSteps
+	void FastForward(float seconds, int maxSteps = 32);
+	//kill every particle and restart emission, then FastForward by time, e.g. one lifetime to start in the steady state.
+	//Affectors reading another simulation (FluidAdvectionAffector) see it frozen the whole time, so to prewarm
+	//against a solver call Prewarm(0) and then step the solver and FastForward in turns
+	void Prewarm(float time, int maxSteps = 32);
+	//write quad vertices for every live particle, once per frame after Simulate
+	void BuildVertices(Float3 cameraRight, Float3 cameraUp);
+	//instanced path - write one ParticleInstance per live particle instead of 4 vertices
+	void BuildInstances();
+	//order this frame's particles farthest first along cameraForward, for alpha blending. After Simulate and before
+	//building, the builds then write particles in that order until the next Simulate
+	void SortBackToFront(Float3 cameraPosition, Float3 cameraForward);
+	//rebuild volume from the live particles, for lighting that needs density on a grid
+	void SplatDensity(ParticleDensityVolume& volume) const;
+
+	int GetMaxParticleCount() const { return pool.GetMaxCount(); }
+	//live particles, the vertices and instances to draw are in GetDrawSpans
+	int GetParticleCount() const { return pool.GetAliveCount(); }
+	//particle ranges of GetVertices() (4 per particle) and GetInstances() to draw, in order, returns how many of the 2 are used.
+	//[0, GetParticleCount()) for compact storage or after a sort, the ring's live slots oldest first otherwise
+	int GetDrawSpans(ParticleSpan spans[2]) const;
+	const ParticleVertex* GetVertices() const { return particleVertices; }
+	const ParticleInstance* GetInstances() const { return particleInstances; }
+
+	Float3 GetPosition() const { return position; }
+	void SetPosition(Float3 position);
+
+	//Compact by default. Ring storage fits this class, every particle lives the same lifetime, and drops compaction:
+	//deaths only advance the ring's tail. Analytic storage keeps 8 bytes per particle instead of 52 and skips the update,
+	//for force free emitters: affectors are ignored, and particles start from the emitter's current position whenever they
+	//are built, so a moving emitter drags its particles along. Switching kills every particle
+	void SetStorage(ParticleStorage storage);
+	//bytes held for particle state, streams or analytic records plus their evaluation scratch
+	size_t GetParticleMemoryBytes() const;
+
+	//split update and vertex building across the job system's workers, null runs on the calling thread
+	void SetJobSystem(std::shared_ptr<JobSystem> jobSystem);
+	//particles per job, rounded up to a whole number of cache lines
+	void SetParallelChunkSize(int chunkSize);
+
+	//forces on the particles, composed into one fused loop, e.g.
+	//SetAffectors(WindAffector(...), LinearDragAffector(...)), no arguments for plain constant velocity motion
+	template<typename... Affectors>
+	void SetAffectors(const Affectors&... affectors)
+	{
+		this->affectors = std::make_unique<ParticleAffectorPipeline<Affectors...>>(affectors...);
+	}
+
+	//size over normalized life, baked once here, starts as the startSize to endSize line
+	void SetSizeOverLife(const ParticleCurve& size);
+	//color over normalized life, baked once here, starts as the startColor to endColor line
+	void SetColorOverLife(const ParticleGradient& color);
+
+	//emission timing, starts as a constant rate of 1 / emissionTime particles per second
+	ParticleEmissionScheduler& GetEmissionScheduler() { return scheduler; }
+
+	//restart the emission random sequence, same seed and frame times replay the same particles
+	void SetSeed(unsigned int seed);
+	//where particles start relative to the emitter position, a sphere of radius 0.15 by default
+	void SetEmissionShape(const ParticleEmissionShape& shape);
+	//directions uniform in a cone of coneAngle radians around startVelocity,
+	//speeds gaussian around |startVelocity| with speedDeviation as a fraction of it
+	void SetVelocityVariation(float coneAngle, float speedDeviation);
+
+private:
+	ParticlePool pool;
+	//output arrays, allocated on first build so an emitter only pays for the path it draws with
+	ParticleVertex* particleVertices;
+	ParticleInstance* particleInstances;
+	Float3 position;
+	float lifetime;
+	ParticleEmissionScheduler scheduler;
+	//ages of this frame's births at the end of the frame, oldest first
+	std::vector<float> spawnAges;
+	Float3 startVelocity;
+	//size and color over life, baked from curves
+	ParticleLifeTables lifeTables;
+
+	//kept so either one can be rebaked alone
+	ParticleCurve sizeOverLife;
+	ParticleGradient colorOverLife;
+
+	ParticleRandom random;
+	ParticleEmissionShape emissionShape;
+	float spawnConeAngle;
+	float spawnSpeedDeviation;
+	//per batch speeds, kept to avoid an allocation per emission
+	std::vector<float> spawnScratch;
+
+	std::unique_ptr<ParticleAffectorStage> affectors;
+
+	ParticleDepthSorter depthSorter;
+	//the sorter's order matches this frame's particles
+	bool depthSorted;
+
+	//simulated seconds, analytic spawn times count from clockBase so they keep float precision
+	double clock;
+	double clockBase;
+	//particles emitted since the last SetSeed, numbers the analytic seeds
+	unsigned int emittedCount;
+	//analytic storage: every live particle evaluated into its slot, for sorting and splatting, allocated on first use
+	mutable std::unique_ptr<ParticleData> evaluatedParticles;
+	//evaluatedParticles holds this frame's particles
+	mutable bool evaluated;
+
+	std::shared_ptr<JobSystem> jobSystem;
+	int parallelChunkSize;
+
+	//run body over [0, count) in chunks, inline when there is no job system
+	void ParallelFor(int count, const std::function<void(int, int)>& body) const;
+	//run body in chunks over slot ranges holding every live particle once, each range starting on a SIMD batch.
+	//A ring's spans are widened down to a batch, the dead slots swept in are updated along harmlessly
+	void ParallelForLiveBatches(const std::function<void(int, int)>& body);
+	//run body in chunks over every span of the live particles
+	void ParallelForSpans(const std::function<void(int, int)>& body) const;
+	void UpdateParticles(float dt);
+	//spawn this frame's births, the youngest ones win when the pool is short of dead slots
+	void EmitParticles();
+	//set start state of the particles in slots [first, first + count), already ages[i - first] old
+	void SpawnParticles(int first, int count, const float* ages);
+	//analytic storage: record spawn time and seed of the particles in slots [first, first + count)
+	void SpawnRecords(int first, int count, const float* ages);
+	//analytic storage: state of the particles in slots [first, first + count) now, written to out from outFirst on
+	void EvaluateParticles(int first, int count, ParticleData& out, int outFirst) const;
+	//analytic storage: evaluatedParticles brought up to this frame
+	const ParticleData& EvaluateAll() const;
+	//seconds since clockBase
+	float GetLocalTime() const { return (float)(clock - clockBase); }
+	//advance emission, forces and the clock by seconds with no births, killing every particle
+	void Skip(float seconds);
+};
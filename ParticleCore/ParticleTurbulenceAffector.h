@@ -0,0 +1,45 @@
+#pragma once
+
+#include"ParticleAffectors.h"
+#include"ParticleNoiseVolume.h"
+#include<cmath>
+#include<memory>
+
+//curl noise turbulence from a shared precomputed volume, tiling every tileSize world units.
+//The field scrolls through the particles at scrollVelocity, strength is the acceleration at the field's RMS length
+struct TurbulenceAffector : ParticleAffector
+{
+	std::shared_ptr<const ParticleNoiseVolume> volume;
+	float strength;
+	float tileSize;
+	Float3 scrollVelocity;
+	//moved by Advance, wrapped to one tile so it never loses precision
+	Float3 scrollOffset;
+
+	TurbulenceAffector(std::shared_ptr<const ParticleNoiseVolume> volume, float strength, float tileSize, Float3 scrollVelocity)
+		: volume(volume), strength(strength), tileSize(tileSize), scrollVelocity(scrollVelocity), scrollOffset{ 0.0f, 0.0f, 0.0f } {}
+
+	//in double, a Skip hands over hours in one dt and the float product would be off by a fraction of a tile
+	void Advance(float dt)
+	{
+		scrollOffset.x = (float)std::fmod(scrollOffset.x - (double)scrollVelocity.x * dt, (double)tileSize);
+		scrollOffset.y = (float)std::fmod(scrollOffset.y - (double)scrollVelocity.y * dt, (double)tileSize);
+		scrollOffset.z = (float)std::fmod(scrollOffset.z - (double)scrollVelocity.z * dt, (double)tileSize);
+	}
+
+	void Apply(ParticleLanes& lanes, SimdFloat dt) const
+	{
+		//world to cell units
+		SimdFloat toCells = SimdSet1(volume->GetResolution() / tileSize);
+		SimdFloat px = SimdMul(SimdAdd(lanes.positionX, SimdSet1(scrollOffset.x)), toCells);
+		SimdFloat py = SimdMul(SimdAdd(lanes.positionY, SimdSet1(scrollOffset.y)), toCells);
+		SimdFloat pz = SimdMul(SimdAdd(lanes.positionZ, SimdSet1(scrollOffset.z)), toCells);
+
+		SimdFloat fx, fy, fz;
+		volume->Sample(px, py, pz, fx, fy, fz);
+		SimdFloat scale = SimdMul(SimdSet1(strength), dt);
+		lanes.velocityX = SimdMulAdd(fx, scale, lanes.velocityX);
+		lanes.velocityY = SimdMulAdd(fy, scale, lanes.velocityY);
+		lanes.velocityZ = SimdMulAdd(fz, scale, lanes.velocityZ);
+	}
+};
@@ -0,0 +1,33 @@
+#include "VertexRingAllocator.h"
+
+VertexRingAllocator::VertexRingAllocator(int capacity)
+	: capacity(capacity), head(0), needsDiscard(true)
+{
+}
+
+bool VertexRingAllocator::Allocate(int count, VertexRingAllocation& allocation)
+{
+	if (count < 0 || count > capacity)
+		return false;
+
+	if (needsDiscard || head + count > capacity)
+	{
+		//wrap, the discard gives us a fresh buffer so the GPU can keep reading the old one
+		allocation.offset = 0;
+		allocation.discard = true;
+		head = count;
+		needsDiscard = false;
+		return true;
+	}
+
+	allocation.offset = head;
+	allocation.discard = false;
+	head += count;
+	return true;
+}
+
+void VertexRingAllocator::Reset()
+{
+	head = 0;
+	needsDiscard = true;
+}
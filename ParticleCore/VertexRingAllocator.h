@@ -0,0 +1,41 @@
+#pragma once
+
+//Bookkeeping for a dynamic vertex buffer used as a ring, kept free of any graphics API.
+//Each frame appends its vertices after the previous frame's, which is safe to map with
+//NO_OVERWRITE since the GPU never reads a range that was written after the last discard.
+//When an append does not fit the ring wraps to 0 and asks for a discard, so the driver
+//hands back fresh memory instead of stalling on vertices still in flight.
+
+//frames a ring holds between discards when its capacity is this many times the largest frame, so a frame the GPU
+//may still be reading is never overwritten and the driver renames the buffer at most once per this many frames
+const int ringFrameCount = 3;
+
+//where to write one allocation
+struct VertexRingAllocation
+{
+	//first vertex of the allocation, also the base vertex to draw with
+	int offset;
+	//map with discard (wrapped) instead of no overwrite
+	bool discard;
+};
+
+class VertexRingAllocator
+{
+public:
+	VertexRingAllocator(int capacity);
+
+	int GetCapacity() const { return capacity; }
+	//vertices written since the last discard
+	int GetUsed() const { return head; }
+
+	//reserve count vertices, false when count is larger than the whole ring
+	bool Allocate(int count, VertexRingAllocation& allocation);
+	//forget everything written, the next allocation discards (e.g. after the buffer is recreated)
+	void Reset();
+
+private:
+	int capacity;
+	int head;
+	//nothing mapped since the buffer was (re)created, first allocation must discard
+	bool needsDiscard;
+};
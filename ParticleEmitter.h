@@ -1,6 +1,7 @@
 #pragma once
 
-#include"Particle.h"
+#include"ParticleCore/ParticleSimulation.h"
+#include"ParticleGpuBuffers.h"
 #include"DirectXMath.h"
 #include <wrl/client.h>
 #include <d3d11.h>
@@ -10,6 +11,17 @@
 #include"Transformation.h"
 #include"Material.h"
 
+//how particles reach the GPU
+enum class ParticleRenderMode
+{
+	//4 CPU built vertices per particle, drawn with the static quad index buffer
+	Quads,
+	//1 ParticleInstance per particle, expanded by VertexShader_ParticlesInstanced
+	Instanced
+};
+
+//D3D11 adapter over ParticleSimulation: draws what the simulation built.
+//An emitter added to a ParticleSystem is drawn from the system's shared buffers and never creates its own
 class ParticleEmitter
 {
 public:
@@ -20,41 +32,62 @@ public:
 
 	~ParticleEmitter();
 
-	void InititalizeGeometry();
 	//update particles positions etc.
-	void SimulateParticles(float dt, std::shared_ptr<Camera> camera);
-	void DrawParticles(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, std::shared_ptr<Camera> camera);
+	void SimulateParticles(float dt, const CameraFrame& cameraFrame);
+	//standalone draw, creates the emitter's buffers on first use
+	void DrawParticles(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, const CameraFrame& cameraFrame);
+
+	//vertices (4 per particle) or instances drawn this frame, GetParticleCount() particles
+	int GetParticleCount() const { return simulation.GetParticleCount(); }
+	//write this frame's vertices or instances back to back in draw order, after SimulateParticles
+	void CopyVertices(ParticleVertex* destination) const;
+	void CopyInstances(ParticleInstance* destination) const;
+	std::shared_ptr<Material> GetMaterial() const { return material; }
+	ParticleRenderMode GetRenderMode() const { return renderMode; }
+	DirectX::XMFLOAT3 GetPosition() const;
+
+	//share worker threads for simulation and vertex building
+	void SetJobSystem(std::shared_ptr<JobSystem> jobSystem);
+	//rate, bursts and rate curve of the emission
+	ParticleEmissionScheduler& GetEmissionScheduler() { return simulation.GetEmissionScheduler(); }
+	//forces on the particles, see ParticleSimulation::SetAffectors
+	template<typename... Affectors>
+	void SetAffectors(const Affectors&... affectors) { simulation.SetAffectors(affectors...); }
+	//size and color over life, baked when set
+	void SetSizeOverLife(const ParticleCurve& size) { simulation.SetSizeOverLife(size); }
+	void SetColorOverLife(const ParticleGradient& color) { simulation.SetColorOverLife(color); }
+	//spawn area relative to the emitter position
+	void SetEmissionShape(const ParticleEmissionShape& shape);
+	//rebuild volume from the live particles, after SimulateParticles
+	void SplatDensity(ParticleDensityVolume& volume) const { simulation.SplatDensity(volume); }
+	//material must use the vertex shader matching the mode
+	void SetRenderMode(ParticleRenderMode renderMode, std::shared_ptr<Material> material);
+	//draw farthest first, needed by alpha blended (not additive) materials
+	void SetDepthSorting(bool enabled) { depthSorting = enabled; }
+	//particle layout, see ParticleSimulation::SetStorage
+	void SetStorage(ParticleStorage storage) { simulation.SetStorage(storage); }
+	//jump to the state after time seconds of emission, or the next seconds, at a cost bounded by one lifetime of
+	//particles, see ParticleSimulation::Prewarm and FastForward. The next SimulateParticles builds the result
+	void Prewarm(float time) { simulation.Prewarm(time); }
+	void FastForward(float seconds) { simulation.FastForward(seconds); }
 private:
-	int maxParticleCount;
-	Particle* particles;
-	ParticleVertex* particleVertices;
+	friend class ParticleSystem;
+
+	ParticleSimulation simulation;
 	Transformation transform;
-	float lifetime;
-	//total time elapsed after simulating
-	float timeElapsed;
-	//time taken by 1 particle to emit
-	float emissionTime;
-	float startSize;
-	DirectX::XMFLOAT3 startVelocity;
-	float endSize;
-	//particle index
-	int pIndex;
-	DirectX::XMFLOAT4 startColor;
-	DirectX::XMFLOAT4 endColor;
-	DirectX::XMFLOAT2 particleUV[4];
+	//kept to create the buffers on the first standalone draw
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	//index in the owning ParticleSystem, -1 when not in one
+	int systemIndex;
 
 	std::shared_ptr<Material> material;
 
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vBuffer;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> iBuffer;
-
-	//create v and i buffers
-	void CreateBuffers(Microsoft::WRL::ComPtr<ID3D11Device> device);
-	void UpdateParticles(float dt, int pIndex, std::shared_ptr<Camera> camera);
+	//standalone draws only, sized for this emitter's particles
+	std::unique_ptr<ParticleGpuBuffers> buffers;
 
-	void EmitParticles();
+	ParticleRenderMode renderMode;
+	bool depthSorting;
 
-	//Credits: Prof Cascioli
-	//algo to calculate vertex position in respect to camera
-	DirectX::XMFLOAT3 CalcParticleVertexPosition(int particleIndex, int quadCornerIndex, std::shared_ptr<Camera> camera);
-};
\ No newline at end of file
+	void DrawQuads(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, const CameraFrame& cameraFrame);
+	void DrawInstances(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, const CameraFrame& cameraFrame);
+};
@@ -0,0 +1,105 @@
+#include "ParticleGpuBuffers.h"
+#include <vector>
+
+ParticleGpuBuffers::ParticleGpuBuffers(Microsoft::WRL::ComPtr<ID3D11Device> device, int maxParticleCount)
+	: maxParticleCount(maxParticleCount), vertexRing(4 * maxParticleCount * ringFrameCount),
+	instanceRing(maxParticleCount * ringFrameCount)
+{
+	D3D11_BUFFER_DESC vBufferDesc = {};
+	vBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	vBufferDesc.ByteWidth = sizeof(ParticleVertex) * vertexRing.GetCapacity();     //4 vertex per particle, several frames
+	vBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	device->CreateBuffer(&vBufferDesc, 0, vBuffer.GetAddressOf());
+
+	D3D11_BUFFER_DESC instanceBufferDesc = {};
+	instanceBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	instanceBufferDesc.ByteWidth = sizeof(ParticleInstance) * instanceRing.GetCapacity();     //1 instance per particle, several frames
+	instanceBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	instanceBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	device->CreateBuffer(&instanceBufferDesc, 0, instanceBuffer.GetAddressOf());
+
+	//clockwise quads for the whole budget, a draw of any particles uses its first particleCount * 6
+	std::vector<unsigned int> constIndices(maxParticleCount * 6);
+	int j = 0;
+	for (int i = 0; i < maxParticleCount * 4; i += 4)
+	{
+		constIndices[j++] = i;
+		constIndices[j++] = i + 1;
+		constIndices[j++] = i + 2;
+		constIndices[j++] = i;
+		constIndices[j++] = i + 2;
+		constIndices[j++] = i + 3;
+	}
+
+	D3D11_SUBRESOURCE_DATA initialIndices = {};
+	initialIndices.pSysMem = constIndices.data();
+
+	D3D11_BUFFER_DESC iBufferDesc = {};
+	iBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	iBufferDesc.ByteWidth = sizeof(unsigned int) * 6 * maxParticleCount;     //6 index
+	iBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	iBufferDesc.CPUAccessFlags = 0;
+
+	device->CreateBuffer(&iBufferDesc, &initialIndices, iBuffer.GetAddressOf());
+}
+
+void* ParticleGpuBuffers::Map(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, ID3D11Buffer* buffer,
+	VertexRingAllocator& ring, int count, int& offset)
+{
+	//a draw past the budget would also run off the end of the index buffer
+	VertexRingAllocation allocation;
+	if (count > ring.GetCapacity() / ringFrameCount || !ring.Allocate(count, allocation))
+		return nullptr;
+
+	D3D11_MAPPED_SUBRESOURCE mResource;
+	if (FAILED(deviceContext->Map(buffer, 0, allocation.discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mResource)))
+	{
+		//the ring moved on without a discard reaching the driver, so the next map must discard
+		ring.Reset();
+		return nullptr;
+	}
+	offset = allocation.offset;
+	return mResource.pData;
+}
+
+ParticleVertex* ParticleGpuBuffers::MapVertices(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, int particleCount, int& offset)
+{
+	void* data = Map(deviceContext, vBuffer.Get(), vertexRing, particleCount * 4, offset);
+	return data ? static_cast<ParticleVertex*>(data) + offset : nullptr;
+}
+
+ParticleInstance* ParticleGpuBuffers::MapInstances(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, int particleCount, int& offset)
+{
+	void* data = Map(deviceContext, instanceBuffer.Get(), instanceRing, particleCount, offset);
+	return data ? static_cast<ParticleInstance*>(data) + offset : nullptr;
+}
+
+void ParticleGpuBuffers::UnmapVertices(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext)
+{
+	deviceContext->Unmap(vBuffer.Get(), 0);
+}
+
+void ParticleGpuBuffers::UnmapInstances(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext)
+{
+	deviceContext->Unmap(instanceBuffer.Get(), 0);
+}
+
+void ParticleGpuBuffers::BindVertices(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext)
+{
+	UINT stride = sizeof(ParticleVertex);
+	UINT offset = 0;
+	deviceContext->IASetVertexBuffers(0, 1, vBuffer.GetAddressOf(), &stride, &offset);
+	deviceContext->IASetIndexBuffer(iBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+}
+
+void ParticleGpuBuffers::BindInstances(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext)
+{
+	ID3D11Buffer* buffers[2] = { nullptr, instanceBuffer.Get() };
+	UINT strides[2] = { 0, sizeof(ParticleInstance) };
+	UINT offsets[2] = { 0, 0 };
+	deviceContext->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+	deviceContext->IASetIndexBuffer(nullptr, DXGI_FORMAT_R32_UINT, 0);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include"ParticleCore/Particle.h"
+#include"ParticleCore/VertexRingAllocator.h"
+#include <wrl/client.h>
+#include <d3d11.h>
+
+//GPU side of drawing particles, one set per ParticleSystem and per emitter drawn on its own: a dynamic vertex buffer
+//and a dynamic instance buffer used as rings, and one static quad index buffer, sized for maxParticleCount particles
+//drawn per frame
+class ParticleGpuBuffers
+{
+public:
+	ParticleGpuBuffers(Microsoft::WRL::ComPtr<ID3D11Device> device, int maxParticleCount);
+
+	ParticleGpuBuffers(const ParticleGpuBuffers&) = delete;
+	ParticleGpuBuffers& operator=(const ParticleGpuBuffers&) = delete;
+
+	int GetMaxParticleCount() const { return maxParticleCount; }
+
+	//map room for particleCount particles after the previous frame's, discarding only when the ring wraps.
+	//offset is the base vertex or first instance to draw from. Null, with nothing mapped, when particleCount is
+	//past the budget or the map fails
+	ParticleVertex* MapVertices(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, int particleCount, int& offset);
+	ParticleInstance* MapInstances(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, int particleCount, int& offset);
+	void UnmapVertices(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext);
+	void UnmapInstances(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext);
+
+	//vertices with the static index buffer, DrawIndexed(particles * 6, 0, offset)
+	void BindVertices(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext);
+	//no per vertex data, the shader works from SV_VertexID, instances come from slot 1. DrawInstanced(6, particles, 0, offset)
+	void BindInstances(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext);
+
+private:
+	int maxParticleCount;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> vBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> iBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+	//4 vertices or 1 instance per particle, ringFrameCount frames of the whole budget
+	VertexRingAllocator vertexRing;
+	VertexRingAllocator instanceRing;
+
+	//map count elements of ring in buffer, null when they do not fit
+	void* Map(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, ID3D11Buffer* buffer, VertexRingAllocator& ring,
+		int count, int& offset);
+};
@@ -0,0 +1,169 @@
+#include "ParticleSystem.h"
+#include <algorithm>
+
+ParticleSystem::ParticleSystem(Microsoft::WRL::ComPtr<ID3D11Device> device, int maxParticleCount)
+	: maxParticleCount(maxParticleCount), buffers(device, maxParticleCount), drawCount(0)
+{
+}
+
+void ParticleSystem::AddEmitter(std::shared_ptr<ParticleEmitter> emitter)
+{
+	if (emitter->systemIndex >= 0)
+		return;
+	emitter->systemIndex = (int)emitters.size();
+	emitters.push_back(emitter);
+}
+
+void ParticleSystem::RemoveEmitter(const std::shared_ptr<ParticleEmitter>& emitter)
+{
+	int index = emitter->systemIndex;
+	if (index < 0 || index >= (int)emitters.size() || emitters[index] != emitter)
+		return;
+
+	//the last emitter takes the hole
+	emitters[index] = emitters.back();
+	emitters[index]->systemIndex = index;
+	emitters.pop_back();
+	emitter->systemIndex = -1;
+}
+
+void ParticleSystem::Simulate(float dt, const CameraFrame& cameraFrame)
+{
+	for (const std::shared_ptr<ParticleEmitter>& emitter : emitters)
+	{
+		emitter->SimulateParticles(dt, cameraFrame);
+	}
+}
+
+void ParticleSystem::BuildBatches(const CameraFrame& cameraFrame)
+{
+	drawOrder.clear();
+	drawDepths.resize(emitters.size());
+	for (int i = 0; i < (int)emitters.size(); i++)
+	{
+		if (emitters[i]->GetParticleCount() == 0)
+			continue;
+		DirectX::XMFLOAT3 position = emitters[i]->GetPosition();
+		drawDepths[i] = (position.x - cameraFrame.position.x) * cameraFrame.forward.x + (position.y - cameraFrame.position.y) * cameraFrame.forward.y +
+			(position.z - cameraFrame.position.z) * cameraFrame.forward.z;
+		drawOrder.push_back(i);
+	}
+
+	//dozens of emitters, sorting the indices costs nothing next to the copies
+	std::sort(drawOrder.begin(), drawOrder.end(), [this](int a, int b) {
+		const ParticleEmitter& emitterA = *emitters[a];
+		const ParticleEmitter& emitterB = *emitters[b];
+		if (emitterA.GetRenderMode() != emitterB.GetRenderMode())
+			return emitterA.GetRenderMode() < emitterB.GetRenderMode();
+		if (emitterA.GetMaterial() != emitterB.GetMaterial())
+			return emitterA.GetMaterial() < emitterB.GetMaterial();
+		if (drawDepths[a] != drawDepths[b])
+			return drawDepths[a] > drawDepths[b];
+		return a < b;
+	});
+
+	//emitters that would overflow the per frame budget are left out
+	batches.clear();
+	int budget = maxParticleCount;
+	for (int i = 0; i < (int)drawOrder.size(); i++)
+	{
+		const ParticleEmitter& emitter = *emitters[drawOrder[i]];
+		int particleCount = emitter.GetParticleCount();
+		if (particleCount > budget)
+		{
+			drawOrder.erase(drawOrder.begin() + i);
+			i--;
+			continue;
+		}
+		budget -= particleCount;
+
+		Material* material = emitter.GetMaterial().get();
+		if (batches.empty() || batches.back().renderMode != emitter.GetRenderMode() || batches.back().material != material)
+			batches.push_back(Batch{ emitter.GetRenderMode(), material, i, 0, 0 });
+		batches.back().count++;
+		batches.back().particleCount += particleCount;
+	}
+}
+
+void ParticleSystem::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, const CameraFrame& cameraFrame)
+{
+	drawCount = 0;
+	BuildBatches(cameraFrame);
+	if (batches.empty())
+		return;
+
+	int quadParticles = 0;
+	int instanceParticles = 0;
+	for (const Batch& batch : batches)
+	{
+		if (batch.renderMode == ParticleRenderMode::Instanced)
+			instanceParticles += batch.particleCount;
+		else
+			quadParticles += batch.particleCount;
+	}
+
+	//one map per ring for the whole frame, each batch's particles packed after the previous batch's.
+	//BuildBatches keeps the frame within the budget, a mode whose map still fails is not drawn this frame
+	int quadOffset = 0;
+	int instanceOffset = 0;
+	ParticleVertex* vertices = quadParticles > 0 ? buffers.MapVertices(deviceContext, quadParticles, quadOffset) : nullptr;
+	ParticleInstance* instances = instanceParticles > 0 ? buffers.MapInstances(deviceContext, instanceParticles, instanceOffset) : nullptr;
+	if (vertices)
+	{
+		ParticleVertex* destination = vertices;
+		for (const Batch& batch : batches)
+		{
+			if (batch.renderMode != ParticleRenderMode::Quads)
+				continue;
+			for (int i = batch.first; i < batch.first + batch.count; i++)
+			{
+				const ParticleEmitter& emitter = *emitters[drawOrder[i]];
+				emitter.CopyVertices(destination);
+				destination += 4 * emitter.GetParticleCount();
+			}
+		}
+		buffers.UnmapVertices(deviceContext);
+	}
+	if (instances)
+	{
+		ParticleInstance* destination = instances;
+		for (const Batch& batch : batches)
+		{
+			if (batch.renderMode != ParticleRenderMode::Instanced)
+				continue;
+			for (int i = batch.first; i < batch.first + batch.count; i++)
+			{
+				const ParticleEmitter& emitter = *emitters[drawOrder[i]];
+				emitter.CopyInstances(destination);
+				destination += emitter.GetParticleCount();
+			}
+		}
+		buffers.UnmapInstances(deviceContext);
+	}
+
+	//one draw per batch, the static index buffer rebased onto each batch's vertices
+	for (const Batch& batch : batches)
+	{
+		if (batch.renderMode == ParticleRenderMode::Instanced)
+		{
+			if (!instances)
+				continue;
+			buffers.BindInstances(deviceContext);
+
+			batch.material->PrepareMaterial(&transform, cameraFrame);
+			deviceContext->DrawInstanced(6, batch.particleCount, 0, instanceOffset);
+			instanceOffset += batch.particleCount;
+		}
+		else
+		{
+			if (!vertices)
+				continue;
+			buffers.BindVertices(deviceContext);
+
+			batch.material->PrepareMaterial(&transform, cameraFrame);
+			deviceContext->DrawIndexed(batch.particleCount * 6, 0, quadOffset);
+			quadOffset += batch.particleCount * 4;
+		}
+		drawCount++;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include"ParticleEmitter.h"
+#include"ParticleGpuBuffers.h"
+#include"DirectXMath.h"
+#include <wrl/client.h>
+#include <d3d11.h>
+#include<memory>
+#include<vector>
+#include"Camera.h"
+#include"Transformation.h"
+#include"Material.h"
+
+//Owns every emitter of the scene and draws them from shared GPU buffers: one dynamic vertex buffer and one dynamic
+//instance buffer used as rings, and one static quad index buffer. Each frame maps each ring once, packs the emitters'
+//particles grouped by material and issues one draw per material and render mode.
+//Emitters of a group are packed farthest first by position, the particles of each one keep its own order.
+//The buffers are sized for maxParticleCount particles drawn per frame once, adding and removing emitters never
+//touches them, and particles past that budget are not drawn.
+class ParticleSystem
+{
+public:
+	ParticleSystem(Microsoft::WRL::ComPtr<ID3D11Device> device, int maxParticleCount);
+
+	ParticleSystem(const ParticleSystem&) = delete;
+	ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+	//both O(1), an emitter is in at most one system
+	void AddEmitter(std::shared_ptr<ParticleEmitter> emitter);
+	void RemoveEmitter(const std::shared_ptr<ParticleEmitter>& emitter);
+	int GetEmitterCount() const { return (int)emitters.size(); }
+
+	//simulate and build every emitter for this frame
+	void Simulate(float dt, const CameraFrame& cameraFrame);
+	//blend and depth states are the caller's, like ParticleEmitter::DrawParticles
+	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, const CameraFrame& cameraFrame);
+
+	//draw calls of the last Draw
+	int GetDrawCount() const { return drawCount; }
+
+private:
+	std::vector<std::shared_ptr<ParticleEmitter>> emitters;
+	int maxParticleCount;
+	//particles are in world space
+	Transformation transform;
+
+	ParticleGpuBuffers buffers;
+
+	//one draw: emitters [first, first + count) of drawOrder, particles from offset of their ring
+	struct Batch
+	{
+		ParticleRenderMode renderMode;
+		Material* material;
+		int first;
+		int count;
+		int particleCount;
+	};
+	//emitter indices grouped by render mode and material, then farthest first, rebuilt every Draw
+	std::vector<int> drawOrder;
+	std::vector<float> drawDepths;
+	std::vector<Batch> batches;
+	int drawCount;
+
+	void BuildBatches(const CameraFrame& cameraFrame);
+};
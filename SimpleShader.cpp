@@ -790,6 +790,10 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
 		refl->GetInputParameterDesc(i, &paramDesc);
 
+		// System generated values (SV_VertexID, SV_InstanceID) are not part of the input layout
+		if (paramDesc.SystemValueType != D3D_NAME_UNDEFINED)
+			continue;
+
 		// Check the semantic name for "_PER_INSTANCE"
 		std::string perInstanceStr = "_PER_INSTANCE";
 		std::string sem = paramDesc.SemanticName;
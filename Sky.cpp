@@ -123,13 +123,13 @@ Sky::Sky(const wchar_t* ddsLocation, std::shared_ptr<Mesh> cubeMesh, Microsoft::
 		printf("DDS file not loading");
 }
 
-void Sky::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera)
+void Sky::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const CameraFrame& cameraFrame)
 {
 	context->RSSetState(rasterizerState.Get());
 	context->OMSetDepthStencilState(depthBufferDSV.Get(), 0);
 
-	vertexShader_Sky->SetMatrix4x4("viewMatrix", camera->GetViewMatrix());
-	vertexShader_Sky->SetMatrix4x4("projectionMatrix", camera->GetProjectionMatrix());
+	vertexShader_Sky->SetMatrix4x4("viewMatrix", cameraFrame.view);
+	vertexShader_Sky->SetMatrix4x4("projectionMatrix", cameraFrame.projection);
 
 	pixelShader_Sky->SetShaderResourceView("CubeMap", shaderViewCube);
 	pixelShader_Sky->SetSamplerState("BasicSampler", samplerState);
@@ -16,7 +16,7 @@ public:
 	Sky(const wchar_t* ddsLocation, std::shared_ptr<Mesh> cubeMesh, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, 
 		Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
 
-	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera);
+	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const CameraFrame& cameraFrame);
 
 private:
 
@@ -0,0 +1,100 @@
+#include"TestReport.h"
+#include"ParticleCore/ParticleKernels.h"
+#include"ParticleCore/ParticleRandom.h"
+#include<algorithm>
+#include<cmath>
+#include<string>
+#include<vector>
+
+namespace
+{
+	//odd so every SIMD width ends on a partial batch
+	const int particleCount = 1003;
+	const float positionRange = 50.0f;
+	const float maxSize = 2.0f;
+
+	void FillParticles(ParticleData& particles, float maxRotation)
+	{
+		ParticleRandom random(8);
+		random.Uniform(particles.PositionX, particleCount, -positionRange, positionRange);
+		random.Uniform(particles.PositionY, particleCount, -positionRange, positionRange);
+		random.Uniform(particles.PositionZ, particleCount, -positionRange, positionRange);
+		random.Uniform(particles.Size, particleCount, 0.05f, maxSize);
+		random.Uniform(particles.ColorR, particleCount, 0.0f, 1.0f);
+		random.Uniform(particles.ColorG, particleCount, 0.0f, 1.0f);
+		random.Uniform(particles.ColorB, particleCount, 0.0f, 1.0f);
+		random.Uniform(particles.ColorA, particleCount, 0.0f, 1.0f);
+		random.Uniform(particles.Rotation, particleCount, -maxRotation, maxRotation);
+	}
+
+	//largest distance between BuildParticleVertices corners and PackParticleInstances expanded like the vertex shader,
+	//through order so the reordered path is covered too. colorsMatch is false when a packed color differs
+	double MaxCornerError(const ParticleData& particles, const std::vector<unsigned int>& order, bool& colorsMatch)
+	{
+		//tilted camera so both axes have 3 non zero components
+		const Float3 cameraRight = { 0.8f, 0.0f, -0.6f };
+		const Float3 cameraUp = { 0.36f, 0.8f, 0.48f };
+
+		std::vector<ParticleVertex> vertices((size_t)particleCount * 4);
+		std::vector<ParticleInstance> instances(particleCount);
+		BuildParticleVertices(particles, 0, particleCount, cameraRight, cameraUp, order.data(), vertices.data());
+		PackParticleInstances(particles, 0, particleCount, order.data(), instances.data());
+
+		double maxError = 0.0;
+		colorsMatch = true;
+		for (int i = 0; i < particleCount; i++)
+		{
+			for (int corner = 0; corner < 4; corner++)
+			{
+				const ParticleVertex& built = vertices[i * 4 + corner];
+				Float3 expanded = ExpandParticleInstance(instances[i], cameraRight, cameraUp, corner);
+				double dx = expanded.x - built.Position.x;
+				double dy = expanded.y - built.Position.y;
+				double dz = expanded.z - built.Position.z;
+				maxError = std::max(maxError, std::sqrt(dx * dx + dy * dy + dz * dz));
+				if (PackParticleColor(built.Color.x, built.Color.y, built.Color.z, built.Color.w) != instances[i].Color)
+					colorsMatch = false;
+			}
+		}
+		return maxError;
+	}
+}
+
+int main()
+{
+	TestReport report("Billboard");
+
+	ParticleData particles(particleCount);
+	std::vector<unsigned int> order(particleCount);
+	for (int i = 0; i < particleCount; i++)
+	{
+		order[i] = (unsigned int)(particleCount - 1 - i);
+	}
+
+	//the sine and cosine of the two paths may differ in the last bit: a few ulp of the largest coordinate
+	const double rotatedTolerance = 4.0e-7 * (positionRange + maxSize);
+
+	const ParticleKernelTable& startup = GetParticleKernels();
+	for (const ParticleKernelTable* kernels : GetParticleKernelVariants())
+	{
+		if (!IsParticleIsaSupported(kernels->isa))
+			continue;
+		SetParticleKernels(*kernels);
+		const std::string isa = GetParticleIsaName(kernels->isa);
+
+		bool colorsMatch = false;
+		FillParticles(particles, 0.0f);
+		double error = MaxCornerError(particles, order, colorsMatch);
+		report.Check(error == 0.0, (isa + ": unrotated quad corners equal the instance expansion").c_str());
+		report.Check(colorsMatch, (isa + ": quad colors pack to the instance colors").c_str());
+
+		//several turns either way so the quarter turn reduction is exercised too
+		FillParticles(particles, 20.0f);
+		error = MaxCornerError(particles, order, colorsMatch);
+		if (!report.Check(error <= rotatedTolerance, (isa + ": rotated quad corners match the instance expansion").c_str()))
+			std::printf("  max corner error %g, tolerance %g\n", error, rotatedTolerance);
+	}
+	SetParticleKernels(startup);
+
+	return report.Result();
+}
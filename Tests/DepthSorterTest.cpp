@@ -0,0 +1,68 @@
+#include"TestReport.h"
+#include"ParticleCore/ParticleDepthSorter.h"
+#include<vector>
+
+namespace
+{
+	const int capacity = 1000;
+
+	//whether the sorter's order lists slots ascending, what equal depths must come out as
+	bool InSlotOrder(const ParticleDepthSorter& sorter)
+	{
+		for (int i = 1; i < sorter.GetCount(); i++)
+		{
+			if (sorter.GetOrder()[i - 1] >= sorter.GetOrder()[i])
+				return false;
+		}
+		return true;
+	}
+
+	void TestWrappedTies(TestReport& report)
+	{
+		//co-planar particles: every depth is equal, only the slot decides
+		ParticleData particles(capacity);
+		const Float3 cameraPosition = { 0.0f, 0.0f, -10.0f };
+		const Float3 cameraForward = { 0.0f, 0.0f, 1.0f };
+
+		//a wrapped ring's live range, its upper span listed first
+		const ParticleSpan spans[2] = { { 700, 300 }, { 0, 200 } };
+		ParticleDepthSorter sorter;
+		sorter.Sort(particles, spans, 2, cameraPosition, cameraForward);
+		report.Check(!sorter.WasIncremental() && sorter.GetCount() == 500, "first sort is a full sort of both spans");
+		report.Check(InSlotOrder(sorter), "full sort of a wrapped ring breaks depth ties by slot");
+		std::vector<unsigned int> fullOrder(sorter.GetOrder(), sorter.GetOrder() + sorter.GetCount());
+
+		sorter.Sort(particles, spans, 2, cameraPosition, cameraForward);
+		report.Check(sorter.WasIncremental(), "a still camera repairs the previous order");
+		report.Check(std::vector<unsigned int>(sorter.GetOrder(), sorter.GetOrder() + sorter.GetCount()) == fullOrder,
+			"repair frame keeps the full sort's tie order");
+	}
+
+	void TestDepthOrder(TestReport& report)
+	{
+		ParticleData particles(capacity);
+		for (int i = 0; i < capacity; i++)
+		{
+			particles.PositionZ[i] = (float)((i * 7919) % capacity);
+		}
+		const ParticleSpan spans[2] = { { 600, 400 }, { 0, 300 } };
+		ParticleDepthSorter sorter;
+		sorter.Sort(particles, spans, 2, Float3{ 0.0f, 0.0f, -10.0f }, Float3{ 0.0f, 0.0f, 1.0f });
+
+		bool farthestFirst = true;
+		for (int i = 1; i < sorter.GetCount(); i++)
+		{
+			if (particles.PositionZ[sorter.GetOrder()[i - 1]] < particles.PositionZ[sorter.GetOrder()[i]])
+				farthestFirst = false;
+		}
+		report.Check(farthestFirst, "particles come out farthest first");
+	}
+}
+
+int main()
+{
+	TestReport report("DepthSorter");
+	TestWrappedTies(report);
+	TestDepthOrder(report);
+	return report.Result();
+}
@@ -0,0 +1,124 @@
+#include"TestReport.h"
+#include"ParticleCore/ParticleEmissionScheduler.h"
+#include<algorithm>
+#include<cmath>
+#include<vector>
+
+namespace
+{
+	const float frameDt = 1.0f / 60.0f;
+
+	//rate rising from 0 to twice the base and back over each 1 second loop
+	ParticleEmissionScheduler CreateTriangleScheduler()
+	{
+		ParticleEmissionScheduler scheduler(100.0f);
+		scheduler.SetRateCurve({ Float2{ 0.0f, 0.0f }, Float2{ 0.5f, 2.0f }, Float2{ 1.0f, 0.0f } }, 1.0f);
+		return scheduler;
+	}
+
+	//absolute birth times of the ages one Advance appended
+	void AppendBirthTimes(const ParticleEmissionScheduler& scheduler, const std::vector<float>& ages, std::vector<double>& births)
+	{
+		for (float age : ages)
+		{
+			births.push_back(scheduler.GetTime() - age);
+		}
+	}
+
+	void TestCurveIntegration(TestReport& report)
+	{
+		//the same 10 seconds as frames and as one hitch place the same births
+		const int frames = 600;
+		ParticleEmissionScheduler framed = CreateTriangleScheduler();
+		std::vector<double> framedBirths;
+		for (int f = 0; f < frames; f++)
+		{
+			std::vector<float> ages;
+			framed.Advance(frameDt, 100.0f, ages);
+			AppendBirthTimes(framed, ages, framedBirths);
+		}
+		ParticleEmissionScheduler hitched = CreateTriangleScheduler();
+		std::vector<float> ages;
+		hitched.Advance(frames * frameDt, 100.0f, ages);
+		std::vector<double> hitchedBirths;
+		AppendBirthTimes(hitched, ages, hitchedBirths);
+		std::sort(framedBirths.begin(), framedBirths.end());
+		std::sort(hitchedBirths.begin(), hitchedBirths.end());
+
+		report.Check(framedBirths.size() == 1000 && hitchedBirths.size() == 1000, "10 loops of a curve averaging 100 per second emit 1000");
+		double maxDifference = 0.0;
+		for (size_t i = 0; i < std::min(framedBirths.size(), hitchedBirths.size()); i++)
+		{
+			maxDifference = std::max(maxDifference, std::fabs(framedBirths[i] - hitchedBirths[i]));
+		}
+		report.Check(maxDifference < 1.0e-4, "a hitch places births where small frames place them");
+
+		//births follow the curve inside a frame: the first quarter of a loop holds an eighth of its particles
+		int firstQuarter = 0;
+		for (double birth : hitchedBirths)
+		{
+			if (birth - std::floor(birth) < 0.25)
+				firstQuarter++;
+		}
+		report.Check(firstQuarter >= 120 && firstQuarter <= 130, "births are spread by the rate curve, not evenly over the frame");
+	}
+
+	void TestLongRuntime(TestReport& report)
+	{
+		//a day in, a burst every second still fires once per 60 frames, at its own time
+		ParticleEmissionScheduler scheduler(0.0f);
+		scheduler.AddBurst(ParticleBurst{ 0.0f, 1, 0, 1.0f });
+		std::vector<float> ages;
+		scheduler.Advance(86400.0f, 0.0f, ages);
+		report.Check(ages.empty() && scheduler.GetTime() == 86400.0, "a skip with maxAge 0 emits nothing and keeps the clock exact");
+
+		int fired = 0;
+		double maxAgeError = 0.0;
+		//599 frames end just short of 10 seconds later (a float 1/60 is slightly above it)
+		for (int f = 0; f < 599; f++)
+		{
+			ages.clear();
+			scheduler.Advance(frameDt, 10.0f, ages);
+			for (float age : ages)
+			{
+				//expected age: the frame end past the whole second the burst fired on
+				double frameEnd = scheduler.GetTime();
+				double fireTime = std::floor(frameEnd);
+				maxAgeError = std::max(maxAgeError, std::fabs(age - (frameEnd - fireTime)));
+				fired++;
+			}
+		}
+		report.Check(fired == 10, "a day in, bursts fire once per interval");
+		report.Check(maxAgeError < 1.0e-5, "a day in, burst ages are exact to the frame");
+	}
+
+	void TestLongSkip(TestReport& report)
+	{
+		//3e9 rate particles and 3e12 burst cycles skipped, both beyond int
+		ParticleEmissionScheduler scheduler(1000.0f);
+		scheduler.AddBurst(ParticleBurst{ 0.0f, 1, 0, 1.0e-6f });
+		std::vector<float> ages;
+		int count = scheduler.Advance(3.0e6f, 0.0f, ages);
+		report.Check(count == 0 && ages.empty(), "a 3e6 s skip with maxAge 0 emits nothing");
+
+		ages.clear();
+		count = scheduler.Advance(0.001f, 1.0f, ages);
+		//one rate particle and about a thousand burst cycles in a millisecond
+		report.Check(count >= 900 && count <= 1100, "emission continues normally after the skip");
+
+		//a long hitch only materialises the last maxAge of births
+		ParticleEmissionScheduler hitched(1000.0f);
+		ages.clear();
+		count = hitched.Advance(3.0e6f, 0.25f, ages);
+		report.Check(count >= 249 && count <= 251, "a 3e6 s hitch materialises one lifetime of births");
+	}
+}
+
+int main()
+{
+	TestReport report("EmissionScheduler");
+	TestCurveIntegration(report);
+	TestLongRuntime(report);
+	TestLongSkip(report);
+	return report.Result();
+}
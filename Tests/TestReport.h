@@ -0,0 +1,34 @@
+#pragma once
+
+#include<cstdio>
+
+//Shared plumbing for the ctest executables: every failed check is printed, main returns Result()
+class TestReport
+{
+public:
+	TestReport(const char* name) : name(name), checks(0), failures(0) {}
+
+	//true when condition holds, prints what failed otherwise
+	bool Check(bool condition, const char* what)
+	{
+		checks++;
+		if (!condition)
+		{
+			failures++;
+			std::printf("%s: FAILED %s\n", name, what);
+		}
+		return condition;
+	}
+
+	//process exit code, 0 when every check passed
+	int Result() const
+	{
+		std::printf("%s: %d of %d checks passed\n", name, checks - failures, checks);
+		return failures ? 1 : 0;
+	}
+
+private:
+	const char* name;
+	int checks;
+	int failures;
+};
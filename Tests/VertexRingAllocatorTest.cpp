@@ -0,0 +1,124 @@
+#include"TestReport.h"
+#include"ParticleCore/VertexRingAllocator.h"
+#include<vector>
+
+namespace
+{
+	void TestAppend(TestReport& report)
+	{
+		VertexRingAllocator ring(400);
+		VertexRingAllocation allocation;
+
+		//a fresh buffer has never been mapped, the first allocation discards
+		report.Check(ring.Allocate(100, allocation) && allocation.offset == 0 && allocation.discard, "first allocation discards at 0");
+		report.Check(ring.Allocate(50, allocation) && allocation.offset == 100 && !allocation.discard, "append maps NO_OVERWRITE after the previous one");
+		report.Check(ring.Allocate(200, allocation) && allocation.offset == 150 && !allocation.discard, "second append follows the first");
+		report.Check(ring.Allocate(50, allocation) && allocation.offset == 350 && !allocation.discard, "append ending exactly at the capacity fits");
+		report.Check(ring.GetUsed() == 400, "used counts every appended vertex");
+		report.Check(ring.Allocate(0, allocation) && !allocation.discard, "empty allocation on a full ring does not discard");
+	}
+
+	void TestWrap(TestReport& report)
+	{
+		VertexRingAllocator ring(400);
+		VertexRingAllocation allocation;
+		ring.Allocate(300, allocation);
+
+		report.Check(ring.Allocate(101, allocation) && allocation.offset == 0 && allocation.discard, "allocation past the end wraps to 0 with DISCARD");
+		report.Check(ring.GetUsed() == 101, "wrap restarts used at the wrapped allocation");
+		report.Check(ring.Allocate(10, allocation) && allocation.offset == 101 && !allocation.discard, "appends continue after the wrap");
+
+		ring.Reset();
+		report.Check(ring.Allocate(10, allocation) && allocation.offset == 0 && allocation.discard, "reset makes the next allocation discard");
+	}
+
+	void TestOversize(TestReport& report)
+	{
+		VertexRingAllocator ring(400);
+		VertexRingAllocation allocation;
+		ring.Allocate(100, allocation);
+
+		report.Check(!ring.Allocate(401, allocation), "request larger than the whole ring fails");
+		report.Check(!ring.Allocate(-1, allocation), "negative request fails");
+		report.Check(ring.GetUsed() == 100, "failed requests leave the ring untouched");
+		report.Check(ring.Allocate(10, allocation) && allocation.offset == 100 && !allocation.discard, "ring appends normally after a failed request");
+		report.Check(ring.Allocate(400, allocation) && allocation.offset == 0 && allocation.discard, "request of the whole ring wraps and fits");
+	}
+
+	//one allocation per frame like the emitters and ParticleSystem map their rings, sized ringFrameCount frames deep
+	void TestFrameFencing(TestReport& report)
+	{
+		const int maxFrame = 1000;
+		const int frames = 10000;
+		VertexRingAllocator ring(maxFrame * ringFrameCount);
+
+		//frames since the last discard, and the vertex ranges they were given
+		std::vector<int> begins, ends;
+		bool overlaps = false, outside = false, shortGeneration = false, failed = false;
+		unsigned int state = 1;
+		for (int f = 0; f < frames; f++)
+		{
+			//every 4th frame is full, the rest a deterministic size in [1, maxFrame]
+			state = state * 1664525u + 1013904223u;
+			int count = (f & 3) == 0 ? maxFrame : 1 + (int)((state >> 8) % maxFrame);
+
+			VertexRingAllocation allocation;
+			if (!ring.Allocate(count, allocation))
+			{
+				failed = true;
+				break;
+			}
+			if (allocation.discard)
+			{
+				//the buffer is renamed, everything written before it may still be read by the GPU from the old one
+				if (f > 0 && (int)begins.size() < ringFrameCount)
+					shortGeneration = true;
+				begins.clear();
+				ends.clear();
+			}
+
+			//NO_OVERWRITE promises the range was not written since the last discard, in particular not by the
+			//ringFrameCount - 1 frames still in flight
+			for (size_t i = 0; i < begins.size(); i++)
+			{
+				if (allocation.offset < ends[i] && begins[i] < allocation.offset + count)
+					overlaps = true;
+			}
+			if (allocation.offset < 0 || allocation.offset + count > ring.GetCapacity())
+				outside = true;
+			begins.push_back(allocation.offset);
+			ends.push_back(allocation.offset + count);
+		}
+
+		report.Check(!failed, "every frame up to the largest fits");
+		report.Check(!outside, "every frame lies inside the buffer");
+		report.Check(!overlaps, "no frame is written over without a discard in between");
+		report.Check(!shortGeneration, "the ring holds at least ringFrameCount frames between discards");
+
+		//frames of the largest size discard exactly once per ringFrameCount frames
+		VertexRingAllocator fullRing(maxFrame * ringFrameCount);
+		int discards = 0;
+		for (int f = 0; f < ringFrameCount * 100; f++)
+		{
+			VertexRingAllocation allocation;
+			fullRing.Allocate(maxFrame, allocation);
+			if (allocation.discard)
+			{
+				discards++;
+				if (f % ringFrameCount != 0)
+					shortGeneration = true;
+			}
+		}
+		report.Check(discards == 100 && !shortGeneration, "full frames discard once every ringFrameCount frames");
+	}
+}
+
+int main()
+{
+	TestReport report("VertexRingAllocator");
+	TestAppend(report);
+	TestWrap(report);
+	TestOversize(report);
+	TestFrameFencing(report);
+	return report.Result();
+}
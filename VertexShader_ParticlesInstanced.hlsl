@@ -0,0 +1,60 @@
+#include"ShaderIncludes.hlsli"
+
+struct VToP_Particle
+{
+    float4 screenPosition : SV_POSITION; // XYZW position (System Value Position)
+    float2 uv : TEXCOORD;
+    float4 color : COLOR;
+};
+
+//one ParticleInstance per particle, read from input slot 1
+struct VSInput_ParticleInstance
+{
+    float3 center : CENTER_PER_INSTANCE;
+    float size : SIZE_PER_INSTANCE;
+    uint color : COLOR_PER_INSTANCE;
+    float rotation : ROTATION_PER_INSTANCE;
+};
+
+cbuffer ExternalData : register(b0)
+{
+    matrix worldMatrix;
+    matrix viewMatrix;
+    matrix projectionMatrix;
+}
+
+//6 vertices per instance drawn as a triangle list, same winding as the quad index buffer
+static const uint quadCorner[6] = { 0, 1, 2, 0, 2, 3 };
+//corner offsets in [-1,1] matching the clockwise uvs, with Y flipped
+static const float2 cornerOffset[4] = { float2(-1, 1), float2(1, 1), float2(1, -1), float2(-1, -1) };
+static const float2 cornerUV[4] = { float2(0, 0), float2(1, 0), float2(1, 1), float2(0, 1) };
+
+VToP_Particle main(VSInput_ParticleInstance input, uint vertexId : SV_VertexID)
+{
+    VToP_Particle output;
+    uint corner = quadCorner[vertexId % 6];
+
+    //camera right and up are the first two rows of the (transposed) view matrix
+    float3 camRight = viewMatrix[0].xyz;
+    float3 camUp = viewMatrix[1].xyz;
+
+    //rotate the corner around the view direction, must match ExpandParticleInstance
+    float s, c;
+    sincos(input.rotation, s, c);
+    float2 offset = cornerOffset[corner];
+    float2 rotated = float2(offset.x * c - offset.y * s, offset.x * s + offset.y * c) * input.size;
+    float3 position = input.center + camRight * rotated.x + camUp * rotated.y;
+
+    //RGBA8, red in the low byte
+    output.color = float4(
+        (input.color & 0xFF),
+        (input.color >> 8) & 0xFF,
+        (input.color >> 16) & 0xFF,
+        (input.color >> 24) & 0xFF) / 255.0f;
+    output.uv = cornerUV[corner];
+
+    matrix worldViewProjectionMatrix = mul(projectionMatrix, mul(viewMatrix, worldMatrix));
+    output.screenPosition = mul(worldViewProjectionMatrix, float4(position, 1.0f));
+
+    return output;
+}